@@ -0,0 +1,543 @@
+#include "BTreeRankBoard.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// 叶子和内部节点里从pos开始的n项整体挪到to
+void moveLeafEntries(RankTreeLeaf* dst, int to, const RankTreeLeaf* src, int from, int n) {
+    std::memmove(dst->score + to, src->score + from, n * sizeof(int64_t));
+    std::memmove(dst->timestamp + to, src->timestamp + from, n * sizeof(time_t));
+    std::memmove(dst->player + to, src->player + from, n * sizeof(PlayerHandle));
+}
+
+void moveInnerEntries(RankTreeInner* dst, int to, const RankTreeInner* src, int from, int n) {
+    std::memmove(dst->score + to, src->score + from, n * sizeof(int64_t));
+    std::memmove(dst->timestamp + to, src->timestamp + from, n * sizeof(time_t));
+    std::memmove(dst->child + to, src->child + from, n * sizeof(void*));
+    std::memmove(dst->player + to, src->player + from, n * sizeof(PlayerHandle));
+    std::memmove(dst->size + to, src->size + from, n * sizeof(int));
+}
+
+void setLeafKey(RankTreeLeaf* leaf, int i, const SkipListEntry& key) {
+    leaf->score[i] = key.score;
+    leaf->timestamp[i] = key.timestamp;
+    leaf->player[i] = key.player;
+}
+
+void setSeparator(RankTreeInner* node, int i, const SkipListEntry& key) {
+    node->score[i] = key.score;
+    node->timestamp[i] = key.timestamp;
+    node->player[i] = key.player;
+}
+
+SkipListEntry leafKey(const RankTreeLeaf* leaf, int i) {
+    return SkipListEntry{leaf->score[i], leaf->timestamp[i], leaf->player[i]};
+}
+
+SkipListEntry separator(const RankTreeInner* node, int i) {
+    return SkipListEntry{node->score[i], node->timestamp[i], node->player[i]};
+}
+
+}  // namespace
+
+RankTree::RankTree(const PlayerTable* players) : players(players) {
+    first = createLeaf();
+    root = first;
+}
+
+bool RankTree::keyBefore(int64_t score1, time_t timestamp1, PlayerHandle player1,
+                         int64_t score2, time_t timestamp2, PlayerHandle player2) const {
+    if (score1 != score2) {
+        return score1 > score2;
+    }
+    if (timestamp1 != timestamp2) {
+        return timestamp1 < timestamp2;
+    }
+    if (player1 == player2) {
+        return false;
+    }
+    return players->name(player1) < players->name(player2);
+}
+
+int RankTree::leafPosition(const RankTreeLeaf* leaf, const SkipListEntry& key) const {
+    int lo = 0;
+    int hi = leaf->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (keyBefore(leaf->score[mid], leaf->timestamp[mid], leaf->player[mid], key.score, key.timestamp, key.player)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// 不排在key之后的最后一个分隔键
+int RankTree::childIndex(const RankTreeInner* node, const SkipListEntry& key) const {
+    int lo = 1;
+    int hi = node->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (keyBefore(key.score, key.timestamp, key.player, node->score[mid], node->timestamp[mid], node->player[mid])) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo - 1;
+}
+
+RankTreeLeaf* RankTree::createLeaf() {
+    RankTreeLeaf* leaf = static_cast<RankTreeLeaf*>(pool.allocate(sizeof(RankTreeLeaf)));
+    leaf->prev = nullptr;
+    leaf->next = nullptr;
+    leaf->count = 0;
+    return leaf;
+}
+
+RankTreeInner* RankTree::createInner() {
+    RankTreeInner* node = static_cast<RankTreeInner*>(pool.allocate(sizeof(RankTreeInner)));
+    node->count = 0;
+    return node;
+}
+
+void RankTree::freeLeaf(RankTreeLeaf* leaf) {
+    pool.deallocate(leaf, sizeof(RankTreeLeaf));
+}
+
+void RankTree::freeInner(RankTreeInner* node) {
+    pool.deallocate(node, sizeof(RankTreeInner));
+}
+
+int RankTree::nodeCount(const void* node, int h) {
+    return h == 0 ? static_cast<const RankTreeLeaf*>(node)->count : static_cast<const RankTreeInner*>(node)->count;
+}
+
+int RankTree::subtreeSize(const void* node, int h) {
+    if (h == 0) {
+        return static_cast<const RankTreeLeaf*>(node)->count;
+    }
+    const RankTreeInner* inner = static_cast<const RankTreeInner*>(node);
+    int sum = 0;
+    for (int i = 0; i < inner->count; i++) {
+        sum += inner->size[i];
+    }
+    return sum;
+}
+
+void RankTree::unlinkLeaf(RankTreeLeaf* leaf) {
+    if (leaf->prev) {
+        leaf->prev->next = leaf->next;
+    } else {
+        first = leaf->next;
+    }
+    if (leaf->next) {
+        leaf->next->prev = leaf->prev;
+    }
+}
+
+void RankTree::insert(const SkipListEntry& key) {
+    if (key.player >= index.size()) {
+        index.resize(key.player + 1, nullptr);
+    }
+    SkipListEntry splitKey;
+    void* right = insertInto(root, height, key, splitKey);
+    RANKBOARD_STATS_ONLY(counters.recordVisits(height + 1);)
+    total++;
+    if (right) {
+        // 根分裂，树长高一层
+        RankTreeInner* newRoot = createInner();
+        int rightSize = subtreeSize(right, height);
+        newRoot->child[0] = root;
+        newRoot->size[0] = total - rightSize;
+        newRoot->child[1] = right;
+        newRoot->size[1] = rightSize;
+        setSeparator(newRoot, 1, splitKey);
+        newRoot->count = 2;
+        root = newRoot;
+        height++;
+    }
+}
+
+void* RankTree::insertInto(void* node, int h, const SkipListEntry& key, SkipListEntry& splitKey) {
+    if (h == 0) {
+        return insertIntoLeaf(static_cast<RankTreeLeaf*>(node), key, splitKey);
+    }
+    RankTreeInner* inner = static_cast<RankTreeInner*>(node);
+    int i = childIndex(inner, key);
+    inner->size[i]++;
+    void* right = insertInto(inner->child[i], h - 1, key, splitKey);
+    if (!right) {
+        return nullptr;
+    }
+    int rightSize = subtreeSize(right, h - 1);
+    inner->size[i] -= rightSize;
+    return insertChild(inner, i + 1, right, rightSize, splitKey);
+}
+
+RankTreeLeaf* RankTree::insertIntoLeaf(RankTreeLeaf* leaf, const SkipListEntry& key, SkipListEntry& splitKey) {
+    const int capacity = RankTreeLeaf::CAPACITY;
+    int pos = leafPosition(leaf, key);
+    if (leaf->count < capacity) {
+        moveLeafEntries(leaf, pos + 1, leaf, pos, leaf->count - pos);
+        setLeafKey(leaf, pos, key);
+        leaf->count++;
+        index[key.player] = leaf;
+        return nullptr;
+    }
+    // 一分为二；追加到最后一个叶子末尾时左边保持满的，按排名顺序插入时叶子都是满的
+    RankTreeLeaf* right = createLeaf();
+    int keep = (pos == capacity && !leaf->next) ? capacity : capacity / 2;
+    moveLeafEntries(right, 0, leaf, keep, capacity - keep);
+    right->count = capacity - keep;
+    leaf->count = keep;
+    for (int j = 0; j < right->count; j++) {
+        index[right->player[j]] = right;
+    }
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next) {
+        leaf->next->prev = right;
+    }
+    leaf->next = right;
+    RankTreeLeaf* target = leaf;
+    if (pos > keep || (pos == keep && keep == capacity)) {
+        target = right;
+        pos -= keep;
+    }
+    moveLeafEntries(target, pos + 1, target, pos, target->count - pos);
+    setLeafKey(target, pos, key);
+    target->count++;
+    index[key.player] = target;
+    splitKey = leafKey(right, 0);
+    return right;
+}
+
+RankTreeInner* RankTree::insertChild(RankTreeInner* node, int pos, void* child, int childSize, SkipListEntry& splitKey) {
+    const int capacity = RankTreeInner::CAPACITY;
+    if (node->count < capacity) {
+        moveInnerEntries(node, pos + 1, node, pos, node->count - pos);
+        node->child[pos] = child;
+        node->size[pos] = childSize;
+        setSeparator(node, pos, splitKey);
+        node->count++;
+        return nullptr;
+    }
+    // 先在node里腾出位置放进去，右半部分搬到新节点：capacity+1项放不下，借右边新节点的空间
+    RankTreeInner* right = createInner();
+    int keep = (capacity + 1) / 2;
+    if (pos < keep) {
+        moveInnerEntries(right, 0, node, keep - 1, capacity - keep + 1);
+        moveInnerEntries(node, pos + 1, node, pos, keep - 1 - pos);
+        node->child[pos] = child;
+        node->size[pos] = childSize;
+        setSeparator(node, pos, splitKey);
+    } else {
+        int rightPos = pos - keep;
+        moveInnerEntries(right, 0, node, keep, rightPos);
+        right->child[rightPos] = child;
+        right->size[rightPos] = childSize;
+        setSeparator(right, rightPos, splitKey);
+        moveInnerEntries(right, rightPos + 1, node, pos, capacity - pos);
+    }
+    node->count = keep;
+    right->count = capacity + 1 - keep;
+    // 右边节点第一个子树的分隔键上移到父节点
+    splitKey = separator(right, 0);
+    return right;
+}
+
+bool RankTree::remove(PlayerHandle player) {
+    RankTreeLeaf* leaf = find(player);
+    if (!leaf) {
+        return false;
+    }
+    int j = 0;
+    while (leaf->player[j] != player) {
+        j++;
+    }
+    SkipListEntry key = leafKey(leaf, j);
+    removeFrom(root, height, key);
+    RANKBOARD_STATS_ONLY(counters.recordVisits(height + 1);)
+    index[player] = nullptr;
+    total--;
+    // 根只剩一个子树时降一层
+    while (height > 0 && static_cast<RankTreeInner*>(root)->count == 1) {
+        RankTreeInner* old = static_cast<RankTreeInner*>(root);
+        root = old->child[0];
+        freeInner(old);
+        height--;
+    }
+    if (height > 0 && static_cast<RankTreeInner*>(root)->count == 0) {
+        freeInner(static_cast<RankTreeInner*>(root));
+        first = createLeaf();
+        root = first;
+        height = 0;
+    }
+    return true;
+}
+
+bool RankTree::removeFrom(void* node, int h, const SkipListEntry& key) {
+    if (h == 0) {
+        RankTreeLeaf* leaf = static_cast<RankTreeLeaf*>(node);
+        int pos = leafPosition(leaf, key);
+        if (pos == leaf->count || leaf->player[pos] != key.player) {
+            return false;
+        }
+        moveLeafEntries(leaf, pos, leaf, pos + 1, leaf->count - pos - 1);
+        leaf->count--;
+        return true;
+    }
+    RankTreeInner* inner = static_cast<RankTreeInner*>(node);
+    int i = childIndex(inner, key);
+    if (!removeFrom(inner->child[i], h - 1, key)) {
+        return false;
+    }
+    inner->size[i]--;
+    rebalance(inner, i, h - 1);
+    return true;
+}
+
+void RankTree::rebalance(RankTreeInner* node, int i, int h) {
+    void* child = node->child[i];
+    int count = nodeCount(child, h);
+    if (count == 0) {
+        if (h == 0) {
+            unlinkLeaf(static_cast<RankTreeLeaf*>(child));
+            freeLeaf(static_cast<RankTreeLeaf*>(child));
+        } else {
+            freeInner(static_cast<RankTreeInner*>(child));
+        }
+        eraseChild(node, i);
+        return;
+    }
+    // 不到四分之一满时和相邻的子树合并，合起来放得下才合并
+    int capacity = h == 0 ? RankTreeLeaf::CAPACITY : RankTreeInner::CAPACITY;
+    if (count >= capacity / 4) {
+        return;
+    }
+    if (i > 0 && nodeCount(node->child[i - 1], h) + count <= capacity) {
+        mergeChildren(node, i - 1, h);
+    } else if (i + 1 < node->count && nodeCount(node->child[i + 1], h) + count <= capacity) {
+        mergeChildren(node, i, h);
+    }
+}
+
+void RankTree::mergeChildren(RankTreeInner* node, int i, int h) {
+    if (h == 0) {
+        RankTreeLeaf* left = static_cast<RankTreeLeaf*>(node->child[i]);
+        RankTreeLeaf* right = static_cast<RankTreeLeaf*>(node->child[i + 1]);
+        moveLeafEntries(left, left->count, right, 0, right->count);
+        for (int j = 0; j < right->count; j++) {
+            index[right->player[j]] = left;
+        }
+        left->count += right->count;
+        unlinkLeaf(right);
+        freeLeaf(right);
+    } else {
+        RankTreeInner* left = static_cast<RankTreeInner*>(node->child[i]);
+        RankTreeInner* right = static_cast<RankTreeInner*>(node->child[i + 1]);
+        moveInnerEntries(left, left->count, right, 0, right->count);
+        // right的第一个子树原来没有分隔键，用父节点里right的分隔键
+        setSeparator(left, left->count, separator(node, i + 1));
+        left->count += right->count;
+        freeInner(right);
+    }
+    node->size[i] += node->size[i + 1];
+    eraseChild(node, i + 1);
+}
+
+void RankTree::eraseChild(RankTreeInner* node, int i) {
+    moveInnerEntries(node, i, node, i + 1, node->count - i - 1);
+    node->count--;
+}
+
+void RankTree::update(PlayerHandle player, int64_t score, time_t timestamp) {
+    RankTreeLeaf* leaf = find(player);
+    if (leaf) {
+        int j = 0;
+        while (leaf->player[j] != player) {
+            j++;
+        }
+        if (leaf->score[j] == score && leaf->timestamp[j] == timestamp) {
+            return;
+        }
+        // 新键仍然落在原来的两个邻居之间时原地修改，分数小幅变动的更新大多如此
+        bool afterPrev = j > 0 &&
+            keyBefore(leaf->score[j - 1], leaf->timestamp[j - 1], leaf->player[j - 1], score, timestamp, player);
+        bool beforeNext = j + 1 < leaf->count &&
+            keyBefore(score, timestamp, player, leaf->score[j + 1], leaf->timestamp[j + 1], leaf->player[j + 1]);
+        if (afterPrev && beforeNext) {
+            leaf->score[j] = score;
+            leaf->timestamp[j] = timestamp;
+            return;
+        }
+        remove(player);
+    }
+    insert(SkipListEntry{score, timestamp, player});
+}
+
+int RankTree::countBefore(const SkipListEntry& key) const {
+    const void* node = root;
+    int before = 0;
+    for (int h = height; h > 0; h--) {
+        const RankTreeInner* inner = static_cast<const RankTreeInner*>(node);
+        int i = childIndex(inner, key);
+        for (int k = 0; k < i; k++) {
+            before += inner->size[k];
+        }
+        node = inner->child[i];
+    }
+    RANKBOARD_STATS_ONLY(counters.recordVisits(height + 1);)
+    return before + leafPosition(static_cast<const RankTreeLeaf*>(node), key);
+}
+
+int RankTree::getRank(PlayerHandle player) const {
+    const RankTreeLeaf* leaf = find(player);
+    if (!leaf) {
+        return -1;
+    }
+    int j = 0;
+    while (leaf->player[j] != player) {
+        j++;
+    }
+    return countBefore(leafKey(leaf, j));
+}
+
+const RankTreeLeaf* RankTree::leafAt(int position, int& offset) const {
+    if (position < 0 || position >= total) {
+        return nullptr;
+    }
+    const void* node = root;
+    for (int h = height; h > 0; h--) {
+        const RankTreeInner* inner = static_cast<const RankTreeInner*>(node);
+        int i = 0;
+        while (position >= inner->size[i]) {
+            position -= inner->size[i];
+            i++;
+        }
+        node = inner->child[i];
+    }
+    RANKBOARD_STATS_ONLY(counters.recordVisits(height + 1);)
+    offset = position;
+    return static_cast<const RankTreeLeaf*>(node);
+}
+
+void RankTree::clear() {
+    pool.release();
+    std::vector<RankTreeLeaf*>().swap(index);
+    total = 0;
+    height = 0;
+    first = createLeaf();
+    root = first;
+}
+
+MemoryStats RankTree::memoryStats() const {
+    MemoryStats stats;
+    stats.players = total;
+    stats.reservedBytes = pool.bytesReserved();
+    stats.usedBytes = pool.bytesInUse();
+    stats.indexBytes = index.capacity() * sizeof(RankTreeLeaf*);
+    stats.playerTableBytes = 0;
+    return stats;
+}
+
+void BTreeRankBoard::updateScore(const std::string& playerId, int64_t newScore, time_t timestamp) {
+    updateScore(players->intern(playerId), newScore, timestamp);
+}
+
+void BTreeRankBoard::updateScore(PlayerHandle player, int64_t newScore, time_t timestamp) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(tree.boardStats(), BoardOp::UpdateScore);)
+    tree.update(player, newScore, timestamp);
+}
+
+void BTreeRankBoard::updateScores(const ScoreUpdate* updates, size_t count) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(tree.boardStats(), BoardOp::UpdateScores);)
+    for (size_t i = 0; i < count; i++) {
+        tree.update(players->intern(updates[i].playerId), updates[i].score, updates[i].timestamp);
+    }
+}
+
+int BTreeRankBoard::getRank(const std::string& playerId) {
+    PlayerHandle player = players->lookup(playerId);
+    if (player == PlayerTable::INVALID) {
+        return 0;
+    }
+    return getRank(player);
+}
+
+int BTreeRankBoard::getRank(PlayerHandle player) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(tree.boardStats(), BoardOp::GetRank);)
+    return tree.getRank(player) + 1;
+}
+
+void BTreeRankBoard::collect(int position, int count, std::vector<RankInfo>& out) const {
+    int offset = 0;
+    const RankTreeLeaf* leaf = tree.leafAt(position, offset);
+    while (leaf && count > 0) {
+        for (; offset < leaf->count && count > 0; offset++, count--) {
+            RankInfo& info = out.emplace_back();
+            info.playerId = players->name(leaf->player[offset]);
+            info.score = leaf->score[offset];
+            info.timestamp = leaf->timestamp[offset];
+        }
+        leaf = leaf->next;
+        offset = 0;
+    }
+}
+
+std::vector<RankInfo> BTreeRankBoard::getTopNPlayers(int n) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(tree.boardStats(), BoardOp::GetTopN);)
+    std::vector<RankInfo> topNPlayers;
+    if (n < 1) {
+        return topNPlayers;
+    }
+    topNPlayers.reserve(std::min(n, tree.size()));
+    collect(0, n, topNPlayers);
+    return topNPlayers;
+}
+
+std::vector<RankInfo> BTreeRankBoard::getNearbyPlayers(const std::string& playerId, int n) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(tree.boardStats(), BoardOp::GetNearby);)
+    std::vector<RankInfo> nearbyPlayers;
+    if (n < 1) {
+        return nearbyPlayers;
+    }
+    PlayerHandle player = players->lookup(playerId);
+    int rank = player == PlayerTable::INVALID ? -1 : tree.getRank(player);
+    if (rank < 0) {
+        return nearbyPlayers;
+    }
+    // 排在自己前面n/2名的玩家开始，按玩家数直接定位
+    nearbyPlayers.reserve(n);
+    collect(std::max(0, rank - n/2), n, nearbyPlayers);
+    return nearbyPlayers;
+}
+
+std::vector<RankInfo> BTreeRankBoard::getRange(int startRank, int count) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(tree.boardStats(), BoardOp::GetRange);)
+    std::vector<RankInfo> range;
+    if (startRank < 1 || count < 1) {
+        return range;
+    }
+    range.reserve(std::min(count, tree.size()));
+    collect(startRank - 1, count, range);
+    return range;
+}
+
+MemoryStats BTreeRankBoard::memoryStats() const {
+    MemoryStats stats = tree.memoryStats();
+    stats.playerTableBytes = players->memoryBytes();
+    return stats;
+}
+
+BoardStatsReport BTreeRankBoard::stats() const {
+#ifdef RANKBOARD_STATS
+    return tree.boardStats().report();
+#else
+    return BoardStatsReport();
+#endif
+}
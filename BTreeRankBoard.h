@@ -0,0 +1,154 @@
+/*
+    计数B+树排行榜：接口和RankBoard相同(updateScore/getRank/getTopNPlayers/getNearbyPlayers/getRange)，排序规则也完全一致，
+    可以直接替换，或者作为模板参数传给按排行榜类型写的代码(比如压测套件)。
+    跳表每走一步基本都是一次缓存未命中；B+树的叶子按排名顺序连续存放48个排序键，分数、时间戳、玩家句柄各自一个数组，
+    内部节点存每个子树的玩家数，查排名时从根往下累加左边子树的玩家数，千万玩家也只有5层，每层只碰一两条缓存行。
+    叶子之间用双向链表串起来，前N名和前后N名定位到叶子后顺序往后读。
+    节点都不超过1KB，从slab内存池分配，清空时整体释放。
+    只有单线程版本：不支持并发读、前K名缓存、翻页游标、快照、转储和日志，需要这些功能时用RankBoard。
+*/
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BoardStats.h"
+#include "PlayerTable.h"
+#include "RankBoard.h"
+#include "SlabAllocator.h"
+
+// 叶子：按排名顺序存放的排序键，count个有效
+struct RankTreeLeaf {
+    static const int CAPACITY = 48;
+    int64_t score[CAPACITY];
+    time_t timestamp[CAPACITY];
+    PlayerHandle player[CAPACITY];
+    RankTreeLeaf* prev;
+    RankTreeLeaf* next;
+    int count;
+};
+
+// 内部节点：第i个子树的玩家数和分隔键，第i个子树里的键都不排在分隔键i之前、都排在分隔键i+1之前，分隔键0不用
+struct RankTreeInner {
+    static const int CAPACITY = 30;
+    int64_t score[CAPACITY];
+    time_t timestamp[CAPACITY];
+    void* child[CAPACITY];  // 高度为1时是RankTreeLeaf，否则是RankTreeInner
+    PlayerHandle player[CAPACITY];
+    int size[CAPACITY];
+    int count;
+};
+
+// 计数B+树
+class RankTree {
+public:
+    explicit RankTree(const PlayerTable* players);
+    RankTree(const RankTree&) = delete;
+    RankTree& operator=(const RankTree&) = delete;
+    // 玩家所在的叶子，不在树上返回nullptr
+    RankTreeLeaf* find(PlayerHandle player) const {
+        return player < index.size() ? index[player] : nullptr;
+    }
+    // 插入玩家，玩家不能已经在树上
+    void insert(const SkipListEntry& key);
+    // 删除玩家，不在树上返回false
+    bool remove(PlayerHandle player);
+    // 更新玩家的分数和时间戳，不存在则插入
+    void update(PlayerHandle player, int64_t score, time_t timestamp);
+    // 玩家的排名 从0开始，不存在返回-1
+    int getRank(PlayerHandle player) const;
+    // 排在key之前的玩家数
+    int countBefore(const SkipListEntry& key) const;
+    // 第position个玩家(从0开始)所在的叶子，offset为它在叶子里的位置，超出范围返回nullptr
+    const RankTreeLeaf* leafAt(int position, int& offset) const;
+    // 排名第一的玩家所在的叶子
+    const RankTreeLeaf* firstLeaf() const { return first; }
+    // 玩家总数
+    int size() const { return total; }
+    // 清空，内存池整体释放
+    void clear();
+    // 内存占用统计
+    MemoryStats memoryStats() const;
+    RANKBOARD_STATS_ONLY(BoardStats& boardStats() const { return counters; })
+
+private:
+    SlabAllocator pool;
+    const PlayerTable* players;
+    void* root;
+    int height = 0;                    // 根节点的高度，0表示根就是叶子
+    int total = 0;
+    RankTreeLeaf* first;               // 最左边的叶子
+    std::vector<RankTreeLeaf*> index;  // 玩家句柄到所在叶子，键在叶子之间移动时同步修改
+    RANKBOARD_STATS_ONLY(mutable BoardStats counters{false};)
+
+    // 键1是否排在键2之前，和SkipList::keyBefore相同
+    bool keyBefore(int64_t score1, time_t timestamp1, PlayerHandle player1,
+                   int64_t score2, time_t timestamp2, PlayerHandle player2) const;
+    // 叶子里排在key之前的键个数
+    int leafPosition(const RankTreeLeaf* leaf, const SkipListEntry& key) const;
+    // key所在的子树
+    int childIndex(const RankTreeInner* node, const SkipListEntry& key) const;
+    RankTreeLeaf* createLeaf();
+    RankTreeInner* createInner();
+    void freeLeaf(RankTreeLeaf* leaf);
+    void freeInner(RankTreeInner* node);
+    // 把key插入以node为根、高度为h的子树，子树分裂时返回新的右半部分，splitKey为它的最小键
+    void* insertInto(void* node, int h, const SkipListEntry& key, SkipListEntry& splitKey);
+    RankTreeLeaf* insertIntoLeaf(RankTreeLeaf* leaf, const SkipListEntry& key, SkipListEntry& splitKey);
+    // 在内部节点的pos位置插入子树，节点满了就分裂，规则同insertInto
+    RankTreeInner* insertChild(RankTreeInner* node, int pos, void* child, int childSize, SkipListEntry& splitKey);
+    // 从以node为根、高度为h的子树删除key，没找到返回false
+    bool removeFrom(void* node, int h, const SkipListEntry& key);
+    // 第i个子树(高度为h)删除过键之后，空了就摘掉，太空时和相邻的子树合并
+    void rebalance(RankTreeInner* node, int i, int h);
+    // 把第i+1个子树并进第i个子树
+    void mergeChildren(RankTreeInner* node, int i, int h);
+    // 去掉内部节点的第i项
+    void eraseChild(RankTreeInner* node, int i);
+    void unlinkLeaf(RankTreeLeaf* leaf);
+    static int nodeCount(const void* node, int h);
+    static int subtreeSize(const void* node, int h);
+};
+
+class BTreeRankBoard {
+public:
+    BTreeRankBoard() : BTreeRankBoard(std::make_shared<PlayerTable>()) {}
+    // 和其他排行榜共用一个玩家id表
+    explicit BTreeRankBoard(std::shared_ptr<PlayerTable> sharedPlayers)
+        : players(std::move(sharedPlayers)), tree(players.get()) {}
+    // 更新玩家积分，如果不存在则添加新玩家
+    void updateScore(const std::string& playerId, int64_t newScore, time_t timestamp);
+    void updateScore(PlayerHandle player, int64_t newScore, time_t timestamp);
+    // 批量更新，结果和逐条调用updateScore相同
+    void updateScores(const ScoreUpdate* updates, size_t count);
+    void updateScores(const std::vector<ScoreUpdate>& updates) { updateScores(updates.data(), updates.size()); }
+    // 查询玩家当前排名 从1开始，不存在返回0
+    int getRank(const std::string& playerId);
+    int getRank(PlayerHandle player);
+    // 玩家id对应的句柄，不存在则分配一个
+    PlayerHandle getHandle(const std::string& playerId) { return players->intern(playerId); }
+    const PlayerTable& playerTable() const { return *players; }
+    // 获取前N名玩家的分数和名次
+    std::vector<RankInfo> getTopNPlayers(int n);
+    // 查询自己名次前后共N名玩家，规则同RankBoard::getNearbyPlayers
+    std::vector<RankInfo> getNearbyPlayers(const std::string& playerId, int n);
+    // 排名从startRank(从1开始)起的count个玩家
+    std::vector<RankInfo> getRange(int startRank, int count);
+    // 玩家总数
+    int getPlayerCount() const { return tree.size(); }
+    // 清空排行榜
+    void clear() { tree.clear(); }
+    // 排行榜占用的内存
+    MemoryStats memoryStats() const;
+    // 同RankBoard::stats，没有各层节点数
+    BoardStatsReport stats() const;
+
+private:
+    std::shared_ptr<PlayerTable> players;  // 先于tree构造
+    RankTree tree;
+    // 从第position个玩家开始往后取最多count个
+    void collect(int position, int count, std::vector<RankInfo>& out) const;
+};
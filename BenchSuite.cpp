@@ -0,0 +1,80 @@
+#include "BenchSuite.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<size_t> liveBytes{0};
+std::atomic<uint64_t> allocationCount{0};
+
+// 每块前面多分配16字节记录大小，释放时才知道还回去多少；16字节也保证了返回的地址按16字节对齐
+const size_t HEADER_BYTES = 16;
+
+}  // namespace
+
+// 不内联：gcc看到内联进来的malloc/free会误报new和delete不匹配
+#ifdef _MSC_VER
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
+NOINLINE void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size + HEADER_BYTES)) {
+        *static_cast<size_t*>(p) = size;
+        liveBytes.fetch_add(size, std::memory_order_relaxed);
+        return static_cast<char*>(p) + HEADER_BYTES;
+    }
+    throw std::bad_alloc();
+}
+
+NOINLINE void operator delete(void* p) noexcept {
+    if (p) {
+        char* block = static_cast<char*>(p) - HEADER_BYTES;
+        liveBytes.fetch_sub(*reinterpret_cast<size_t*>(block), std::memory_order_relaxed);
+        std::free(block);
+    }
+}
+
+NOINLINE void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+size_t heapBytesInUse() {
+    return liveBytes.load(std::memory_order_relaxed);
+}
+
+uint64_t heapAllocations() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+SuiteOptions suiteOptions(int argc, char* argv[]) {
+    SuiteOptions options;
+    int maxPlayers = argc > 0 ? std::atoi(argv[0]) : 1000000;
+    for (int players = 10000; players <= maxPlayers; players *= 10) {
+        options.sizes.push_back(players);
+    }
+    if (argc > 1) {
+        options.workloads.push_back(argv[1]);
+    } else {
+        options.workloads = {"uniform", "zipf", "ties"};
+    }
+    return options;
+}
+
+void printSuiteHeader() {
+    std::cout << std::left << std::setw(16) << "board" << std::setw(9) << "workload" << std::right << std::setw(9)
+              << "players" << "  " << std::left << std::setw(18) << "op" << std::right << std::setw(9) << "ops"
+              << std::setw(13) << "ops/s" << std::setw(10) << "p50 ns" << std::setw(10) << "p99 ns" << std::endl;
+}
+
+void printSuiteRow(const std::string& board, const std::string& workload, int players, const char* op,
+                   const SuiteResult& result) {
+    std::cout << std::left << std::setw(16) << board << std::setw(9) << workload << std::right << std::setw(9)
+              << players << "  " << std::left << std::setw(18) << op << std::right << std::setw(9) << result.ops
+              << std::fixed << std::setprecision(0) << std::setw(13) << result.opsPerSecond << std::setw(10)
+              << result.p50Ns << std::setw(10) << result.p99Ns << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,212 @@
+/*
+    两个版本的排行榜和std::set基准共用的压测套件(suite)。
+    负载：uniform 分数和挑选的玩家都是均匀分布；zipf 按Zipf(s=1)挑玩家，少数活跃玩家占了大部分更新和查询；
+    ties 分数只有100种，绝大多数玩家同分。
+    玩家数从1万开始每次乘10，直到指定的最大玩家数。每种负载先灌入全部玩家，再依次测updateScore、getRank、
+    getTopNPlayers(10)、getNearbyPlayers(10)，每次操作单独计时(包括约20ns的计时开销)，
+    输出每秒操作数、p50/p99延迟，以及灌入前后堆内存的差值折算出的每个玩家占用的字节数。
+    每项操作最多跑opCount次或者opSeconds秒，std::set基准的getRank是O(n)，玩家多的时候只跑到时间用完为止。
+    RankBoard和RankBoardDense类名相同，不能链接进同一个程序，分别由RankBoardBench和RankBoardDenseBench运行，
+    负载和随机数种子完全相同，两边的输出可以直接对比。
+*/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// 进程里通过operator new分配、还没有释放的字节数，BenchSuite.cpp替换了全局的operator new来统计
+size_t heapBytesInUse();
+// 进程累计调用operator new的次数，用来确认查询有没有分配内存
+uint64_t heapAllocations();
+
+// 基准：std::set按(分数降序, 时间戳升序, playerId升序)保存所有玩家，unordered_map记每个玩家当前的键。
+// 更新O(logn)；std::set不知道子树大小，排名只能从头数，O(n)；前后N名从自己的位置往前后走，O(logn+N)
+class SetRankBoard {
+public:
+    struct Entry {
+        std::string playerId;
+        int64_t score;
+        time_t timestamp;
+    };
+
+    void updateScore(const std::string& playerId, int64_t newScore, time_t timestamp) {
+        auto found = current.find(playerId);
+        if (found != current.end()) {
+            ranking.erase(Key{-found->second.first, found->second.second, playerId});
+            found->second = {newScore, timestamp};
+        } else {
+            current.emplace(playerId, std::make_pair(newScore, timestamp));
+        }
+        ranking.insert(Key{-newScore, timestamp, playerId});
+    }
+
+    int getRank(const std::string& playerId) const {
+        auto found = current.find(playerId);
+        if (found == current.end()) {
+            return 0;
+        }
+        auto it = ranking.find(Key{-found->second.first, found->second.second, playerId});
+        return static_cast<int>(std::distance(ranking.begin(), it)) + 1;
+    }
+
+    std::vector<Entry> getTopNPlayers(int n) const {
+        std::vector<Entry> result;
+        for (auto it = ranking.begin(); it != ranking.end() && static_cast<int>(result.size()) < n; ++it) {
+            result.push_back(entryOf(*it));
+        }
+        return result;
+    }
+
+    // 和RankBoard一样：从自己前面n/2名开始取n个，到榜尾为止
+    std::vector<Entry> getNearbyPlayers(const std::string& playerId, int n) const {
+        std::vector<Entry> result;
+        auto found = current.find(playerId);
+        if (found == current.end() || n <= 0) {
+            return result;
+        }
+        auto it = ranking.find(Key{-found->second.first, found->second.second, playerId});
+        for (int i = 0; i < n / 2 && it != ranking.begin(); i++) {
+            --it;
+        }
+        for (; it != ranking.end() && static_cast<int>(result.size()) < n; ++it) {
+            result.push_back(entryOf(*it));
+        }
+        return result;
+    }
+
+private:
+    using Key = std::tuple<int64_t, time_t, std::string>;  // 分数取负，按tuple的默认顺序就是排名顺序
+
+    std::set<Key> ranking;
+    std::unordered_map<std::string, std::pair<int64_t, time_t>> current;
+
+    static Entry entryOf(const Key& key) { return Entry{std::get<2>(key), -std::get<0>(key), std::get<1>(key)}; }
+};
+
+struct SuiteOptions {
+    std::vector<int> sizes;               // 玩家数
+    std::vector<std::string> workloads;   // uniform|zipf|ties
+    int opCount = 200000;                 // 每项操作最多跑多少次
+    double opSeconds = 1.0;               // 每项操作最多跑多久
+};
+
+// 命令行参数：[最大玩家数，默认100万] [只跑一种负载]
+SuiteOptions suiteOptions(int argc, char* argv[]);
+
+// 一项操作的结果
+struct SuiteResult {
+    int ops;
+    double opsPerSecond;
+    double p50Ns;
+    double p99Ns;
+};
+
+// 调用op(i)，i从0开始，直到跑了maxOps次或者超过maxSeconds秒
+template <class Op>
+SuiteResult measureOps(int maxOps, double maxSeconds, Op op) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<float> latencies;
+    latencies.reserve(maxOps);
+    auto begin = Clock::now();
+    auto deadline = begin + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(maxSeconds));
+    auto last = begin;
+    for (int i = 0; i < maxOps && last < deadline; i++) {
+        op(i);
+        auto now = Clock::now();
+        latencies.push_back(std::chrono::duration<float, std::nano>(now - last).count());
+        last = now;
+    }
+    double seconds = std::chrono::duration<double>(last - begin).count();
+    SuiteResult result;
+    result.ops = static_cast<int>(latencies.size());
+    result.opsPerSecond = result.ops / seconds;
+    std::sort(latencies.begin(), latencies.end());
+    result.p50Ns = latencies[latencies.size() / 2];
+    result.p99Ns = latencies[latencies.size() * 99 / 100];
+    return result;
+}
+
+void printSuiteHeader();
+void printSuiteRow(const std::string& board, const std::string& workload, int players, const char* op,
+                   const SuiteResult& result);
+
+// 按options跑一遍所有负载，makeBoard每次返回一个新的空排行榜(std::unique_ptr<Board>)
+template <class Board, class MakeBoard>
+void runSuite(const std::string& name, const SuiteOptions& options, MakeBoard makeBoard) {
+    printSuiteHeader();
+    size_t checksum = 0;
+    for (int players : options.sizes) {
+        std::vector<std::string> ids;
+        ids.reserve(players);
+        for (int i = 0; i < players; i++) {
+            ids.push_back("Player" + std::to_string(i));
+        }
+        // Zipf(s=1)：第i个玩家被选中的概率正比于1/(i+1)，按累积分布二分查找
+        std::vector<double> cdf(players);
+        double total = 0;
+        for (int i = 0; i < players; i++) {
+            total += 1.0 / (i + 1);
+            cdf[i] = total;
+        }
+        for (const std::string& workload : options.workloads) {
+            std::mt19937_64 gen(12345);
+            std::uniform_int_distribution<int64_t> scoreDis(0, workload == "ties" ? 99 : 1000000000);
+            std::uniform_int_distribution<int> uniformDis(0, players - 1);
+            std::uniform_real_distribution<double> zipfDis(0, total);
+            // 每次操作要用的玩家和分数提前生成好，不算在操作的耗时里
+            std::vector<int> picks(options.opCount);
+            std::vector<int64_t> scores(std::max(options.opCount, players));
+            for (int& pick : picks) {
+                if (workload == "zipf") {
+                    pick = static_cast<int>(std::lower_bound(cdf.begin(), cdf.end(), zipfDis(gen)) - cdf.begin());
+                    pick = std::min(pick, players - 1);
+                } else {
+                    pick = uniformDis(gen);
+                }
+            }
+            for (int64_t& score : scores) {
+                score = scoreDis(gen);
+            }
+            time_t timestamp = 100000;
+
+            size_t heapBefore = heapBytesInUse();
+            std::unique_ptr<Board> board = makeBoard();
+            SuiteResult insert = measureOps(players, 1e9, [&](int i) {
+                board->updateScore(ids[i], scores[i], timestamp++);
+            });
+            double bytesPerPlayer = double(heapBytesInUse() - heapBefore) / players;
+            printSuiteRow(name, workload, players, "insert", insert);
+            SuiteResult update = measureOps(options.opCount, options.opSeconds, [&](int i) {
+                board->updateScore(ids[picks[i]], scores[i], timestamp++);
+            });
+            printSuiteRow(name, workload, players, "updateScore", update);
+            SuiteResult rank = measureOps(options.opCount, options.opSeconds, [&](int i) {
+                checksum += board->getRank(ids[picks[i]]);
+            });
+            printSuiteRow(name, workload, players, "getRank", rank);
+            SuiteResult top = measureOps(options.opCount, options.opSeconds, [&](int) {
+                checksum += board->getTopNPlayers(10).size();
+            });
+            printSuiteRow(name, workload, players, "getTopNPlayers", top);
+            SuiteResult nearby = measureOps(options.opCount, options.opSeconds, [&](int i) {
+                checksum += board->getNearbyPlayers(ids[picks[i]], 10).size();
+            });
+            printSuiteRow(name, workload, players, "getNearbyPlayers", nearby);
+            std::cout << std::left << std::setw(16) << name << std::setw(9) << workload << std::right << std::setw(9)
+                      << players << "  bytes/player " << std::fixed << std::setprecision(1) << bytesPerPlayer
+                      << std::defaultfloat << std::endl;
+        }
+    }
+    std::cout << name << " checksum " << checksum << std::endl;
+}
@@ -0,0 +1,194 @@
+#include "BoardStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// 程序启动时的两个时钟，校准时和现在比较
+const uint64_t startTicks = statsTicks();
+const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+}  // namespace
+
+const char* boardOpName(BoardOp op) {
+    switch (op) {
+        case BoardOp::UpdateScore: return "updateScore";
+        case BoardOp::UpdateScores: return "updateScores";
+        case BoardOp::IncrementScore: return "incrementScore";
+        case BoardOp::GetRank: return "getRank";
+        case BoardOp::GetTopN: return "getTopNPlayers";
+        case BoardOp::GetNearby: return "getNearbyPlayers";
+        case BoardOp::GetRange: return "getRange";
+        default: return "?";
+    }
+}
+
+// 用程序启动以来两个时钟走过的时间求比例，离启动太近时先等够10ms，误差在千分之一以内
+double statsTicksPerNs() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)) || defined(__x86_64__) || defined(__i386__)
+    auto elapsed = std::chrono::steady_clock::now() - startTime;
+    while (elapsed < std::chrono::milliseconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10) - elapsed);
+        elapsed = std::chrono::steady_clock::now() - startTime;
+    }
+    uint64_t ticks = statsTicks() - startTicks;
+    return double(ticks) / std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+#else
+    return 1.0;
+#endif
+}
+
+void StatsHistogram::reset() {
+    for (std::atomic<uint64_t>& count : counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+void StatsHistogram::merge(const StatsHistogram& other) {
+    for (int i = 0; i < BUCKETS; i++) {
+        bump(counts[i], other.counts[i].load(std::memory_order_relaxed));
+    }
+    bump(sum, other.sum.load(std::memory_order_relaxed));
+    uint64_t otherMax = other.max.load(std::memory_order_relaxed);
+    if (otherMax > max.load(std::memory_order_relaxed)) {
+        max.store(otherMax, std::memory_order_relaxed);
+    }
+}
+
+uint64_t StatsHistogram::bucketLow(int bucket) {
+    if (bucket < SUB_COUNT) {
+        return static_cast<uint64_t>(bucket);
+    }
+    int msb = bucket / SUB_COUNT + SUB_BITS - 1;
+    return static_cast<uint64_t>(SUB_COUNT + bucket % SUB_COUNT) << (msb - SUB_BITS);
+}
+
+// 百分位取桶的中点，最大值和平均值是精确的
+HistogramSummary StatsHistogram::summary(double scale) const {
+    HistogramSummary result;
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        total += bucketCount(i);
+    }
+    result.count = total;
+    if (total == 0) {
+        return result;
+    }
+    result.mean = double(sum.load(std::memory_order_relaxed)) / total * scale;
+    result.max = double(max.load(std::memory_order_relaxed)) * scale;
+    const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    double* outputs[] = {&result.p50, &result.p90, &result.p99, &result.p999};
+    uint64_t seen = 0;
+    int next = 0;
+    for (int i = 0; i < BUCKETS && next < 4; i++) {
+        seen += bucketCount(i);
+        while (next < 4 && seen >= std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantiles[next] * total)))) {
+            uint64_t low = bucketLow(i);
+            uint64_t high = i + 1 < BUCKETS ? bucketLow(i + 1) : low + 1;
+            *outputs[next++] = std::min(double(low + high - 1) / 2 * scale, result.max);
+        }
+    }
+    return result;
+}
+
+BoardStats::BoardStats(bool concurrentReads)
+    : shardCount(concurrentReads ? CONCURRENT_SHARDS : 1), shards(new Shard[concurrentReads ? CONCURRENT_SHARDS : 1]) {
+    for (std::atomic<uint64_t>& count : levels) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+int BoardStats::threadSlot() {
+    static std::atomic<int> nextSlot{0};
+    thread_local int slot = nextSlot.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+void BoardStats::resetStructure() {
+    for (std::atomic<uint64_t>& count : levels) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    tieGroups.reset();
+}
+
+BoardStatsReport BoardStats::report() const {
+    BoardStatsReport report;
+    report.enabled = true;
+    double nsPerTick = 1.0 / statsTicksPerNs();
+    for (int op = 0; op < static_cast<int>(BoardOp::Count); op++) {
+        StatsHistogram merged;
+        for (int i = 0; i < shardCount; i++) {
+            merged.merge(shards[i].ops[op]);
+        }
+        report.latency[op] = merged.summary(nsPerTick);
+    }
+    StatsHistogram visits;
+    for (int i = 0; i < shardCount; i++) {
+        visits.merge(shards[i].visits);
+    }
+    report.nodesVisited = visits.summary(1.0);
+    int top = MAX_LEVELS;
+    while (top > 0 && levels[top - 1].load(std::memory_order_relaxed) == 0) {
+        top--;
+    }
+    for (int i = 0; i < top; i++) {
+        report.levels.push_back(levels[i].load(std::memory_order_relaxed));
+    }
+    // 对数线性的桶按2的幂合并
+    for (int i = 1; i < StatsHistogram::BUCKETS; i++) {
+        uint64_t count = tieGroups.bucketCount(i);
+        if (count == 0) {
+            continue;
+        }
+        size_t power = 0;
+        while ((uint64_t(2) << power) <= StatsHistogram::bucketLow(i)) {
+            power++;
+        }
+        if (report.tieGroups.size() <= power) {
+            report.tieGroups.resize(power + 1, 0);
+        }
+        report.tieGroups[power] += count;
+    }
+    return report;
+}
+
+std::string BoardStatsReport::toString() const {
+    if (!enabled) {
+        return "stats disabled (build with RANKBOARD_STATS)\n";
+    }
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(0);
+    for (int op = 0; op < static_cast<int>(BoardOp::Count); op++) {
+        const HistogramSummary& h = latency[op];
+        if (h.count == 0) {
+            continue;
+        }
+        out << boardOpName(static_cast<BoardOp>(op)) << ": count " << h.count << ", mean " << h.mean << " ns, p50 "
+            << h.p50 << " ns, p90 " << h.p90 << " ns, p99 " << h.p99 << " ns, p99.9 " << h.p999 << " ns, max "
+            << h.max << " ns\n";
+    }
+    out.precision(1);
+    out << "nodes visited per search: count " << nodesVisited.count << ", mean " << nodesVisited.mean << ", p50 "
+        << nodesVisited.p50 << ", p99 " << nodesVisited.p99 << ", max " << nodesVisited.max << "\n";
+    out << "nodes per level:";
+    for (size_t i = 0; i < levels.size(); i++) {
+        out << " " << i + 1 << ":" << levels[i];
+    }
+    out << "\n";
+    if (!tieGroups.empty()) {
+        out << "scores by tie group size:";
+        for (size_t i = 0; i < tieGroups.size(); i++) {
+            if (tieGroups[i] > 0) {
+                out << " [" << (uint64_t(1) << i) << "," << (uint64_t(2) << i) << "):" << tieGroups[i];
+            }
+        }
+        out << "\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,208 @@
+/*
+    排行榜热路径的统计，编译时定义RANKBOARD_STATS才打开(cmake -DRANKBOARD_STATS=ON)。
+    没打开时排行榜里没有统计成员，RANKBOARD_STATS_ONLY里的代码整个不编译，stats()返回enabled为false的空报告。
+    打开后记录：
+        每种操作的耗时直方图：HDR风格的对数线性分桶，每个2的幂区间再等分8份，相对误差不超过12.5%；
+        计时用rdtsc(不是x86时用steady_clock)，热路径上只记周期数，导出时才换算成纳秒；
+        每次查找访问的节点数，直方图；
+        各层数的节点个数；
+        密集版每个分数的同分玩家数分布。
+    计数器是原子变量，但只用relaxed的读和写(不是fetch_add)，单线程时和普通变量一样快。
+    开启并发读的排行榜给读线程分16份计数器，每个线程按自己的编号落到其中一份，
+    两个线程落到同一份时可能丢掉少量计数，统计只是近似值；写线程的计数是精确的。
+*/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifdef RANKBOARD_STATS
+#define RANKBOARD_STATS_ONLY(...) __VA_ARGS__
+#else
+#define RANKBOARD_STATS_ONLY(...)
+#endif
+
+// 统计的操作，字符串形式或者句柄形式的重载记在同一项里
+enum class BoardOp {
+    UpdateScore,    // updateScore
+    UpdateScores,   // updateScores，每批记一次
+    IncrementScore, // incrementScore
+    GetRank,        // getRank
+    GetTopN,        // getTopNPlayers、forEachTop
+    GetNearby,      // getNearbyPlayers、forEachNearby
+    GetRange,       // getRange、getRangeByScore、nextPage
+    Count
+};
+
+const char* boardOpName(BoardOp op);
+
+// 直方图导出的摘要
+struct HistogramSummary {
+    uint64_t count = 0;
+    double mean = 0;
+    double p50 = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    double max = 0;
+};
+
+// stats()的结果，耗时单位是纳秒
+struct BoardStatsReport {
+    bool enabled = false;                      // 编译时是否打开了统计
+    HistogramSummary latency[static_cast<int>(BoardOp::Count)];
+    HistogramSummary nodesVisited;             // 每次查找访问的节点数
+    std::vector<uint64_t> levels;              // levels[i]为有i+1层的节点个数
+    // 同分玩家数的分布：tieGroups[i]为同分玩家数在[2^i, 2^(i+1))之间的分数个数，只有密集版有
+    std::vector<uint64_t> tieGroups;
+
+    const HistogramSummary& of(BoardOp op) const { return latency[static_cast<int>(op)]; }
+    // 多行文本，便于打日志
+    std::string toString() const;
+};
+
+// 当前时刻，单位是周期(rdtsc)或纳秒，只用来求差
+inline uint64_t statsTicks() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// 每纳秒多少个statsTicks，第一次调用时校准
+double statsTicksPerNs();
+
+// 对数线性分桶的直方图，值小于8时每个值一个桶，之后每个2的幂区间8个桶，2^40以上都记在最后一个桶
+class StatsHistogram {
+public:
+    static const int SUB_BITS = 3;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int MAX_BITS = 40;
+    static const int BUCKETS = SUB_COUNT + (MAX_BITS - SUB_BITS) * SUB_COUNT;
+
+    StatsHistogram() { reset(); }
+
+    void record(uint64_t value) {
+        bump(counts[bucketOf(value)], 1);
+        bump(sum, value);
+        if (value > max.load(std::memory_order_relaxed)) {
+            max.store(value, std::memory_order_relaxed);
+        }
+    }
+    // 去掉一次之前记录的value，用于同分玩家数这种会变小的分布；不维护总和和最大值
+    void unrecord(uint64_t value) { bump(counts[bucketOf(value)], uint64_t(-1)); }
+    void reset();
+    // 把另一个直方图加进来
+    void merge(const StatsHistogram& other);
+    // scale把记录的值换算成导出的单位
+    HistogramSummary summary(double scale) const;
+    uint64_t bucketCount(int bucket) const { return counts[bucket].load(std::memory_order_relaxed); }
+
+    static int bucketOf(uint64_t value) {
+        if (value < SUB_COUNT) {
+            return static_cast<int>(value);
+        }
+        int msb = highestBit(value);
+        if (msb >= MAX_BITS) {
+            return BUCKETS - 1;
+        }
+        return (msb - SUB_BITS + 1) * SUB_COUNT + static_cast<int>((value >> (msb - SUB_BITS)) & (SUB_COUNT - 1));
+    }
+    // 桶里最小的值
+    static uint64_t bucketLow(int bucket);
+
+private:
+    std::atomic<uint64_t> counts[BUCKETS];
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+
+    // 不是fetch_add：单线程时编译成普通的加法
+    static void bump(std::atomic<uint64_t>& counter, uint64_t delta) {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+    static int highestBit(uint64_t value) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<int>(index);
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+};
+
+// 一个排行榜的全部统计
+class BoardStats {
+public:
+    static const int MAX_LEVELS = 32;
+
+    // concurrentReads为true时读线程分多份计数器
+    explicit BoardStats(bool concurrentReads);
+    BoardStats(const BoardStats&) = delete;
+    BoardStats& operator=(const BoardStats&) = delete;
+
+    void recordOp(BoardOp op, uint64_t ticks) { shard().ops[static_cast<int>(op)].record(ticks); }
+    void recordVisits(int nodes) { shard().visits.record(static_cast<uint64_t>(nodes)); }
+    // 以下只由写线程调用
+    void nodeAdded(int height) { bumpLevel(height, 1); }
+    void nodeRemoved(int height) { bumpLevel(height, uint64_t(-1)); }
+    // 一个分数的同分玩家数从oldSize变成newSize，0表示没有这个分数
+    void tieGroupResized(int oldSize, int newSize) {
+        if (oldSize > 0) {
+            tieGroups.unrecord(static_cast<uint64_t>(oldSize));
+        }
+        if (newSize > 0) {
+            tieGroups.record(static_cast<uint64_t>(newSize));
+        }
+    }
+    // 清空排行榜时调用，结构统计归零，耗时和访问节点数保留
+    void resetStructure();
+    BoardStatsReport report() const;
+
+private:
+    struct alignas(64) Shard {
+        StatsHistogram ops[static_cast<int>(BoardOp::Count)];
+        StatsHistogram visits;
+    };
+    static const int CONCURRENT_SHARDS = 16;
+
+    int shardCount;
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<uint64_t> levels[MAX_LEVELS];
+    StatsHistogram tieGroups;
+
+    Shard& shard() const { return shards[shardCount == 1 ? 0 : threadSlot() % CONCURRENT_SHARDS]; }
+    // 每个线程第一次用到时分配一个编号
+    static int threadSlot();
+    void bumpLevel(int height, uint64_t delta) {
+        std::atomic<uint64_t>& counter = levels[height - 1];
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+};
+
+// 作用域计时，析构时记一次op的耗时
+class StatsTimer {
+public:
+    StatsTimer(BoardStats& stats, BoardOp op) : stats(stats), op(op), begin(statsTicks()) {}
+    ~StatsTimer() { stats.recordOp(op, statsTicks() - begin); }
+    StatsTimer(const StatsTimer&) = delete;
+    StatsTimer& operator=(const StatsTimer&) = delete;
+
+private:
+    BoardStats& stats;
+    BoardOp op;
+    uint64_t begin;
+};
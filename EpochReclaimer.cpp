@@ -0,0 +1,94 @@
+#include "EpochReclaimer.h"
+
+#include <atomic>
+#include <limits>
+
+namespace {
+
+const uint64_t IDLE = std::numeric_limits<uint64_t>::max();
+
+// 每个读线程一条，独占一个缓存行，避免读线程之间互相干扰
+struct alignas(64) ThreadRecord {
+    std::atomic<uint64_t> epoch{IDLE};  // 正在读时登记的epoch，不在读为IDLE
+    std::atomic<bool> used{false};      // 是否有线程占用
+    ThreadRecord* next = nullptr;
+};
+
+std::atomic<uint64_t> globalEpoch{1};
+std::atomic<ThreadRecord*> records{nullptr};  // 只增不减的无锁链表
+
+// 先复用退出线程留下的记录，没有再新建一条挂到链表头
+ThreadRecord* acquireRecord() {
+    for (ThreadRecord* r = records.load(std::memory_order_acquire); r; r = r->next) {
+        bool expected = false;
+        if (!r->used.load(std::memory_order_relaxed) && r->used.compare_exchange_strong(expected, true)) {
+            return r;
+        }
+    }
+    ThreadRecord* r = new ThreadRecord;
+    r->used.store(true, std::memory_order_relaxed);
+    r->next = records.load(std::memory_order_relaxed);
+    while (!records.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    return r;
+}
+
+struct LocalRecord {
+    ThreadRecord* record = nullptr;
+    int depth = 0;  // Guard嵌套层数，只有最外层登记epoch
+    ~LocalRecord() {
+        if (record) {
+            record->epoch.store(IDLE, std::memory_order_release);
+            record->used.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local LocalRecord local;
+
+}  // namespace
+
+EpochReclaimer::Guard::Guard(bool enabled) : enabled(enabled) {
+    if (!enabled || local.depth++ > 0) {
+        return;
+    }
+    if (!local.record) {
+        local.record = acquireRecord();
+    }
+    local.record->epoch.store(globalEpoch.load(std::memory_order_seq_cst), std::memory_order_relaxed);
+    // 登记必须先于之后对跳表的读取，和写线程回收时的fence配对
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+EpochReclaimer::Guard::~Guard() {
+    if (!enabled || --local.depth > 0) {
+        return;
+    }
+    local.record->epoch.store(IDLE, std::memory_order_release);
+}
+
+void EpochReclaimer::retire(void* p, size_t size) {
+    // 摘链的写入先于读取epoch，之后登记的读线程不可能再走到p
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    retired.push_back(Retired{p, size, globalEpoch.load(std::memory_order_relaxed)});
+}
+
+size_t EpochReclaimer::reclaim() {
+    globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t oldest = IDLE;
+    for (ThreadRecord* r = records.load(std::memory_order_acquire); r; r = r->next) {
+        uint64_t e = r->epoch.load(std::memory_order_acquire);
+        if (e < oldest) {
+            oldest = e;
+        }
+    }
+    // 正在读的线程登记的epoch都不小于oldest，它们开始读之前这些内存就已经摘下了
+    size_t freed = 0;
+    while (freed < retired.size() && retired[freed].epoch < oldest) {
+        pool->deallocate(retired[freed].p, retired[freed].size);
+        freed++;
+    }
+    retired.erase(retired.begin(), retired.begin() + freed);
+    return freed;
+}
@@ -0,0 +1,52 @@
+/*
+    基于epoch的内存回收，配合单写多读的跳表使用。
+    读线程进入读操作时用Guard把当前全局epoch登记到自己的线程记录里，离开时清掉，全程不加锁。
+    写线程把节点从跳表中摘下后不立即释放，而是带着当时的全局epoch放进待回收列表；
+    回收时先推进全局epoch，再找出所有正在读的线程登记的最小epoch，比它小的节点不可能再被读到，还给内存池。
+    线程记录是全局的无锁链表，线程退出后记录留给后来的线程复用。
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SlabAllocator.h"
+
+class EpochReclaimer {
+public:
+    // 读线程的临界区，可以嵌套；enabled为false时什么都不做
+    class Guard {
+    public:
+        explicit Guard(bool enabled);
+        ~Guard();
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    private:
+        bool enabled;
+    };
+
+    // 待回收的内存最终还给pool
+    explicit EpochReclaimer(SlabAllocator* pool) : pool(pool) {}
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    // 写线程：p已经对读线程不可达，等所有可能看到它的读线程离开后再释放，size同allocate
+    void retire(void* p, size_t size);
+    // 写线程：释放已经没有读线程能看到的内存，返回释放的个数
+    size_t reclaim();
+    // 还没释放的个数
+    size_t pending() const { return retired.size(); }
+    // 内存池整体释放时，待回收列表一起作废
+    void forget() { retired.clear(); }
+
+private:
+    struct Retired {
+        void* p;
+        size_t size;
+        uint64_t epoch;
+    };
+
+    SlabAllocator* pool;
+    std::vector<Retired> retired;  // epoch非递减
+};
@@ -0,0 +1,104 @@
+/*
+    玩家句柄到指针的开放寻址哈希表，给共用玩家id表的小排行榜做索引。
+    句柄是整个玩家id表统一分配的，小排行榜里只有少数玩家，按句柄开数组会按全局的玩家数占内存。
+    线性探测；删除时只把值置空、键留着，同一个玩家再插入时直接复用；扩容时丢掉值为空的槽。
+    不支持并发读。
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PlayerTable.h"
+
+template <class V>
+class HandleMap {
+public:
+    // 不存在返回空值
+    V get(PlayerHandle key) const {
+        if (slots.empty()) {
+            return V();
+        }
+        for (size_t i = slotOf(key);; i = (i + 1) & mask) {
+            if (slots[i].key == key) {
+                return slots[i].value;
+            }
+            if (slots[i].key == PlayerTable::INVALID) {
+                return V();
+            }
+        }
+    }
+    // value为空值即删除
+    void set(PlayerHandle key, V value) {
+        if (!slots.empty()) {
+            size_t i = slotOf(key);
+            for (; slots[i].key != PlayerTable::INVALID; i = (i + 1) & mask) {
+                if (slots[i].key == key) {
+                    live += (value != V()) - (slots[i].value != V());
+                    slots[i].value = value;
+                    return;
+                }
+            }
+        }
+        if (value == V()) {
+            return;
+        }
+        // 装载率超过3/4时按存活的个数重建
+        if ((used + 1) * 4 > slots.size() * 3) {
+            rehash();
+        }
+        size_t i = slotOf(key);
+        while (slots[i].key != PlayerTable::INVALID) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = Slot{key, value};
+        used++;
+        live++;
+    }
+    void clear() {
+        std::vector<Slot>().swap(slots);
+        mask = 0;
+        used = 0;
+        live = 0;
+    }
+    size_t size() const { return live; }
+    size_t memoryBytes() const { return slots.capacity() * sizeof(Slot); }
+
+private:
+    struct Slot {
+        PlayerHandle key;
+        V value;
+    };
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    size_t used = 0;  // 键不为空的槽，包括值已经置空的
+    size_t live = 0;  // 值不为空的槽
+
+    size_t slotOf(PlayerHandle key) const {
+        return static_cast<size_t>((uint64_t(key) * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    }
+
+    void rehash() {
+        size_t size = 16;
+        while (size < (live + 1) * 2) {
+            size *= 2;
+        }
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.assign(size, Slot{PlayerTable::INVALID, V()});
+        mask = size - 1;
+        used = 0;
+        for (const Slot& slot : old) {
+            if (slot.key != PlayerTable::INVALID && slot.value != V()) {
+                size_t i = slotOf(slot.key);
+                while (slots[i].key != PlayerTable::INVALID) {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = slot;
+                used++;
+            }
+        }
+    }
+};
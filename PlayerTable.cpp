@@ -0,0 +1,103 @@
+#include "PlayerTable.h"
+
+#include <cstring>
+#include <functional>
+
+PlayerTable::PlayerTable() {
+    tables.emplace_back(newSlots(64));
+    slots.store(tables.back().get(), std::memory_order_release);
+}
+
+PlayerTable::Slots* PlayerTable::newSlots(size_t size) {
+    Slots* t = new Slots{size - 1, std::unique_ptr<std::atomic<PlayerHandle>[]>(new std::atomic<PlayerHandle>[size])};
+    for (size_t i = 0; i < size; i++) {
+        t->slot[i].store(INVALID, std::memory_order_relaxed);
+    }
+    return t;
+}
+
+uint32_t PlayerTable::hashOf(std::string_view playerId) {
+    size_t h = std::hash<std::string_view>()(playerId);
+    return static_cast<uint32_t>(h ^ (h >> 32));
+}
+
+PlayerHandle PlayerTable::lookup(std::string_view playerId) const {
+    uint32_t hash = hashOf(playerId);
+    const Slots* t = slots.load(std::memory_order_acquire);
+    for (size_t i = hash & t->mask;; i = (i + 1) & t->mask) {
+        PlayerHandle handle = t->slot[i].load(std::memory_order_acquire);
+        if (handle == INVALID) {
+            return INVALID;
+        }
+        const Name& n = names[handle];
+        if (n.hash == hash && std::string_view(n.data, n.length) == playerId) {
+            return handle;
+        }
+    }
+}
+
+PlayerHandle PlayerTable::intern(std::string_view playerId) {
+    uint32_t hash = hashOf(playerId);
+    Slots* t = slots.load(std::memory_order_relaxed);
+    size_t i = hash & t->mask;
+    for (;; i = (i + 1) & t->mask) {
+        PlayerHandle handle = t->slot[i].load(std::memory_order_relaxed);
+        if (handle == INVALID) {
+            break;
+        }
+        const Name& n = names[handle];
+        if (n.hash == hash && std::string_view(n.data, n.length) == playerId) {
+            return handle;
+        }
+    }
+    // 先写好字符串和句柄表，再发布到槽里，读线程看到句柄时字符串一定已经就绪
+    PlayerHandle handle = count.load(std::memory_order_relaxed);
+    names.reserve(size_t(handle) + 1);
+    names[handle] = Name{store(playerId), static_cast<uint32_t>(playerId.size()), hash};
+    count.store(handle + 1, std::memory_order_release);
+    t->slot[i].store(handle, std::memory_order_release);
+    // 装载因子超过1/2就扩容
+    if ((size_t(handle) + 1) * 2 > t->mask + 1) {
+        grow();
+    }
+    return handle;
+}
+
+const char* PlayerTable::store(std::string_view playerId) {
+    if (cursor == nullptr || playerId.size() > chunkLeft) {
+        size_t bytes = playerId.size() > CHUNK_BYTES ? playerId.size() : CHUNK_BYTES;
+        chunks.emplace_back(new char[bytes]);
+        cursor = chunks.back().get();
+        chunkLeft = bytes;
+        chunkBytes += bytes;
+    }
+    char* data = cursor;
+    std::memcpy(data, playerId.data(), playerId.size());
+    cursor += playerId.size();
+    chunkLeft -= playerId.size();
+    return data;
+}
+
+// 新的槽数组填好之后再发布，老的留给可能还在查找的读线程
+void PlayerTable::grow() {
+    const Slots* old = slots.load(std::memory_order_relaxed);
+    Slots* bigger = newSlots((old->mask + 1) * 2);
+    PlayerHandle n = count.load(std::memory_order_relaxed);
+    for (PlayerHandle handle = 0; handle < n; handle++) {
+        size_t i = names[handle].hash & bigger->mask;
+        while (bigger->slot[i].load(std::memory_order_relaxed) != INVALID) {
+            i = (i + 1) & bigger->mask;
+        }
+        bigger->slot[i].store(handle, std::memory_order_relaxed);
+    }
+    tables.emplace_back(bigger);
+    slots.store(bigger, std::memory_order_release);
+}
+
+size_t PlayerTable::memoryBytes() const {
+    size_t bytes = names.memoryBytes() + chunkBytes;
+    for (const std::unique_ptr<Slots>& t : tables) {
+        bytes += (t->mask + 1) * sizeof(PlayerHandle);
+    }
+    return bytes;
+}
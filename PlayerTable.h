@@ -0,0 +1,73 @@
+/*
+    玩家id字符串和32位句柄的映射表（字符串驻留）。
+    句柄从0开始连续分配，跳表节点里只存句柄，比较和拷贝都是整数操作。
+    字符串统一存放在按块分配的字符数组里，地址不会变化，name()返回的string_view一直有效。
+    哈希表为开放寻址，槽里存句柄，冲突时先比较缓存的hash再比较字符串。
+    只允许一个线程intern，但lookup和name可以在其他线程并发调用：句柄表是分段数组不会搬移，
+    槽数组扩容时新建一份再整体发布，老的槽数组保留到表析构（总共不超过当前槽数组的大小）。
+*/
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SegmentedArray.h"
+
+using PlayerHandle = uint32_t;
+
+class PlayerTable {
+public:
+    static constexpr PlayerHandle INVALID = 0xFFFFFFFF;
+
+    PlayerTable();
+    PlayerTable(const PlayerTable&) = delete;
+    PlayerTable& operator=(const PlayerTable&) = delete;
+
+    // 查找玩家句柄，不存在则分配一个新的
+    PlayerHandle intern(std::string_view playerId);
+    // 只查找不分配，不存在返回INVALID
+    PlayerHandle lookup(std::string_view playerId) const;
+    // 句柄对应的玩家id
+    std::string_view name(PlayerHandle handle) const {
+        const Name& n = names[handle];
+        return std::string_view(n.data, n.length);
+    }
+    // 已分配的句柄个数
+    size_t size() const { return count.load(std::memory_order_acquire); }
+    // 占用的内存
+    size_t memoryBytes() const;
+
+private:
+    static constexpr size_t CHUNK_BYTES = 64 * 1024;
+
+    struct Name {
+        const char* data;
+        uint32_t length;
+        uint32_t hash;
+    };
+
+    // 开放寻址哈希表，INVALID为空槽
+    struct Slots {
+        size_t mask;
+        std::unique_ptr<std::atomic<PlayerHandle>[]> slot;
+    };
+
+    SegmentedArray<Name> names;                 // 句柄 -> 字符串
+    std::atomic<uint32_t> count{0};             // 已发布的句柄个数
+    std::atomic<Slots*> slots;                  // 当前的槽数组
+    std::vector<std::unique_ptr<Slots>> tables; // 所有槽数组，包括扩容前的
+    std::vector<std::unique_ptr<char[]>> chunks;  // 字符串存储块
+    char* cursor = nullptr;
+    size_t chunkLeft = 0;
+    size_t chunkBytes = 0;                      // 所有存储块的总大小
+
+    static uint32_t hashOf(std::string_view playerId);
+    static Slots* newSlots(size_t size);
+    const char* store(std::string_view playerId);
+    void grow();
+};
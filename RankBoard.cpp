@@ -1,84 +1,494 @@
 #include "RankBoard.h"
+#include "RankDeltaFeed.h"
+#include "RankSnapshot.h"
 
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <new>
+#include <thread>
+
+uint64_t SkipList::nextRandom() {
+    uint64_t z = (rngState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// 层数按p=1/4的几何分布生成，和redis一样，平均每个节点约1.33层
+// 一次随机数每两位决定是否再升一层
 int SkipList::randomLevel() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dis(1, MAX_LVL);
-    return dis(gen);
+    uint64_t bits = nextRandom();
+    int height = 1;
+    while (height < MAX_LVL && (bits & 3) == 0) {
+        height++;
+        bits >>= 2;
+    }
+    return height;
 }
 
-SkipListNode* SkipList::find(const std::string& playerid) {
-    SkipListNode* curr = head;
-    while (curr->next[0] && curr->next[0]->playerid!= playerid) {
-        curr = curr->next[0];
+SkipListNode* SkipList::createNode(int height, int64_t score, PlayerHandle player, time_t timestamp) {
+    void* mem = pool.allocate(sizeof(SkipListNode) + height * sizeof(SkipListLevel));
+    return new (mem) SkipListNode(score, player, timestamp, height);
+}
+
+// 并发读时读线程可能还拿着这个节点，交给epoch回收
+void SkipList::freeNode(SkipListNode* node) {
+    size_t size = sizeof(SkipListNode) + node->height * sizeof(SkipListLevel);
+    if (concurrent) {
+        reclaimer.retire(node, size);
+    } else {
+        pool.deallocate(node, size);
+    }
+}
+
+// 节点里没有需要析构的成员，直接整体释放内存池
+// 并发读时读线程可能还在遍历，只能先把头节点和索引清空，再把原来的节点逐个交给epoch回收
+void SkipList::clear() {
+    RANKBOARD_STATS_ONLY(counters.resetStructure();)
+    if (!concurrent) {
+        reclaimer.forget();
+        pool.release();
+        index.reset();
+        handleIndex.clear();
+        length = 0;
+        level = 1;
+        head = createNode(MAX_LVL, 0, PlayerTable::INVALID, 0);
+        return;
+    }
+    SkipListNode* curr = head->level[0].forward;
+    for (int i = 0; i < MAX_LVL; i++) {
+        head->level[i].forward = nullptr;
+        head->level[i].span = 0;
+    }
+    length = 0;
+    level = 1;
+    for (size_t i = 0; i < index.capacity(); i++) {
+        index[i] = nullptr;
+    }
+    while (curr) {
+        SkipListNode* next = curr->level[0].forward;
+        freeNode(curr);
+        curr = next;
+    }
+}
+
+void SkipList::beginWrite() {
+    version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (!concurrent) {
+        return;
+    }
+    // 奇数版本号先于之后对跳表的修改被读线程看到
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void SkipList::endWrite() {
+    version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    if (!concurrent) {
+        return;
+    }
+    // 攒够一批再回收，摊薄扫描读线程记录的开销
+    if (reclaimer.pending() >= 1024) {
+        reclaimer.reclaim();
+    }
+}
+
+uint64_t SkipList::readBegin() const {
+    if (!concurrent) {
+        return version.load(std::memory_order_relaxed);
+    }
+    uint64_t v = version.load(std::memory_order_acquire);
+    while (v & 1) {
+        std::this_thread::yield();
+        v = version.load(std::memory_order_acquire);
+    }
+    return v;
+}
+
+bool SkipList::readRetry(uint64_t v) const {
+    if (!concurrent) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version.load(std::memory_order_relaxed) != v;
+}
+
+MemoryStats SkipList::memoryStats() const {
+    MemoryStats stats;
+    stats.players = length;
+    stats.reservedBytes = pool.bytesReserved();
+    stats.usedBytes = pool.bytesInUse();
+    stats.indexBytes = hashed ? handleIndex.memoryBytes() : index.memoryBytes();
+    stats.playerTableBytes = players->memoryBytes();
+    return stats;
+}
+
+// 键1是否排在键2之前：分数高的在前，同分时间戳小的在前，都相同再按playerid排，保证全序
+bool SkipList::keyBefore(int64_t score1, time_t timestamp1, PlayerHandle player1,
+                         int64_t score2, time_t timestamp2, PlayerHandle player2) const {
+    if (score1 != score2) {
+        return score1 > score2;
+    }
+    if (timestamp1 != timestamp2) {
+        return timestamp1 < timestamp2;
+    }
+    return players->name(player1) < players->name(player2);
+}
+
+bool SkipList::rankBefore(const SkipListNode* a, int64_t score, time_t timestamp, PlayerHandle player) const {
+    return keyBefore(a->score, a->timestamp, a->player, score, timestamp, player);
+}
+
+// 键里的玩家可能不在这个跳表的玩家表里，直接比较playerid
+bool SkipList::rankBefore(const SkipListNode* a, int64_t score, time_t timestamp, std::string_view playerId) const {
+    if (a->score != score) {
+        return a->score > score;
+    }
+    if (a->timestamp != timestamp) {
+        return a->timestamp < timestamp;
     }
-    return curr->next[0];
+    return players->name(a->player) < playerId;
 }
-int SkipList::getRank(const std::string& playerid) {
+
+SkipListNode* SkipList::find(PlayerHandle player) {
+    if (hashed) {
+        return handleIndex.get(player);
+    }
+    if (player >= index.capacity()) {
+        return nullptr;
+    }
+    return index[player];
+}
+int SkipList::getRank(PlayerHandle player) {
+    SkipListNode* node = find(player);
+    if (!node) {
+        return -1;
+    }
+    // 从上往下累加span，直到走到节点自己
+    // 并发读时前进指针随时可能被写线程改掉，每一步只读一次，判断和前进用同一个值
     SkipListNode* curr = head;
+    SkipListNode* next;
     int rank = 0;
-    while (curr->next[0] && curr->next[0]->playerid!= playerid) {
-        curr = curr->next[0];
-        rank++;
-    }
-    if (curr->next[0]){
-        return rank;
+    RANKBOARD_STATS_ONLY(int visited = 0;)
+    for (int i = level-1; i >= 0; i--) {
+        while ((next = curr->level[i].forward) &&
+               (next == node || rankBefore(next, node->score, node->timestamp, node->player))) {
+            rank += curr->level[i].span;
+            curr = next;
+            RANKBOARD_STATS_ONLY(visited++;)
+        }
+        RANKBOARD_STATS_ONLY(visited++;)
+        if (curr == node) {
+            RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+            return rank - 1;
+        }
     }
+    RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
     return -1;
 }
-void SkipList::insert(int64_t score, const std::string& playerid, time_t timestamp) {
-    SkipListNode* newNode = new SkipListNode(score, playerid, timestamp);
-    int level = randomLevel();
-    //std::cout<< "level="<<level<<std::endl;
-    SkipListNode* update[MAX_LVL];
-    for (int i = 0; i < MAX_LVL; i++) {
-        update[i] = nullptr;
+int SkipList::countBefore(int64_t score, time_t timestamp, std::string_view playerId) const {
+    const SkipListNode* curr = head;
+    const SkipListNode* next;
+    int rank = 0;
+    RANKBOARD_STATS_ONLY(int visited = level;)
+    for (int i = level-1; i >= 0; i--) {
+        while ((next = curr->level[i].forward) && rankBefore(next, score, timestamp, playerId)) {
+            rank += curr->level[i].span;
+            curr = next;
+            RANKBOARD_STATS_ONLY(visited++;)
+        }
     }
-    //找到每一层链表中的前置节点
+    RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+    return rank;
+}
+
+SkipListNode* SkipList::firstAfter(int64_t score, time_t timestamp, std::string_view playerId, int& before) {
+    // 和键相同的节点也要跨过去
+    auto notAfter = [this, score, timestamp, playerId](const SkipListNode* node) {
+        if (node->score != score) {
+            return node->score > score;
+        }
+        if (node->timestamp != timestamp) {
+            return node->timestamp < timestamp;
+        }
+        return players->name(node->player) <= playerId;
+    };
     SkipListNode* curr = head;
-    for (int i = MAX_LVL-1 ; i >= 0; i--) {
-        while (curr->next[i] && (curr->next[i]->score > score ||(curr->next[i]->score == score && curr->next[i]->timestamp < timestamp ) ) ) {
-            curr = curr->next[i];
+    SkipListNode* next;
+    before = 0;
+    RANKBOARD_STATS_ONLY(int visited = level;)
+    for (int i = level-1; i >= 0; i--) {
+        while ((next = curr->level[i].forward) && notAfter(next)) {
+            before += curr->level[i].span;
+            curr = next;
+            RANKBOARD_STATS_ONLY(visited++;)
         }
-        update[i] = curr;
     }
-    // 在前level层链表中插入新节点
-    for (int i = 0; i < level; i++) {
-        newNode->next[i] = update[i]->next[i];
-        update[i]->next[i] = newNode;
+    RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+    return curr->level[0].forward;
+}
+
+SkipListNode* SkipList::firstAtMost(int64_t score, int& before) {
+    SkipListNode* curr = head;
+    SkipListNode* next;
+    before = 0;
+    RANKBOARD_STATS_ONLY(int visited = level;)
+    for (int i = level-1; i >= 0; i--) {
+        while ((next = curr->level[i].forward) && next->score > score) {
+            before += curr->level[i].span;
+            curr = next;
+            RANKBOARD_STATS_ONLY(visited++;)
+        }
     }
+    RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+    return curr->level[0].forward;
 }
 
-void SkipList::remove(const std::string& playerid) {
-    SkipListNode* node =  find(playerid);
-    if (!node){
-        return;
+SkipListNode* SkipList::getNodeByRank(int rank) {
+    if (rank < 1 || rank > length) {
+        return nullptr;
     }
-    SkipListNode* update[MAX_LVL];
+    SkipListNode* curr = head;
+    SkipListNode* next;
+    int traversed = 0;
+    RANKBOARD_STATS_ONLY(int visited = 0;)
+    for (int i = level-1; i >= 0; i--) {
+        int span;
+        while ((next = curr->level[i].forward) && traversed + (span = curr->level[i].span) <= rank) {
+            traversed += span;
+            curr = next;
+            RANKBOARD_STATS_ONLY(visited++;)
+        }
+        RANKBOARD_STATS_ONLY(visited++;)
+        if (traversed == rank) {
+            RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+            return curr;
+        }
+    }
+    RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+    return nullptr;
+}
+void SkipList::resetFinger(Finger& finger) {
     for (int i = 0; i < MAX_LVL; i++) {
-        update[i] = nullptr;
+        finger.update[i] = head;
+        finger.rank[i] = 0;
     }
+}
 
-    for (int i = MAX_LVL-1; i >= 0; i--) {
-        SkipListNode* curr = head;
-        while (curr->next[i] && curr->next[i]->playerid != playerid) {
-            curr = curr->next[i];
+// 手指里每一层都是排序键不大于上一个键的最后一个节点，新键只会更靠后。
+// 某一层需要前进时，它下面的层也一定需要前进，所以从第0层往上找到最高需要前进的层，
+// 只从这一层开始往下找，和上一个键离得越近走得越少
+void SkipList::seek(Finger& finger, int64_t score, time_t timestamp, PlayerHandle player) {
+    int top = -1;
+    while (top + 1 < level) {
+        SkipListNode* forward = finger.update[top+1]->level[top+1].forward;
+        if (!forward || !rankBefore(forward, score, timestamp, player)) {
+            break;
         }
-        update[i] = curr;
+        top++;
     }
-    for (int i = 0; i < MAX_LVL; i++) {
-        if (update[i]->next[i]  && update[i]->next[i] == node) {
-            update[i]->next[i] = node->next[i];
+    if (top < 0) {
+        return;
+    }
+    SkipListNode* curr = finger.update[top];
+    int rank = finger.rank[top];
+    RANKBOARD_STATS_ONLY(int visited = top + 2;)
+    for (int i = top; i >= 0; i--) {
+        // 下层原来的位置可能比从上层走下来的位置更靠后
+        if (finger.rank[i] > rank) {
+            curr = finger.update[i];
+            rank = finger.rank[i];
+        }
+        while (curr->level[i].forward && rankBefore(curr->level[i].forward, score, timestamp, player)) {
+            rank += curr->level[i].span;
+            curr = curr->level[i].forward;
+            RANKBOARD_STATS_ONLY(visited++;)
+        }
+        finger.update[i] = curr;
+        finger.rank[i] = rank;
+    }
+    RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+}
+
+// 手指第0层的节点排在新键之后，越往上的层前置节点越靠前，找到第一个排在新键之前的层(头节点总是)，
+// 这一层以上的前置节点不用动，以下的从这一层的节点往后找；离原来的位置越近，往上走的层数越少
+void SkipList::seekBack(Finger& finger, int64_t score, time_t timestamp, PlayerHandle player) {
+    int top = 0;
+    while (finger.update[top] != head && !rankBefore(finger.update[top], score, timestamp, player)) {
+        top++;
+    }
+    SkipListNode* curr = finger.update[top];
+    int rank = finger.rank[top];
+    RANKBOARD_STATS_ONLY(int visited = top + 1;)
+    for (int i = top - 1; i >= 0; i--) {
+        while (curr->level[i].forward && rankBefore(curr->level[i].forward, score, timestamp, player)) {
+            rank += curr->level[i].span;
+            curr = curr->level[i].forward;
+            RANKBOARD_STATS_ONLY(visited++;)
         }
+        finger.update[i] = curr;
+        finger.rank[i] = rank;
+    }
+    RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+}
+
+void SkipList::linkAt(Finger& finger, SkipListNode* node) {
+    SkipListNode** update = finger.update;
+    int* rank = finger.rank;
+    int height = node->height;
+    // 节点比当前最高层还高，新增的层前置节点都是头节点
+    if (height > level) {
+        for (int i = level; i < height; i++) {
+            rank[i] = 0;
+            update[i] = head;
+            update[i]->level[i].span = length;
+        }
+        level = height;
+    }
+    // 在前height层链表中挂上节点，拆分前置节点的span
+    for (int i = 0; i < height; i++) {
+        node->level[i].forward = update[i]->level[i].forward;
+        update[i]->level[i].forward = node;
+        node->level[i].span = update[i]->level[i].span - (rank[0] - rank[i]);
+        update[i]->level[i].span = (rank[0] - rank[i]) + 1;
+    }
+    // 更高的层跨过了这个节点
+    for (int i = height; i < level; i++) {
+        update[i]->level[i].span++;
+    }
+    // 节点成为这几层的前置节点，后面更靠后的键从这里继续找
+    int newRank = rank[0] + 1;
+    for (int i = 0; i < height; i++) {
+        update[i] = node;
+        rank[i] = newRank;
+    }
+    length++;
+}
+
+void SkipList::unlinkAt(Finger& finger, SkipListNode* node) {
+    SkipListNode** update = finger.update;
+    for (int i = 0; i < level; i++) {
+        if (update[i]->level[i].forward == node) {
+            update[i]->level[i].span += node->level[i].span - 1;
+            update[i]->level[i].forward = node->level[i].forward;
+        } else {
+            update[i]->level[i].span--;
+        }
+    }
+    // 最高层空了就降层
+    while (level > 1 && head->level[level-1].forward == nullptr) {
+        level--;
+    }
+    length--;
+}
+
+void SkipList::insertAt(Finger& finger, int64_t score, PlayerHandle player, time_t timestamp) {
+    int height = randomLevel();
+    SkipListNode* newNode = createNode(height, score, player, timestamp);
+    RANKBOARD_STATS_ONLY(counters.nodeAdded(height);)
+    linkAt(finger, newNode);
+    if (hashed) {
+        handleIndex.set(player, newNode);
+        return;
+    }
+    if (player >= index.capacity()) {
+        index.reserve(players->size());
+    }
+    index[player] = newNode;
+}
+
+void SkipList::removeAt(Finger& finger, SkipListNode* node) {
+    unlinkAt(finger, node);
+    if (hashed) {
+        handleIndex.set(node->player, nullptr);
+    } else {
+        index[node->player] = nullptr;
+    }
+    RANKBOARD_STATS_ONLY(counters.nodeRemoved(node->height);)
+    freeNode(node);
+}
+
+int SkipList::insert(int64_t score, PlayerHandle player, time_t timestamp) {
+    //找到每一层链表中的前置节点，从当前最高层开始
+    Finger finger;
+    resetFinger(finger);
+    seek(finger, score, timestamp, player);
+    insertAt(finger, score, player, timestamp);
+    return finger.rank[0];
+}
+
+// 节点没有后退指针，前置节点还是要从上往下找一次(和remove一样)；之后只在原来的位置附近动：
+// 和前后节点的顺序不变时原地改排序键，否则摘下节点，往后挪用seek、往前挪用seekBack从手指接着找，再挂回去
+int SkipList::reposition(SkipListNode* node, int64_t score, time_t timestamp) {
+    PlayerHandle player = node->player;
+    Finger finger;
+    resetFinger(finger);
+    seek(finger, node->score, node->timestamp, player);
+    SkipListNode* prev = finger.update[0];
+    SkipListNode* next = node->level[0].forward;
+    bool afterPrev = prev == head || rankBefore(prev, score, timestamp, player);
+    if (afterPrev && (!next || keyBefore(score, timestamp, player, next->score, next->timestamp, next->player))) {
+        node->score = score;
+        node->timestamp = timestamp;
+        return finger.rank[0] + 1;
+    }
+    unlinkAt(finger, node);
+    node->score = score;
+    node->timestamp = timestamp;
+    if (afterPrev) {
+        seek(finger, score, timestamp, player);
+    } else {
+        seekBack(finger, score, timestamp, player);
     }
-    delete node;
+    linkAt(finger, node);
+    return finger.rank[0];
+}
+
+void SkipList::remove(PlayerHandle player) {
+    SkipListNode* node =  find(player);
+    if (!node){
+        return;
+    }
+    // 按节点自身的排序键从上往下找前置节点
+    Finger finger;
+    resetFinger(finger);
+    seek(finger, node->score, node->timestamp, node->player);
+    removeAt(finger, node);
+}
+
+void SkipList::insertSorted(const std::vector<SkipListEntry>& entries) {
+    Finger finger;
+    resetFinger(finger);
+    for (const SkipListEntry& entry : entries) {
+        seek(finger, entry.score, entry.timestamp, entry.player);
+        insertAt(finger, entry.score, entry.player, entry.timestamp);
+    }
+}
+
+void SkipList::removeSorted(const std::vector<SkipListNode*>& nodes) {
+    Finger finger;
+    resetFinger(finger);
+    for (SkipListNode* node : nodes) {
+        seek(finger, node->score, node->timestamp, node->player);
+        removeAt(finger, node);
+    }
+}
+
+void SkipList::beginAppend() {
+    resetFinger(tail);
+}
+
+// 键比手指上的所有节点都靠后，seek不会移动，只剩insertAt的O(层数)
+void SkipList::append(int64_t score, PlayerHandle player, time_t timestamp) {
+    insertAt(tail, score, player, timestamp);
 }
 
 void SkipList::print() {
-    SkipListNode* curr = head->next[0];
+    SkipListNode* curr = head->level[0].forward;
     while (curr) {
-        std::cout << curr->score << " " << curr->playerid << " " << curr->timestamp << std::endl; 
-        curr = curr->next[0];
+        std::cout << curr->score << " " << players->name(curr->player) << " " << curr->timestamp << std::endl; 
+        curr = curr->level[0].forward;
     }
 }
 
@@ -90,157 +500,780 @@ void RankBoard::print(){
     skipList.print();
 }
 
+SkipListNode* RankBoard::getHeadNode(){
+    return skipList.getHeadNode();
+}
+
+void RankBoard::clear(){
+    skipList.beginWrite();
+    skipList.clear();
+    skipList.endWrite();
+    if (deltaFeed) {
+        deltaFeed->appendClear();
+    }
+    if (topK > 0) {
+        rebuildTopK();
+    }
+}
+
+MemoryStats RankBoard::memoryStats() const{
+    return skipList.memoryStats();
+}
+
+BoardStatsReport RankBoard::stats() const {
+#ifdef RANKBOARD_STATS
+    return skipList.boardStats().report();
+#else
+    return BoardStatsReport();
+#endif
+}
+
+std::shared_ptr<const RankSnapshot> RankBoard::snapshot() {
+    auto snapshot = std::make_shared<RankSnapshot>(players, ++snapshots, skipList.size());
+    for (SkipListNode* cur = skipList.getHeadNode()->level[0].forward; cur; cur = cur->level[0].forward) {
+        snapshot->append(cur->score, cur->timestamp, cur->player);
+    }
+    return snapshot;
+}
+
+bool RankBoard::dump(const std::string& path, uint64_t sequence) {
+    DumpWriter writer;
+    if (!writer.open(path, DUMP_SPARSE, sequence)) {
+        return false;
+    }
+    for (SkipListNode* cur = skipList.getHeadNode()->level[0].forward; cur; cur = cur->level[0].forward) {
+        writer.append(cur->score, cur->timestamp, players->name(cur->player));
+    }
+    return writer.finish();
+}
+
+// 文件里的记录已经按排名排好，直接从尾部追加，不走insert的查找
+bool RankBoard::load(const std::string& path, uint64_t* sequence, std::string* error) {
+    DumpReader reader;
+    if (!reader.open(path, error)) {
+        return false;
+    }
+    skipList.beginWrite();
+    skipList.clear();
+    skipList.beginAppend();
+    DumpReader::Record record;
+    while (reader.next(record)) {
+        skipList.append(record.score, players->intern(record.playerId), record.timestamp);
+    }
+    skipList.endWrite();
+    if (topK > 0) {
+        rebuildTopK();
+    }
+    feedReload();
+    if (sequence) {
+        *sequence = reader.getHeader().sequence;
+    }
+    return true;
+}
+
+void RankBoard::loadSorted(const std::vector<SkipListEntry>& entries) {
+    skipList.beginWrite();
+    skipList.clear();
+    skipList.beginAppend();
+    for (const SkipListEntry& e : entries) {
+        skipList.append(e.score, e.player, e.timestamp);
+    }
+    skipList.endWrite();
+    if (topK > 0) {
+        rebuildTopK();
+    }
+    feedReload();
+}
+
+void RankBoard::setDeltaFeed(RankDeltaFeed* feed) {
+    deltaFeed = feed;
+    if (deltaFeed) {
+        deltaFeed->bind(players);
+    }
+}
+
+// 整体替换了内容：增量流里记一次清空，再按排名顺序每个玩家记一条插入
+void RankBoard::feedReload() {
+    if (!deltaFeed) {
+        return;
+    }
+    deltaFeed->appendClear();
+    for (SkipListNode* cur = skipList.getHeadNode()->level[0].forward; cur; cur = cur->level[0].forward) {
+        deltaFeed->append(DeltaKind::Insert, cur->player, 0, cur->score, cur->timestamp);
+    }
+}
+
+bool RankBoard::checkpoint(const std::string& dumpPath) {
+    if (!journal) {
+        return false;
+    }
+    // 写线程调用，这之后的更新序号都比它大
+    uint64_t sequence = journal->lastSequence();
+    // dump返回true时新转储已经落盘并替换了旧的，这之后才能去掉日志里它包含的记录
+    return dump(dumpPath, sequence) && journal->compact(sequence);
+}
+
+bool RankBoard::recover(const std::string& dumpPath, const std::string& journalPath, std::string* error) {
+    uint64_t sequence = 0;
+    if (FILE* file = std::fopen(dumpPath.c_str(), "rb")) {
+        std::fclose(file);
+        if (!load(dumpPath, &sequence, error)) {
+            return false;
+        }
+    } else {
+        clear();
+    }
+    // 回放时不再写日志
+    RankJournal* attached = journal;
+    journal = nullptr;
+    RankJournal::replay(journalPath, sequence, [this](uint64_t, std::string_view playerId, int64_t score, int64_t timestamp) {
+        updateScore(players->intern(playerId), score, static_cast<time_t>(timestamp));
+    });
+    journal = attached;
+    return true;
+}
+
+void RankBoard::fillRankInfo(RankInfo& info, const SkipListNode* node) const {
+    info.playerId = players->name(node->player);
+    info.score = node->score;
+    info.timestamp = node->timestamp;
+}
+
+void RankBoard::fillRankView(RankView& view, const SkipListNode* node, int rank) const {
+    view.playerId = players->name(node->player);
+    view.score = node->score;
+    view.timestamp = node->timestamp;
+    view.rank = rank;
+}
+
+PlayerHandle RankBoard::getHandle(const std::string& playerId) {
+    return players->intern(playerId);
+}
+
 void RankBoard::updateScore(const std::string& playerId, int64_t newScore,time_t timestamp) {
-    SkipListNode* node =  skipList.find(playerId);
-    if (node == nullptr) {
-        // 不存在则添加新玩家，赋予当前时间戳
-        skipList.insert(newScore,playerId,timestamp);
+    updateScore(players->intern(playerId), newScore, timestamp);
+}
+
+void RankBoard::updateScore(PlayerHandle player, int64_t newScore, time_t timestamp) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::UpdateScore);)
+    setScore(player, newScore, timestamp);
+}
+
+RankView RankBoard::incrementScore(const std::string& playerId, int64_t delta, time_t timestamp) {
+    return incrementScore(players->intern(playerId), delta, timestamp);
+}
+
+RankView RankBoard::incrementScore(PlayerHandle player, int64_t delta, time_t timestamp) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::IncrementScore);)
+    SkipListNode* node = skipList.find(player);
+    int64_t oldScore = node ? node->score : 0;
+    // 溢出时饱和到int64的上下界，先比较再相加，不会有有符号溢出
+    int64_t newScore;
+    if (delta > 0 && oldScore > INT64_MAX - delta) {
+        newScore = INT64_MAX;
+    } else if (delta < 0 && oldScore < INT64_MIN - delta) {
+        newScore = INT64_MIN;
+    } else {
+        newScore = oldScore + delta;
+    }
+    int rank = setScore(player, newScore, timestamp);
+    return RankView{players->name(player), newScore, timestamp, rank};
+}
+
+// 日志和增量流里记的是加完之后的分数，回放和副本都按updateScore处理
+int RankBoard::setScore(PlayerHandle player, int64_t newScore, time_t timestamp) {
+    if (journal) {
+        journal->append(players->name(player), newScore, timestamp);
+    }
+    // 老节点删除后就可能被回收，先记下它的排序键
+    SkipListEntry old{};
+    SkipListNode* oldNode = topK > 0 || deltaFeed ? skipList.find(player) : nullptr;
+    if (oldNode) {
+        old = SkipListEntry{oldNode->score, oldNode->timestamp, player};
+    }
+    if (deltaFeed) {
+        deltaFeed->append(oldNode ? DeltaKind::Update : DeltaKind::Insert, player, old.score, newScore, timestamp);
+    }
+    // 已经在榜上时挪动原来的节点；并发读时读线程可能正停在这个节点上，还是删除老节点再创建新的node
+    SkipListNode* node = oldNode ? oldNode : skipList.find(player);
+    int rank;
+    skipList.beginWrite();
+    if (node && !skipList.concurrentReads()) {
+        rank = skipList.reposition(node, newScore, timestamp);
     } else {
-        // 存在则删除,再创建新的node
-        skipList.remove(playerId);
-        skipList.insert(newScore,playerId,timestamp);
+        skipList.remove(player);
+        rank = skipList.insert(newScore, player, timestamp);
     }
+    skipList.endWrite();
+    if (topK > 0) {
+        updateTopK(oldNode ? &old : nullptr, SkipListEntry{newScore, timestamp, player});
+    }
+    return rank;
+}
+
+void RankBoard::updateScores(const ScoreUpdate* updates, size_t count) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::UpdateScores);)
+    // 转成句柄，记下输入顺序
+    struct Pending {
+        PlayerHandle player;
+        time_t timestamp;
+        size_t order;
+        int64_t score;
+    };
+    std::vector<Pending> pending;
+    pending.reserve(count);
+    // 日志按输入顺序记录，回放时逐条updateScore得到相同的结果
+    for (size_t i = 0; journal && i < count; i++) {
+        journal->append(updates[i].playerId, updates[i].score, updates[i].timestamp);
+    }
+    for (size_t i = 0; i < count; i++) {
+        pending.push_back(Pending{players->intern(updates[i].playerId), updates[i].timestamp, i, updates[i].score});
+    }
+    // 每个玩家只保留输入顺序上的最后一条，和逐条调用updateScore的结果一致
+    std::sort(pending.begin(), pending.end(), [](const Pending& a, const Pending& b) {
+        if (a.player != b.player) {
+            return a.player < b.player;
+        }
+        return a.order < b.order;
+    });
+    // 增量流也按输入顺序记：同一玩家的第一条的老分数取榜上的，后面的取前一条的新分数
+    if (deltaFeed) {
+        struct Change {
+            PlayerHandle player;
+            DeltaKind kind;
+            int64_t oldScore;
+        };
+        std::vector<Change> changes(count);
+        for (size_t i = 0; i < pending.size(); i++) {
+            const Pending& p = pending[i];
+            Change& change = changes[p.order];
+            change.player = p.player;
+            if (i > 0 && pending[i-1].player == p.player) {
+                change.kind = DeltaKind::Update;
+                change.oldScore = pending[i-1].score;
+            } else if (SkipListNode* node = skipList.find(p.player)) {
+                change.kind = DeltaKind::Update;
+                change.oldScore = node->score;
+            } else {
+                change.kind = DeltaKind::Insert;
+                change.oldScore = 0;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            deltaFeed->append(changes[i].kind, changes[i].player, changes[i].oldScore, updates[i].score, updates[i].timestamp);
+        }
+    }
+    std::vector<SkipListNode*> oldNodes;
+    std::vector<SkipListEntry> entries;
+    entries.reserve(pending.size());
+    for (size_t i = 0; i < pending.size(); i++) {
+        if (i + 1 < pending.size() && pending[i+1].player == pending[i].player) {
+            continue;
+        }
+        const Pending& p = pending[i];
+        SkipListNode* node = skipList.find(p.player);
+        if (node) {
+            oldNodes.push_back(node);
+        }
+        entries.push_back(SkipListEntry{p.score, p.timestamp, p.player});
+    }
+    // 老节点按排名顺序一趟删掉，新键按排名顺序一趟插入
+    std::sort(oldNodes.begin(), oldNodes.end(), [this](const SkipListNode* a, const SkipListNode* b) {
+        return skipList.keyBefore(a->score, a->timestamp, a->player, b->score, b->timestamp, b->player);
+    });
+    std::sort(entries.begin(), entries.end(), [this](const SkipListEntry& a, const SkipListEntry& b) {
+        return skipList.keyBefore(a.score, a.timestamp, a.player, b.score, b.timestamp, b.player);
+    });
+    // 有一个玩家原来或者现在在前K名里，整批更新后重新取一次前K名，O(K)
+    bool topKChanged = false;
+    if (topK > 0) {
+        bool full = topEntries.size() >= static_cast<size_t>(topK);
+        const SkipListEntry* last = full ? &topEntries.back() : nullptr;
+        topKChanged = !full || (!oldNodes.empty() && !skipList.keyBefore(last->score, last->timestamp, last->player,
+                                                                          oldNodes.front()->score, oldNodes.front()->timestamp,
+                                                                          oldNodes.front()->player)) ||
+                      (!entries.empty() && skipList.keyBefore(entries.front().score, entries.front().timestamp,
+                                                              entries.front().player, last->score, last->timestamp, last->player));
+    }
+    // 排序不改跳表，放在写入区间外面，读线程只需要等两趟修改
+    skipList.beginWrite();
+    skipList.removeSorted(oldNodes);
+    skipList.insertSorted(entries);
+    skipList.endWrite();
+    if (topKChanged) {
+        rebuildTopK();
+    } else if (topK > 0) {
+        topKCounters.skipped++;
+    }
+}
+
+void RankBoard::setTopKCache(int k) {
+    topK = std::max(0, k);
+    if (topK > 0) {
+        rebuildTopK();
+        return;
+    }
+    topEntries.clear();
+    topEntries.shrink_to_fit();
+    std::atomic_store_explicit(&topKList, std::shared_ptr<const TopKList>(), std::memory_order_release);
+    topKVersion.fetch_add(1, std::memory_order_release);
+}
+
+std::shared_ptr<const TopKList> RankBoard::getTopK() const {
+    return std::atomic_load_explicit(&topKList, std::memory_order_acquire);
+}
+
+void RankBoard::refreshTopK(std::shared_ptr<const TopKList>& cached) const {
+    if (!cached || cached->version != topKVersion.load(std::memory_order_acquire)) {
+        cached = getTopK();
+    }
+}
+
+void RankBoard::updateTopK(const SkipListEntry* old, const SkipListEntry& now) {
+    auto before = [this](const SkipListEntry& a, const SkipListEntry& b) {
+        return skipList.keyBefore(a.score, a.timestamp, a.player, b.score, b.timestamp, b.player);
+    };
+    // 玩家不足K个时所有玩家都在缓存里；否则和第K名比较
+    bool full = topEntries.size() >= static_cast<size_t>(topK);
+    bool oldIn = old && (!full || !before(topEntries.back(), *old));
+    bool newIn = !full || before(now, topEntries.back());
+    if (!oldIn && !newIn) {
+        topKCounters.skipped++;
+        return;
+    }
+    if (oldIn) {
+        topEntries.erase(std::lower_bound(topEntries.begin(), topEntries.end(), *old, before));
+    }
+    if (newIn) {
+        topEntries.insert(std::upper_bound(topEntries.begin(), topEntries.end(), now, before), now);
+        if (topEntries.size() > static_cast<size_t>(topK)) {
+            topEntries.pop_back();
+        }
+    } else if (SkipListNode* node = skipList.getNodeByRank(topK)) {
+        // 掉出了前K名，剩下的K-1个就是第1到K-1名，原来的第K+1名现在是第K名
+        topEntries.push_back(SkipListEntry{node->score, node->timestamp, node->player});
+    }
+    topKCounters.patched++;
+    publishTopK();
+}
+
+void RankBoard::rebuildTopK() {
+    topEntries.clear();
+    SkipListNode* cur = skipList.getHeadNode()->level[0].forward;
+    for (int i = 0; cur && i < topK; i++) {
+        topEntries.push_back(SkipListEntry{cur->score, cur->timestamp, cur->player});
+        cur = cur->level[0].forward;
+    }
+    topKCounters.rebuilt++;
+    publishTopK();
+}
+
+void RankBoard::publishTopK() {
+    uint64_t version = topKVersion.load(std::memory_order_relaxed) + 1;
+    auto list = std::make_shared<TopKList>();
+    list->version = version;
+    list->players.resize(topEntries.size());
+    for (size_t i = 0; i < topEntries.size(); i++) {
+        const SkipListEntry& e = topEntries[i];
+        list->players[i] = RankView{players->name(e.player), e.score, e.timestamp, static_cast<int>(i) + 1};
+    }
+    std::atomic_store_explicit(&topKList, std::shared_ptr<const TopKList>(std::move(list)), std::memory_order_release);
+    topKVersion.store(version, std::memory_order_release);
 }
 
 int RankBoard::getRank(const std::string& playerId) {
-    return  skipList.getRank(playerId) + 1;
+    PlayerHandle player = players->lookup(playerId);
+    if (player == PlayerTable::INVALID) {
+        return 0;
+    }
+    return getRank(player);
+}
+
+int RankBoard::getRank(PlayerHandle player) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetRank);)
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    int rank;
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        rank = skipList.getRank(player);
+    } while (skipList.readRetry(version));
+    return  rank + 1;
+}
+
+int RankBoard::countInScoreRange(int64_t lo, int64_t hi) {
+    if (lo > hi) {
+        return 0;
+    }
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    int count;
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        // 不低于lo的玩家数减去高于hi的玩家数
+        int atLeast = lo == INT64_MIN ? skipList.size() : skipList.countAbove(lo - 1);
+        count = atLeast - skipList.countAbove(hi);
+    } while (skipList.readRetry(version));
+    return count;
+}
+
+int RankBoard::rankOfScore(int64_t score) {
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    int above;
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        above = skipList.countAbove(score);
+    } while (skipList.readRetry(version));
+    return above + 1;
+}
+
+double RankBoard::percentileOf(const std::string& playerId) {
+    PlayerHandle player = players->lookup(playerId);
+    if (player == PlayerTable::INVALID) {
+        return -1;
+    }
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    double percentile;
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        SkipListNode* node = skipList.find(player);
+        percentile = node ? 100.0 * (skipList.countAbove(node->score) + 1) / skipList.size() : -1;
+    } while (skipList.readRetry(version));
+    return percentile;
+}
+
+bool RankBoard::scoreAtPercentile(double p, int64_t& score) {
+    if (!(p > 0 && p <= 100)) {
+        return false;
+    }
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    SkipListNode* node;
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        int count = skipList.size();
+        int rank = std::min(count, std::max(1, static_cast<int>(std::ceil(p * count / 100))));
+        node = skipList.getNodeByRank(rank);
+        if (node) {
+            score = node->score;
+        }
+    } while (skipList.readRetry(version));
+    return node != nullptr;
+}
+
+int RankBoard::countAhead(int64_t score, time_t timestamp, const std::string& playerId) {
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    int count;
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        count = skipList.countBefore(score, timestamp, playerId);
+    } while (skipList.readRetry(version));
+    return count;
+}
+
+std::vector<RankInfo> RankBoard::getPlayersAround(int64_t score, time_t timestamp, const std::string& playerId,
+                                                  int before, int after) {
+    std::vector<RankInfo> players;
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        players.clear();
+        int count = skipList.countBefore(score, timestamp, playerId);
+        int start = std::max(0, count - before);
+        SkipListNode* node = skipList.getNodeByRank(start + 1);
+        for (int left = count - start + after; left > 0 && node; left--) {
+            fillRankInfo(players.emplace_back(), node);
+            node = node->level[0].forward;
+        }
+    } while (skipList.readRetry(version));
+    return players;
+}
+
+bool RankBoard::getPlayer(const std::string& playerId, RankInfo& info) {
+    PlayerHandle player = players->lookup(playerId);
+    if (player == PlayerTable::INVALID) {
+        return false;
+    }
+    // 节点的字段发布后不再修改，只要节点还没被回收就可以读
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    SkipListNode* node = skipList.find(player);
+    if (!node) {
+        return false;
+    }
+    fillRankInfo(info, node);
+    return true;
 }
 
 std::vector<RankInfo> RankBoard::getTopNPlayers(int n) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetTopN);)
     std::vector<RankInfo> topNPlayers;
     topNPlayers.reserve(n);
     if(n < 1){
         return topNPlayers;
     }
-    SkipListNode* cur =  skipList.getHeadNode();
-    while ( cur->next[0] && n > 0){
-        RankInfo& tmp =  topNPlayers.emplace_back();
-        tmp.playerId = cur->next[0]->playerid;
-        tmp.score = cur->next[0]->score;
-        tmp.timestamp = cur->next[0]->timestamp;
-        cur = cur->next[0];
-        n--;
-    }
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        topNPlayers.clear();
+        SkipListNode* cur =  skipList.getHeadNode()->level[0].forward;
+        for (int left = n; cur && left > 0; left--) {
+            fillRankInfo(topNPlayers.emplace_back(), cur);
+            cur = cur->level[0].forward;
+        }
+    } while (skipList.readRetry(version));
     return topNPlayers;
 }
 
 // 查询自己名次前后共N名玩家的分数和名次
 std::vector<RankInfo> RankBoard::getNearbyPlayers(const std::string& playerId, int n) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetNearby);)
     std::vector<RankInfo> nearbyPlayers;
     nearbyPlayers.reserve(n);
     if(n < 1){
         return nearbyPlayers;
     }
-    // 要找的n名玩家的起始node指针
-    SkipListNode* left_node = skipList.getHeadNode();
-    SkipListNode* cur = left_node;
-    int diff = 0;
-    //std::cout<<"playerId="<<playerId<< std::endl;;
-    while (cur->next[0] && cur->next[0]->playerid != playerId){
-        //std::cout<<"cur->next[0]->playerid="<<cur->next[0]->playerid<< std::endl;
-        cur = cur->next[0];
-        if(diff == n/2 ){
-            left_node = left_node->next[0];
-        }else{
-            diff++;
+    PlayerHandle player = players->lookup(playerId);
+    if (player == PlayerTable::INVALID) {
+        return nearbyPlayers;
+    }
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        nearbyPlayers.clear();
+        int rank = skipList.getRank(player);
+        if (rank < 0){
+            // 没找到该玩家
+            continue;
+        }
+        // 要找的n名玩家中的第一个，排在自己前面n/2名，按排名直接定位
+        SkipListNode* left_node = skipList.getNodeByRank(std::max(0, rank - n/2) + 1);
+        // 填充n个玩家
+        for (int left = n; left > 0 && left_node; left--)
+        {
+            fillRankInfo(nearbyPlayers.emplace_back(), left_node);
+            left_node = left_node->level[0].forward;
         }
+    } while (skipList.readRetry(version));
+    return nearbyPlayers;
+}
+
+int RankBoard::getTopNPlayers(int n, std::vector<RankView>& out) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetTopN);)
+    out.clear();
+    if (n < 1) {
+        return 0;
     }
+    out.reserve(std::min(n, skipList.size()));
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        out.clear();
+        SkipListNode* cur = skipList.getHeadNode()->level[0].forward;
+        for (int rank = 1; cur && rank <= n; rank++) {
+            // 重读时玩家数可能变多，超出预留的容量才会分配
+            fillRankView(out.emplace_back(), cur, rank);
+            cur = cur->level[0].forward;
+        }
+    } while (skipList.readRetry(version));
+    return static_cast<int>(out.size());
+}
 
-    if (!cur->next[0]){
-        // 没找到该玩家
-        return nearbyPlayers;
+int RankBoard::getNearbyPlayers(std::string_view playerId, int n, std::vector<RankView>& out) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetNearby);)
+    out.clear();
+    if (n < 1) {
+        return 0;
     }
-    // 填充n个玩家
-    while (n > 0 && left_node->next[0])
-    {
-        RankInfo& tmp =  nearbyPlayers.emplace_back();
-        tmp.playerId = left_node->next[0]->playerid;
-        tmp.score = left_node->next[0]->score;
-        tmp.timestamp = left_node->next[0]->timestamp;
-        left_node = left_node->next[0];
-        n--;
+    PlayerHandle player = players->lookup(playerId);
+    if (player == PlayerTable::INVALID) {
+        return 0;
     }
-    return nearbyPlayers;
+    out.reserve(n);
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        out.clear();
+        int rank = skipList.getRank(player);
+        if (rank < 0) {
+            continue;
+        }
+        int start = std::max(0, rank - n/2) + 1;
+        SkipListNode* node = skipList.getNodeByRank(start);
+        for (int i = 0; i < n && node; i++) {
+            fillRankView(out.emplace_back(), node, start + i);
+            node = node->level[0].forward;
+        }
+    } while (skipList.readRetry(version));
+    return static_cast<int>(out.size());
+}
+
+namespace {
+// 并发读时visitTop/visitNearby的结果先放这里，每个线程一个，容量留着下次用
+thread_local std::vector<RankView> visitBuffer;
+}
+
+void RankBoard::visitTop(int n, Visitor visit, void* context) {
+    if (!skipList.concurrentReads()) {
+        // 没有并发写入，直接在节点上遍历
+        RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetTopN);)
+        SkipListNode* cur = skipList.getHeadNode()->level[0].forward;
+        RankView view;
+        for (int rank = 1; cur && rank <= n; rank++) {
+            fillRankView(view, cur, rank);
+            visit(context, view);
+            cur = cur->level[0].forward;
+        }
+        return;
+    }
+    // 先换出来再用，visit里嵌套调用forEachTop也不会改到正在遍历的buffer
+    std::vector<RankView> views;
+    views.swap(visitBuffer);
+    getTopNPlayers(n, views);
+    for (const RankView& view : views) {
+        visit(context, view);
+    }
+    views.clear();
+    visitBuffer.swap(views);
+}
+
+void RankBoard::visitNearby(std::string_view playerId, int n, Visitor visit, void* context) {
+    if (!skipList.concurrentReads()) {
+        RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetNearby);)
+        PlayerHandle player = players->lookup(playerId);
+        int rank = player == PlayerTable::INVALID || n < 1 ? -1 : skipList.getRank(player);
+        if (rank < 0) {
+            return;
+        }
+        int start = std::max(0, rank - n/2) + 1;
+        SkipListNode* node = skipList.getNodeByRank(start);
+        RankView view;
+        for (int i = 0; i < n && node; i++) {
+            fillRankView(view, node, start + i);
+            visit(context, view);
+            node = node->level[0].forward;
+        }
+        return;
+    }
+    std::vector<RankView> views;
+    views.swap(visitBuffer);
+    getNearbyPlayers(playerId, n, views);
+    for (const RankView& view : views) {
+        visit(context, view);
+    }
+    views.clear();
+    visitBuffer.swap(views);
 }
 
-int main() {
-    //插入积分
-    RankBoard rankBoard;
-    rankBoard.updateScore("Player5", 62,100005);
-    rankBoard.updateScore("Player6", 60,100006);
-    // 更新积分测试，注意此时相同分数新加入的玩家应排在后面
-    rankBoard.updateScore("Player7", 60,100007);
-    rankBoard.updateScore("Player8", 40,100008);
-    rankBoard.updateScore("Player9", 30,100009);
-
-    rankBoard.updateScore("Player1", 10,100001);
-    rankBoard.updateScore("Player2", 80,100002);
-    rankBoard.updateScore("Player3", 70,100003);
-    // Player4积分更新2次
-    rankBoard.updateScore("Player4", 65,100004);
-    rankBoard.updateScore("Player4", 60,100005);
-    // 按顺序打印排名
-    rankBoard.print();
-
-    // 查询排名测试
-    std::cout << "Player1 rank: " << rankBoard.getRank("Player1") << std::endl;
-    std::cout << "Player2 rank: " << rankBoard.getRank("Player2") << std::endl;
-    std::cout << "Player3 rank: " << rankBoard.getRank("Player3") << std::endl;
-    std::cout << "Player4 rank: " << rankBoard.getRank("Player4") << std::endl;
-    std::cout << "Player5 rank: " << rankBoard.getRank("Player5") << std::endl;
-    std::cout << "Player6 rank: " << rankBoard.getRank("Player6") << std::endl;
-    std::cout << "Player7 rank: " << rankBoard.getRank("Player7") << std::endl;
-    std::cout << "Player8 rank: " << rankBoard.getRank("Player8") << std::endl;
-    std::cout << "Player9 rank: " << rankBoard.getRank("Player9") << std::endl;
-
-    {
-        // 获取前N名玩家测试 top5
-        std::vector<RankInfo> topPlayers = rankBoard.getTopNPlayers(5);
-        std::cout << "Top 5 players: " << std::endl;
-        for (const auto& player : topPlayers) {
-            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
-        }
-    }
-
-    { 
-        // 获取前N名玩家测试 top20
-        std::vector<RankInfo> topPlayers = rankBoard.getTopNPlayers(20);
-        std::cout << "Top 20 players: " << std::endl;
-        for (const auto& player : topPlayers) {
-            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
-        }
-    }
-    {
-        // 获取自己名次前后N名玩家测试 
-        std::cout << "Nearby players of Player5:  Nearby :5" << std::endl;
-        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 5);
-        for (const auto& player : nearbyPlayers) {
-            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
-        }
-    }
-    {
-        // 获取自己名次前后N名玩家测试 
-        std::cout << "Nearby players of Player5: Nearby :4" << std::endl;
-        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 4);
-        for (const auto& player : nearbyPlayers) {
-            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
-        }
-    }
-    {
-        // 获取自己名次前后N名玩家测试 
-        std::cout << "Nearby players of Player5: Nearby :2 " << std::endl;
-        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 2);
-        for (const auto& player : nearbyPlayers) {
-            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
-        }
-    }
-    {
-        // 获取自己名次前后N名玩家测试 
-        std::cout << "Nearby players of Player5: Nearby :200" << std::endl;
-        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 200);
-        for (const auto& player : nearbyPlayers) {
-            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
-        }
-    }
-    return 0;
+void RankBoard::collect(SkipListNode* node, int rank, int count, int64_t minScore, uint64_t version,
+                        std::vector<RankInfo>& out, RankCursor* cursor) {
+    SkipListNode* last = nullptr;
+    for (; node && count > 0 && node->score >= minScore; node = node->level[0].forward, count--) {
+        fillRankInfo(out.emplace_back(), node);
+        last = node;
+    }
+    if (!cursor) {
+        return;
+    }
+    cursor->board = this;
+    cursor->minScore = minScore;
+    cursor->finished = !node || node->score < minScore;
+    if (last) {
+        cursor->node = last;
+        cursor->version = version;
+        cursor->score = last->score;
+        cursor->timestamp = last->timestamp;
+        cursor->playerId = players->name(last->player);
+        cursor->rank = rank + static_cast<int>(out.size());
+    }
+}
+
+std::vector<RankInfo> RankBoard::getRange(int startRank, int count, RankCursor* cursor) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetRange);)
+    std::vector<RankInfo> range;
+    if (startRank < 1 || count < 1) {
+        return range;
+    }
+    range.reserve(count);
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    // 作废的尝试不能改调用方的游标，每次从原来的游标开始，成功后再写回
+    RankCursor next;
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        range.clear();
+        if (cursor) {
+            next = *cursor;
+        }
+        collect(skipList.getNodeByRank(startRank), startRank, count, INT64_MIN, version, range, cursor ? &next : nullptr);
+    } while (skipList.readRetry(version));
+    if (cursor) {
+        *cursor = std::move(next);
+    }
+    return range;
+}
+
+std::vector<RankInfo> RankBoard::getRangeByScore(int64_t maxScore, int64_t minScore, int limit, RankCursor* cursor) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetRange);)
+    std::vector<RankInfo> range;
+    if (limit < 1 || maxScore < minScore) {
+        return range;
+    }
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    RankCursor next;
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        range.clear();
+        if (cursor) {
+            next = *cursor;
+        }
+        int before;
+        SkipListNode* node = skipList.firstAtMost(maxScore, before);
+        collect(node, before + 1, limit, minScore, version, range, cursor ? &next : nullptr);
+    } while (skipList.readRetry(version));
+    if (cursor) {
+        *cursor = std::move(next);
+    }
+    return range;
+}
+
+std::vector<RankInfo> RankBoard::nextPage(RankCursor& cursor, int count) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetRange);)
+    std::vector<RankInfo> page;
+    if (cursor.finished || cursor.board != this || count < 1) {
+        return page;
+    }
+    page.reserve(count);
+    EpochReclaimer::Guard guard(skipList.concurrentReads());
+    // 每次尝试都从上一页停下的位置开始，收进next，校验过版本号再写回游标；
+    // 直接改cursor的话，作废的尝试会把续读位置推到它读到的最后一行，重读时跳过一整页
+    RankCursor next;
+    uint64_t version;
+    do {
+        version = skipList.readBegin();
+        page.clear();
+        next = cursor;
+        SkipListNode* node;
+        int rank;
+        if (cursor.version == version) {
+            // 上一页之后没有修改，节点还在原来的位置
+            node = cursor.node->level[0].forward;
+            rank = cursor.rank;
+        } else {
+            int before;
+            node = skipList.firstAfter(cursor.score, cursor.timestamp, cursor.playerId, before);
+            rank = before + 1;
+        }
+        collect(node, rank, count, cursor.minScore, version, page, &next);
+    } while (skipList.readRetry(version));
+    cursor = std::move(next);
+    return page;
 }
@@ -2,25 +2,49 @@
     参照redis的zset跳表实现方案。
     构建一个跳表来存储RankInfo信息。以score和timestamp进行排名
     跳表第0层包含所有RankInfo的指针，可以用来顺序查找。
-    插入前需要先顺序查找一下有没有老数据，插入操作时间复杂度退化为n。
-    查找自己的排名由于key是playerId，也需要顺序查找，时间复杂度为n。
+    节点层数按p=1/4的几何分布随机（每个跳表自带随机数状态），节点只分配自己层数的前进指针，查找从当前最高层开始。
+    节点从每个排行榜独占的slab内存池分配，按大小分级复用空闲块，销毁或清空排行榜时整体释放。
+    玩家id通过PlayerTable驻留成连续分配的32位句柄，节点里只存句柄，比较和拷贝都是整数操作。
+    句柄到跳表节点的索引是按句柄下标访问的分段数组(SegmentedArray)，扩容只追加新段、不搬移已有元素，并发读时读线程不受影响；
+    注册表里共用玩家id表的小排行榜改用开放寻址哈希表(HandleMap)，不按全局句柄数占内存。插入和删除时同步更新索引，查找老数据为O(1)，更新积分整体为O(logn)。
+    删除时用节点自身的score和timestamp从上往下定位前置节点，不再按playerId逐个比较。
+    加减积分时先看新的排序键和前后节点的顺序是否还成立，成立就原地修改，否则从原来的位置就近挪动节点，不重新分配、不重新随机层数。
+    每一层的前进指针记录跨过的节点数(span)，和redis一样。查找自己的排名时按节点的score和timestamp从上往下累加span，时间复杂度为logn。
     前n名从头指针向后查找n个即可。
-    自己前后n名，维护一个左指针，为n名中的第一个，顺序查找，找到自己后，从左指针向后取n个数据。
+    自己前后n名，先求出自己的排名，再按排名从上往下定位n名中的第一个，从它向后取n个数据，时间复杂度为logn+n。
+    并发读模式：一个写线程更新，任意多个读线程查询，读线程不加锁。
+    前进指针和span都是原子变量，新节点先填好再用release发布；摘下的节点交给EpochReclaimer，等读线程都离开后再回收。
+    span和指针不能一起原子地修改，读线程用版本号(seqlock)校验，读的过程中有写入就重读。
 
     数据量大且7*24小时运行：
     1.排行榜放在redis上集群 + 持久化 
     2.读写分离，实现一个rank_server来承载所有的读请求，rank_server定时向排行榜请求最新切片数据，所有客户端读到的都是rank_server的切片数据。
     3.单节点的redis大约可以承载十万级别的QPS,百万级别的数据单节点就可以承载。消息队列可以使用redis自己的pub/sub
  */
+#pragma once
 
+#include <atomic>
 #include <iostream>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <algorithm>
 #include <chrono>
 #include <random>
+#include <unordered_map>
+
+#include "BoardStats.h"
+#include "EpochReclaimer.h"
+#include "HandleMap.h"
+#include "PlayerTable.h"
+#include "RankDump.h"
+#include "RankJournal.h"
+#include "SegmentedArray.h"
+#include "SlabAllocator.h"
 
  // 跳表最大层数
 #define MAX_LVL 16
@@ -32,16 +56,125 @@ struct RankInfo {
     time_t timestamp;
 };
 
-// 跳表节点结构体
+// 查询结果的只读视图，不拷贝字符串：playerId指向玩家id表里的字符串，排行榜存在期间一直有效
+struct RankView {
+    std::string_view playerId;
+    int64_t score;
+    time_t timestamp;
+    int rank;  // 从1开始
+};
+
+// 前K名缓存的一个版本，发布后不再修改，读线程拿到后可以一直用
+struct TopKList {
+    uint64_t version;              // 前K名每变一次加1
+    std::vector<RankView> players; // 按排名顺序
+};
+
+// 前K名缓存的维护情况
+struct TopKStats {
+    uint64_t skipped;  // 和前K名无关、没有动缓存的更新
+    uint64_t patched;  // 在原来的前K名上修补的更新
+    uint64_t rebuilt;  // 从跳表重新取前K名的次数(批量更新、清空、加载)
+};
+
+// 排行榜占用的内存
+struct MemoryStats {
+    size_t players;        // 玩家数
+    size_t reservedBytes;  // 节点内存池向系统申请的内存
+    size_t usedBytes;      // 其中节点实际占用的部分
+    size_t indexBytes;     // 句柄到节点索引的占用
+    size_t playerTableBytes;  // 玩家id表的占用
+};
+
+// 批量更新中的一条
+struct ScoreUpdate {
+    std::string playerId;
+    int64_t score;
+    time_t timestamp;
+};
+
+// 跳表排序键，批量插入时使用
+struct SkipListEntry {
+    int64_t score;
+    time_t timestamp;
+    PlayerHandle player;
+};
+
+struct SkipListNode;
+class RankBoard;
+class RankSnapshot;
+class RankDeltaFeed;
+
+// 翻页游标：记住上一页最后一个玩家，nextPage从它后面接着取。
+// 这期间排行榜没有修改时直接从上次停下的节点往后走，不用重新查找；有修改时按这个玩家的排序键重新定位，O(logn)
+class RankCursor {
+public:
+    // 下一页第一个玩家的排名，从1开始
+    int nextRank() const { return rank; }
+    // 已经取到排行榜或分数范围的末尾
+    bool done() const { return finished; }
+private:
+    friend class RankBoard;
+    const RankBoard* board = nullptr;
+    SkipListNode* node = nullptr;  // 上一页最后一个节点，只在版本号没变时使用
+    uint64_t version = 0;
+    int64_t score = 0;             // 上一页最后一个玩家的排序键
+    time_t timestamp = 0;
+    std::string playerId;
+    int64_t minScore = INT64_MIN;  // 按分数翻页时分数的下界
+    int rank = 1;
+    bool finished = true;
+};
+
+// 只有写线程修改、读线程可以并发读取的字段：读为acquire，写为release，用法和普通变量一样
+template <class T>
+class AtomicField {
+public:
+    AtomicField() : value(T()) {}
+    AtomicField(T v) : value(v) {}
+    AtomicField(const AtomicField& other) : value(T(other)) {}
+    AtomicField& operator=(const AtomicField& other) { return *this = T(other); }
+    AtomicField& operator=(T v) {
+        value.store(v, std::memory_order_release);
+        return *this;
+    }
+    operator T() const { return value.load(std::memory_order_acquire); }
+    T operator->() const { return value.load(std::memory_order_acquire); }
+    // 只有写线程会修改，不需要原子的读改写
+    AtomicField& operator+=(T d) { return *this = value.load(std::memory_order_relaxed) + d; }
+    AtomicField& operator-=(T d) { return *this = value.load(std::memory_order_relaxed) - d; }
+    T operator++(int) {
+        T old = value.load(std::memory_order_relaxed);
+        *this = old + 1;
+        return old;
+    }
+    T operator--(int) {
+        T old = value.load(std::memory_order_relaxed);
+        *this = old - 1;
+        return old;
+    }
+private:
+    std::atomic<T> value;
+};
+
+// 跳表某一层的前进指针，span为这一步跨过的节点数，用来计算排名
+struct SkipListLevel {
+    AtomicField<SkipListNode*> forward;
+    AtomicField<int> span;
+};
+
+// 跳表节点结构体，按层数分配，level数组只有height个
+// 玩家id用PlayerTable的句柄表示，节点里没有字符串
 struct SkipListNode {
     int64_t score;
-    std::string playerid;
-    time_t timestamp;  // 添加时间戳字段
-    SkipListNode* next[MAX_LVL]; // 跳表最大层数
+    time_t timestamp;     // 添加时间戳字段
+    PlayerHandle player;  // 玩家句柄
+    int height;           // 节点层数
+    SkipListLevel level[];
 
-    SkipListNode(int64_t s, const std::string& id, time_t t) : score(s), playerid(id), timestamp(t) {
-        for (int i = 0; i < MAX_LVL; ++i) {
-            next[i] = nullptr;
+    SkipListNode(int64_t s, PlayerHandle p, time_t t, int h) : score(s), timestamp(t), player(p), height(h) {
+        for (int i = 0; i < h; ++i) {
+            new (&level[i]) SkipListLevel();
         }
     }
 };
@@ -49,39 +182,263 @@ struct SkipListNode {
 // 跳表类
 class SkipList {
 public:
-    SkipList() {
-        head = new SkipListNode(0, "", 0);  // 初始化时间戳为 0
+    // players用于同分同时间戳时按playerid排序；seed为层数随机数种子，每个跳表独立
+    // concurrentReads为true时允许读线程和唯一的写线程并发访问
+    // hashedIndex为true时句柄索引用哈希表，适合共用玩家id表、玩家数远少于句柄数的小跳表，不能和concurrentReads同时用
+    explicit SkipList(const PlayerTable* players, uint64_t seed = std::random_device{}(), bool concurrentReads = false,
+                      bool hashedIndex = false)
+        : players(players), rngState(seed), concurrent(concurrentReads), hashed(hashedIndex && !concurrentReads) {
+        head = createNode(MAX_LVL, 0, PlayerTable::INVALID, 0);  // 初始化时间戳为 0
     }
-    // 查找节点（根据 playerid 查找）,这里只知道playerid不知道分数，只能线性查找
-    SkipListNode* find(const std::string& playerid);
-    // 获得玩家排名 从1开始
-    int getRank(const std::string& playerid);
-    // 插入节点
-    void insert(int64_t score, const std::string& playerid, time_t timestamp) ;
+    SkipList(const SkipList&) = delete;
+    SkipList& operator=(const SkipList&) = delete;
+    // 查找节点（根据玩家句柄查找）,通过索引O(1)定位
+    SkipListNode* find(PlayerHandle player);
+    // 获得玩家排名 从0开始，不存在返回-1
+    int getRank(PlayerHandle player);
+    // 按排名获取节点 从1开始，超出范围返回nullptr
+    SkipListNode* getNodeByRank(int rank);
+    // 排在 (score, timestamp, playerId) 之前的节点个数，这个键不需要在跳表中
+    int countBefore(int64_t score, time_t timestamp, std::string_view playerId) const;
+    // 第一个排在 (score, timestamp, playerId) 之后的节点，before为排在它前面的节点数，没有返回nullptr
+    SkipListNode* firstAfter(int64_t score, time_t timestamp, std::string_view playerId, int& before);
+    // 第一个分数不高于score的节点，before为排在它前面的节点数，没有返回nullptr
+    SkipListNode* firstAtMost(int64_t score, int& before);
+    // 分数比score高的节点数
+    int countAbove(int64_t score) {
+        int before;
+        firstAtMost(score, before);
+        return before;
+    }
+    // 插入节点，返回新节点的排名(从1开始)
+    int insert(int64_t score, PlayerHandle player, time_t timestamp) ;
     // 删除节点
-    void remove(const std::string& playerid);
+    void remove(PlayerHandle player);
+    // 把已经在跳表里的节点改成新的排序键，返回新的排名(从1开始)；不能和concurrentReads同时用
+    // 和前后节点的顺序不变时原地修改，否则摘下来从原来的位置往前或往后找新位置再挂上，节点和层数都不变
+    int reposition(SkipListNode* node, int64_t score, time_t timestamp);
+    // 批量插入，entries必须已按排名顺序排好且玩家都不在跳表中，每次从上一个位置继续查找
+    void insertSorted(const std::vector<SkipListEntry>& entries);
+    // 批量删除，nodes必须已按排名顺序排好
+    void removeSorted(const std::vector<SkipListNode*>& nodes);
+    // 从空跳表开始按排名顺序在尾部追加，每次O(1)，用于从转储文件加载；追加期间不能有其他修改
+    void beginAppend();
+    void append(int64_t score, PlayerHandle player, time_t timestamp);
+    // 键1是否排在键2之前
+    bool keyBefore(int64_t score1, time_t timestamp1, PlayerHandle player1,
+                   int64_t score2, time_t timestamp2, PlayerHandle player2) const;
     // 打印最底层跳表，包含所有插入的元素
     void print();
     // 获得头节点
     SkipListNode* getHeadNode();
+    // 节点总数
+    int size() const { return length; }
+    // 清空所有节点，内存池整体释放
+    void clear();
+    // 预先把句柄索引扩到n个玩家，哈希索引不需要
+    void reserve(size_t n) {
+        if (!hashed) {
+            index.reserve(n);
+        }
+    }
+    // 内存占用统计
+    MemoryStats memoryStats() const;
+    bool concurrentReads() const { return concurrent; }
+    RANKBOARD_STATS_ONLY(BoardStats& boardStats() const { return counters; })
+    // 写线程在一次修改的前后调用，修改期间版本号为奇数
+    void beginWrite();
+    void endWrite();
+    // 读线程：等到没有写入时返回当前版本号；每次修改版本号都会变，不开并发读时也一样
+    uint64_t readBegin() const;
+    // 读线程：读的过程中有过写入，结果作废需要重读
+    bool readRetry(uint64_t version) const;
 private:
+    const PlayerTable* players;
+    SlabAllocator pool;  // 节点内存池
     SkipListNode* head;  // 头节点
+    AtomicField<int> length{0};  // 节点总数
+    AtomicField<int> level{1};   // 当前最高层数，查找从这一层开始
+    uint64_t rngState;   // 层数随机数状态
+    bool concurrent;     // 是否允许并发读
+    RANKBOARD_STATS_ONLY(mutable BoardStats counters{concurrent};)
+    std::atomic<uint64_t> version{0};  // 写入期间为奇数
+    EpochReclaimer reclaimer{&pool};   // 并发读时摘下的节点延迟回收
+    // 玩家句柄到节点的索引，句柄是连续分配的，用分段数组，扩容时读线程也能访问，insert和remove时同步维护
+    SegmentedArray<AtomicField<SkipListNode*>> index;
+    bool hashed;                            // 用handleIndex代替index
+    HandleMap<SkipListNode*> handleIndex;
+    // 查找手指：每一层排在当前键之前的最后一个节点和它的排名
+    struct Finger {
+        SkipListNode* update[MAX_LVL];
+        int rank[MAX_LVL];
+    };
+    Finger tail;  // append用，每一层的最后一个节点
+    // a 是否排在 (score, timestamp, player) 之前
+    bool rankBefore(const SkipListNode* a, int64_t score, time_t timestamp, PlayerHandle player) const;
+    bool rankBefore(const SkipListNode* a, int64_t score, time_t timestamp, std::string_view playerId) const;
+    void resetFinger(Finger& finger);
+    // 把手指移动到给定键之前，键不能比手指当前的位置靠前
+    void seek(Finger& finger, int64_t score, time_t timestamp, PlayerHandle player);
+    // 把手指移动到给定键之前，键比手指第0层的节点靠前：往上找到第一个排在键之前的层，再从这一层往下找
+    void seekBack(Finger& finger, int64_t score, time_t timestamp, PlayerHandle player);
+    // 在手指位置插入新节点，手指移动到新节点
+    void insertAt(Finger& finger, int64_t score, PlayerHandle player, time_t timestamp);
+    // 删除手指位置后面的节点
+    void removeAt(Finger& finger, SkipListNode* node);
+    // 在手指位置挂上节点/摘下手指位置后面的节点，只改前进指针、span和层数，不分配、不释放、不动索引
+    void linkAt(Finger& finger, SkipListNode* node);
+    void unlinkAt(Finger& finger, SkipListNode* node);
+    // 从内存池按层数分配节点，只分配height个前进指针
+    SkipListNode* createNode(int height, int64_t score, PlayerHandle player, time_t timestamp);
+    void freeNode(SkipListNode* node);
+    // splitmix64，比每次构造mt19937快得多
+    uint64_t nextRandom();
     // 生成随机层数
     int randomLevel();
 };
 
 class RankBoard {
 public:
+    RankBoard() : RankBoard(std::random_device{}()) {}
+    // 指定跳表层数的随机数种子，便于复现
+    // concurrentReads为true时，一个线程调用updateScore/updateScores/clear的同时，
+    // 其他线程可以不加锁地调用getRank/getTopNPlayers/getNearbyPlayers
+    explicit RankBoard(uint64_t seed, bool concurrentReads = false)
+        : players(std::make_shared<PlayerTable>()), skipList(players.get(), seed, concurrentReads) {}
+    // 和其他排行榜共用一个玩家id表，playerId只驻留一次；共用同一个表的排行榜必须由同一个线程写入
+    // hashedIndex见SkipList，玩家少的排行榜索引不按全局句柄数占内存
+    RankBoard(std::shared_ptr<PlayerTable> sharedPlayers, uint64_t seed, bool concurrentReads = false,
+              bool hashedIndex = false)
+        : players(std::move(sharedPlayers)), skipList(players.get(), seed, concurrentReads, hashedIndex) {}
     // 更新玩家积分，如果不存在则添加新玩家，加入时间戳参数并处理相同分数排序逻辑
     void updateScore(const std::string& playerId, int64_t newScore,time_t timestamp);
+    // 同上，playerid已经换成句柄
+    void updateScore(PlayerHandle player, int64_t newScore, time_t timestamp);
+    // 在玩家当前分数上加delta(可以为负)，不在榜上时从0开始，返回新的分数和排名；时间戳换成timestamp
+    // 结果超出int64时饱和到INT64_MAX/INT64_MIN，不报错
+    // 非并发读模式下只移动原来的节点，名次变化小时只在附近查找，见SkipList::reposition
+    RankView incrementScore(const std::string& playerId, int64_t delta, time_t timestamp);
+    RankView incrementScore(PlayerHandle player, int64_t delta, time_t timestamp);
+    // 批量更新：同一玩家有多条时保留输入顺序上的最后一条，不比较时间戳，和逐条调用updateScore、回放日志的结果一致；
+    // 按排名顺序排好后一趟删除、一趟插入
+    void updateScores(const ScoreUpdate* updates, size_t count);
+    void updateScores(const std::vector<ScoreUpdate>& updates) { updateScores(updates.data(), updates.size()); }
     // 查询玩家当前排名
     int getRank(const std::string& playerId);
+    int getRank(PlayerHandle player);
+    // 玩家id对应的句柄，不存在则分配一个，频繁调用的地方可以先换成句柄
+    PlayerHandle getHandle(const std::string& playerId);
+    // 玩家id表
+    const PlayerTable& playerTable() const { return *players; }
+    // 排在 (score, timestamp, playerId) 之前的玩家数，这个玩家不需要在榜上，分片榜用来合并排名
+    int countAhead(int64_t score, time_t timestamp, const std::string& playerId);
+    // 排在这个键前面最多before个玩家，加上从这个键开始往后最多after个玩家
+    std::vector<RankInfo> getPlayersAround(int64_t score, time_t timestamp, const std::string& playerId, int before, int after);
+    // 玩家当前的分数和时间戳，不在榜上返回false
+    bool getPlayer(const std::string& playerId, RankInfo& info);
     // 获取前N名玩家的分数和名次
     std::vector<RankInfo> getTopNPlayers(int n);
     // 查询自己名次前后共N名玩家的分数和名次
     std::vector<RankInfo> getNearbyPlayers(const std::string& playerId, int n);
+    // 同上，结果填进调用方传入的buffer(先清空)，返回个数；buffer的容量够用时不分配内存，反复使用同一个buffer即可
+    int getTopNPlayers(int n, std::vector<RankView>& out);
+    int getNearbyPlayers(std::string_view playerId, int n, std::vector<RankView>& out);
+    // 对前N名依次调用fn(const RankView&)，不分配内存；fn里不能修改这个排行榜
+    template <class Fn>
+    void forEachTop(int n, Fn&& fn) {
+        visitTop(n, &invokeVisitor<Fn>, &fn);
+    }
+    // 对自己名次前后共N名依次调用fn(const RankView&)，规则同getNearbyPlayers
+    template <class Fn>
+    void forEachNearby(std::string_view playerId, int n, Fn&& fn) {
+        visitNearby(playerId, n, &invokeVisitor<Fn>, &fn);
+    }
+    // 分数在[lo, hi]之间的玩家数，O(logn)
+    int countInScoreRange(int64_t lo, int64_t hi);
+    // 分数为score的玩家能排到第几名：分数比它高的玩家数加1，O(logn)
+    int rankOfScore(int64_t score);
+    // 玩家排在前百分之多少，按分数算(同分的玩家相同)：100人里的第1名是1，最后一名是100；不在榜上返回-1
+    double percentileOf(const std::string& playerId);
+    // 排在前p%位置的玩家的分数，p在(0, 100]之间，100取最后一名；榜上没人或p超出范围返回false
+    bool scoreAtPercentile(double p, int64_t& score);
+    // 维护前k名的缓存，k为0时关闭；和updateScore一样只能由写线程调用
+    // 只有进入、离开前k名或者在前k名里移动的更新才修补缓存并发布新版本，其他更新只多一次比较
+    void setTopKCache(int k);
+    int getTopKCacheSize() const { return topK; }
+    // 最新发布的前K名，没开缓存返回nullptr，任何线程都可以调用
+    std::shared_ptr<const TopKList> getTopK() const;
+    // 读线程缓存着一份前K名，有新版本时才重新加载，没有时只读一个原子变量
+    void refreshTopK(std::shared_ptr<const TopKList>& cached) const;
+    TopKStats topKStats() const { return topKCounters; }
+    // 排名从startRank(从1开始)起的count个玩家，按排名直接定位再往后取，O(logn+count)；cursor不为空时记下翻页位置
+    std::vector<RankInfo> getRange(int startRank, int count, RankCursor* cursor = nullptr);
+    // 分数在[minScore, maxScore]之间的玩家，从高到低最多limit个，O(logn+limit)
+    std::vector<RankInfo> getRangeByScore(int64_t maxScore, int64_t minScore, int limit, RankCursor* cursor = nullptr);
+    // 从游标接着取下一页最多count个玩家，游标来自getRange或getRangeByScore
+    std::vector<RankInfo> nextPage(RankCursor& cursor, int count);
     // 打印排行榜
     void print();
+    // 获得跳表头节点，用于顺序遍历
+    SkipListNode* getHeadNode();
+    // 清空排行榜，比如赛季结束
+    void clear();
+    // 预先按playerCount个玩家句柄分配索引，和其他排行榜共用玩家id表时，第一次插入句柄很大的玩家不用再一次性分配
+    void reserve(size_t playerCount) { skipList.reserve(playerCount); }
+    // 排行榜占用的内存
+    MemoryStats memoryStats() const;
+    // 各操作的耗时分布、每次查找访问的节点数和各层节点数，编译时没有定义RANKBOARD_STATS时enabled为false
+    BoardStatsReport stats() const;
+    // 按排名顺序生成只读快照，O(n)；并发读模式下只能由写线程调用
+    std::shared_ptr<const RankSnapshot> snapshot();
+    // 按排名顺序转储到文件，sequence为已经应用到的日志序号；先写临时文件，落盘后再替换path，失败时原文件不变
+    bool dump(const std::string& path, uint64_t sequence = 0);
+    // 从转储文件加载，替换当前内容，O(n)；文件损坏时返回false，排行榜不变
+    bool load(const std::string& path, uint64_t* sequence = nullptr, std::string* error = nullptr);
+    // 用按排名顺序排好的条目替换当前内容，O(n)；句柄必须来自这个排行榜的玩家id表
+    void loadSorted(const std::vector<SkipListEntry>& entries);
+    // 挂上预写日志后每次更新先写日志，传nullptr取消；日志由调用方打开和关闭
+    void setJournal(RankJournal* journal) { this->journal = journal; }
+    RankJournal* getJournal() const { return journal; }
+    // 挂上增量流后每次更新、清空和加载都记进去，给只读副本用，传nullptr取消；增量流由调用方持有
+    void setDeltaFeed(RankDeltaFeed* feed);
+    RankDeltaFeed* getDeltaFeed() const { return deltaFeed; }
+    // 转储到文件后去掉日志里转储已经包含的记录，需要先挂上日志
+    bool checkpoint(const std::string& dumpPath);
+    // 崩溃恢复：加载最近的转储(不存在则从空榜开始)，再回放日志里转储之后的更新；转储损坏返回false
+    bool recover(const std::string& dumpPath, const std::string& journalPath, std::string* error = nullptr);
 private:
+    std::shared_ptr<PlayerTable> players;  // 先于skipList构造
     SkipList skipList;
+    uint64_t snapshots = 0;  // 已生成的快照个数
+    RankJournal* journal = nullptr;
+    RankDeltaFeed* deltaFeed = nullptr;
+    int topK = 0;                             // 缓存前多少名，0为不缓存
+    std::vector<SkipListEntry> topEntries;    // 写线程维护的前K名，玩家不足K个时就是全部玩家
+    std::shared_ptr<const TopKList> topKList; // 用std::atomic_load/atomic_store访问
+    std::atomic<uint64_t> topKVersion{0};     // topKList的版本号
+    TopKStats topKCounters{};
+    // updateScore和incrementScore的公共部分：写日志和增量流、改跳表、修补前K名，返回新的排名
+    int setScore(PlayerHandle player, int64_t newScore, time_t timestamp);
+    // 单个玩家从old(不在榜上为nullptr)更新到now之后修补前K名，和前K名无关时直接返回
+    void updateTopK(const SkipListEntry* old, const SkipListEntry& now);
+    // 从跳表重新取前K名并发布
+    void rebuildTopK();
+    // load/loadSorted整体替换内容之后，增量流里记一次清空和每个玩家的插入
+    void feedReload();
+    void publishTopK();
+    // 把节点填成RankInfo
+    void fillRankInfo(RankInfo& info, const SkipListNode* node) const;
+    void fillRankView(RankView& view, const SkipListNode* node, int rank) const;
+    // forEachTop/forEachNearby去掉模板后的实现，不用std::function，避免捕获较多时分配内存
+    using Visitor = void (*)(void* context, const RankView& view);
+    template <class Fn>
+    static void invokeVisitor(void* context, const RankView& view) {
+        (*static_cast<std::remove_reference_t<Fn>*>(context))(view);
+    }
+    // 并发读时先把结果收进每个线程自己的buffer，校验过版本号再逐个交给visit，visit不会看到作废的结果
+    void visitTop(int n, Visitor visit, void* context);
+    void visitNearby(std::string_view playerId, int n, Visitor visit, void* context);
+    // 从排名为rank的node开始往后取最多count个分数不低于minScore的玩家，记下翻页位置
+    void collect(SkipListNode* node, int rank, int count, int64_t minScore, uint64_t version,
+                 std::vector<RankInfo>& out, RankCursor* cursor);
 };
\ No newline at end of file
@@ -0,0 +1,1534 @@
+#include "BTreeRankBoard.h"
+#include "BenchSuite.h"
+#include "RankBoard.h"
+#include "RankDeltaFeed.h"
+#include "RankBoardRegistry.h"
+#include "RankSnapshot.h"
+#include "ShardedRankBoard.h"
+#include "TieredRankBoard.h"
+#include "WindowedRankBoard.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+// 压测：先灌入playerCount个玩家，再随机更新已有玩家的积分，查询排名和前后名次
+// 同时抽样模拟原来按playerid线性查找的开销作对比
+static int runBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+
+    RankBoard rankBoard(12345);
+    time_t timestamp = 100000;
+    auto begin = Clock::now();
+    for (int i = 0; i < playerCount; i++) {
+        rankBoard.updateScore(ids[i], scoreDis(gen), timestamp++);
+    }
+    double insertNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    std::cout << "insert " << playerCount << " players: " << insertNs / playerCount << " ns/op" << std::endl;
+
+    // 节点平均层数和内存占用
+    double heightSum = 0;
+    for (SkipListNode* cur = rankBoard.getHeadNode()->level[0].forward; cur; cur = cur->level[0].forward) {
+        heightSum += cur->height;
+    }
+    MemoryStats stats = rankBoard.memoryStats();
+    std::cout << "avg node height: " << heightSum / playerCount << ", node bytes: " << double(stats.usedBytes) / playerCount
+              << ", reserved MB: " << stats.reservedBytes / (1 << 20) << ", index MB: " << stats.indexBytes / (1 << 20)
+              << ", player table MB: " << stats.playerTableBytes / (1 << 20) << std::endl;
+
+    const int updateCount = 200000;
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    begin = Clock::now();
+    for (int i = 0; i < updateCount; i++) {
+        rankBoard.updateScore(ids[playerDis(gen)], scoreDis(gen), timestamp++);
+    }
+    double updateNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    std::cout << "updateScore (indexed): " << updateNs / updateCount << " ns/op" << std::endl;
+
+    // 同一批玩家先逐条更新一遍，再换新分数批量更新一遍
+    for (int batchSize : {1000, 10000, 100000}) {
+        std::vector<ScoreUpdate> batch;
+        batch.reserve(batchSize);
+        for (int i = 0; i < batchSize; i++) {
+            batch.push_back(ScoreUpdate{ids[playerDis(gen)], scoreDis(gen), timestamp++});
+        }
+        begin = Clock::now();
+        for (const ScoreUpdate& u : batch) {
+            rankBoard.updateScore(u.playerId, u.score, u.timestamp);
+        }
+        double loopNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        for (ScoreUpdate& u : batch) {
+            u.score = scoreDis(gen);
+            u.timestamp = timestamp++;
+        }
+        begin = Clock::now();
+        rankBoard.updateScores(batch);
+        double batchNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        std::cout << "batch " << batchSize << ": updateScore loop " << loopNs / batchSize << " ns/op, updateScores "
+                  << batchNs / batchSize << " ns/op" << std::endl;
+    }
+
+    int64_t rankSum = 0;
+    begin = Clock::now();
+    for (int i = 0; i < updateCount; i++) {
+        rankSum += rankBoard.getRank(ids[playerDis(gen)]);
+    }
+    double rankNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    std::cout << "getRank: " << rankNs / updateCount << " ns/op (checksum " << rankSum << ")" << std::endl;
+
+    size_t nearbySum = 0;
+    begin = Clock::now();
+    for (int i = 0; i < updateCount; i++) {
+        nearbySum += rankBoard.getNearbyPlayers(ids[playerDis(gen)], 10).size();
+    }
+    double nearbyNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    std::cout << "getNearbyPlayers(10): " << nearbyNs / updateCount << " ns/op (checksum " << nearbySum << ")" << std::endl;
+
+    // 原来的updateScore至少要按playerid线性查找两次，这里只测一次查找
+    const int scanCount = 100;
+    SkipListNode* head = rankBoard.getHeadNode();
+    size_t found = 0;
+    begin = Clock::now();
+    for (int i = 0; i < scanCount; i++) {
+        const std::string& target = ids[playerDis(gen)];
+        SkipListNode* cur = head;
+        while (cur->level[0].forward && rankBoard.playerTable().name(cur->level[0].forward->player) != target) {
+            cur = cur->level[0].forward;
+        }
+        found += cur->level[0].forward != nullptr;
+    }
+    double scanNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    std::cout << "linear find (old path, found " << found << "/" << scanCount << "): " << scanNs / scanCount << " ns/op" << std::endl;
+
+    begin = Clock::now();
+    rankBoard.clear();
+    double clearMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    std::cout << "clear: " << clearMs << " ms, reserved bytes after clear: " << rankBoard.memoryStats().reservedBytes << std::endl;
+    return 0;
+}
+
+// 并发读压测：一个写线程不停更新，1到N个读线程不加锁查询排名，和一把大锁保护的排行榜对比
+static void runReadScaling(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (bool concurrent : {true, false}) {
+        RankBoard rankBoard(12345, concurrent);
+        std::mutex lock;  // 非并发模式下读写都要加的锁
+        std::mt19937_64 gen(12345);
+        std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+        time_t timestamp = 100000;
+        for (int i = 0; i < playerCount; i++) {
+            rankBoard.updateScore(ids[i], scoreDis(gen), timestamp++);
+        }
+        for (int readers = 1; readers <= maxThreads; readers *= 2) {
+            std::atomic<bool> stop{false};
+            std::atomic<int64_t> reads{0};
+            int64_t writes = 0;
+            std::thread writer([&] {
+                std::mt19937_64 wgen(1);
+                std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+                while (!stop.load(std::memory_order_relaxed)) {
+                    const std::string& id = ids[playerDis(wgen)];
+                    if (concurrent) {
+                        rankBoard.updateScore(id, scoreDis(wgen), timestamp++);
+                    } else {
+                        std::lock_guard<std::mutex> guard(lock);
+                        rankBoard.updateScore(id, scoreDis(wgen), timestamp++);
+                    }
+                    writes++;
+                }
+            });
+            std::vector<std::thread> threads;
+            for (int t = 0; t < readers; t++) {
+                threads.emplace_back([&, t] {
+                    std::mt19937_64 rgen(t + 100);
+                    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+                    int64_t count = 0;
+                    while (!stop.load(std::memory_order_relaxed)) {
+                        const std::string& id = ids[playerDis(rgen)];
+                        if (concurrent) {
+                            rankBoard.getRank(id);
+                        } else {
+                            std::lock_guard<std::mutex> guard(lock);
+                            rankBoard.getRank(id);
+                        }
+                        count++;
+                    }
+                    reads += count;
+                });
+            }
+            auto begin = Clock::now();
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            stop = true;
+            for (std::thread& t : threads) {
+                t.join();
+            }
+            writer.join();
+            double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+            std::cout << (concurrent ? "lock-free readers " : "mutex readers ") << readers << ": getRank "
+                      << reads / seconds / 1000 << " k/s, updateScore " << writes / seconds / 1000 << " k/s" << std::endl;
+        }
+    }
+}
+
+// 快照：生成时间和内存，单线程查询耗时，以及写线程不停更新并发布新快照时读线程的QPS
+static void runSnapshotBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    RankBoard rankBoard(12345);
+    std::vector<ScoreUpdate> all;
+    all.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        all.push_back(ScoreUpdate{ids[i], scoreDis(gen), 100000 + i});
+    }
+    rankBoard.updateScores(all);
+
+    auto begin = Clock::now();
+    std::shared_ptr<const RankSnapshot> snapshot = rankBoard.snapshot();
+    double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    std::cout << "snapshot " << playerCount << " players: " << buildMs << " ms, "
+              << snapshot->memoryBytes() / (1 << 20) << " MB" << std::endl;
+
+    bool match = true;
+    for (int i = 0; i < 1000 && match; i++) {
+        const std::string& id = ids[playerDis(gen)];
+        match = snapshot->getRank(id) == rankBoard.getRank(id);
+    }
+    std::cout << "snapshot ranks match board: " << (match ? "yes" : "NO") << std::endl;
+
+    const int queryCount = 1000000;
+    int64_t rankSum = 0;
+    begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        rankSum += snapshot->getRank(ids[playerDis(gen)]);
+    }
+    double rankNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    size_t nearbySum = 0;
+    begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        nearbySum += snapshot->getNearbyPlayers(ids[playerDis(gen)], 10).size();
+    }
+    double nearbyNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    std::cout << "snapshot getRank: " << rankNs / queryCount << " ns/op, getNearbyPlayers(10): " << nearbyNs / queryCount
+              << " ns/op (checksum " << rankSum + nearbySum << ")" << std::endl;
+
+    RankSnapshotPublisher publisher;
+    publisher.publish(snapshot);
+    snapshot.reset();
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int readers = 1; readers <= maxThreads; readers *= 2) {
+        std::atomic<bool> stop{false};
+        std::atomic<int64_t> reads{0};
+        int published = 0;
+        // 写线程每更新一万次发布一个新快照
+        std::thread writer([&] {
+            std::mt19937_64 wgen(1);
+            time_t timestamp = 100000 + playerCount;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 10000; i++) {
+                    rankBoard.updateScore(ids[playerDis(wgen)], scoreDis(wgen), timestamp++);
+                }
+                publisher.publish(rankBoard.snapshot());
+                published++;
+            }
+        });
+        std::vector<std::thread> threads;
+        for (int t = 0; t < readers; t++) {
+            threads.emplace_back([&, t] {
+                std::mt19937_64 rgen(t + 100);
+                std::shared_ptr<const RankSnapshot> cached;
+                int64_t count = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    publisher.refresh(cached);
+                    cached->getRank(ids[playerDis(rgen)]);
+                    count++;
+                }
+                reads += count;
+            });
+        }
+        begin = Clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        stop = true;
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        writer.join();
+        double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        std::cout << "snapshot readers " << readers << ": getRank " << reads / seconds / 1000 << " k/s, "
+                  << published << " snapshots published" << std::endl;
+    }
+}
+
+// 重启：逐条重放updateScore和从转储文件加载的耗时对比，加载后和原排行榜逐名比较，再验证损坏的文件会被拒绝
+static void runDumpBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    const std::string path = "RankBoard.bench.dump";
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    RankBoard rankBoard(12345);
+    auto begin = Clock::now();
+    for (int i = 0; i < playerCount; i++) {
+        rankBoard.updateScore(ids[i], scoreDis(gen), 100000 + i % 1000);
+    }
+    double replayMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+    begin = Clock::now();
+    bool dumped = rankBoard.dump(path, 42);
+    double dumpMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+    RankBoard loaded(54321);
+    uint64_t sequence = 0;
+    std::string error;
+    begin = Clock::now();
+    bool ok = dumped && loaded.load(path, &sequence, &error);
+    double loadMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    std::cout << "restart " << playerCount << " players: replay updateScore " << replayMs << " ms, dump " << dumpMs
+              << " ms, load " << loadMs << " ms" << (ok ? "" : " (load failed: " + error + ")") << std::endl;
+
+    bool match = ok && sequence == 42;
+    SkipListNode* a = rankBoard.getHeadNode()->level[0].forward;
+    SkipListNode* b = loaded.getHeadNode()->level[0].forward;
+    for (; match && a && b; a = a->level[0].forward, b = b->level[0].forward) {
+        match = a->score == b->score && a->timestamp == b->timestamp &&
+                rankBoard.playerTable().name(a->player) == loaded.playerTable().name(b->player);
+    }
+    match = match && !a && !b;
+    for (int i = 0; i < 1000 && match; i++) {
+        const std::string& id = ids[gen() % playerCount];
+        match = rankBoard.getRank(id) == loaded.getRank(id);
+    }
+    std::cout << "loaded board matches: " << (match ? "yes" : "NO") << std::endl;
+
+    // 改掉文件中间的一个字节
+    if (FILE* file = std::fopen(path.c_str(), "r+b")) {
+        std::fseek(file, sizeof(DumpHeader) + 100, SEEK_SET);
+        std::fputc(0x5A, file);
+        std::fclose(file);
+    }
+    RankBoard corrupted(1);
+    bool rejected = !corrupted.load(path, nullptr, &error);
+    std::cout << "corrupted dump rejected: " << (rejected ? "yes (" + error + ")" : "NO") << std::endl;
+    std::remove(path.c_str());
+}
+
+// 翻页：不同深度的getRange和原来getTopNPlayers(offset+limit)丢掉前缀的做法对比，
+// 再用游标从头翻到尾，一次没有修改，一次每页之间都有写入(只能按排序键重新定位)
+static void runRangeBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::vector<ScoreUpdate> all;
+    all.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        all.push_back(ScoreUpdate{"Player" + std::to_string(i), scoreDis(gen), 100000 + i % 1000});
+    }
+    RankBoard rankBoard(12345);
+    rankBoard.updateScores(all);
+
+    const int pageSize = 50;
+    for (int offset : {0, 10000, playerCount / 2, playerCount - pageSize}) {
+        if (offset < 0 || offset >= playerCount) {
+            continue;
+        }
+        const int queryCount = 10000;
+        size_t sum = 0;
+        auto begin = Clock::now();
+        for (int i = 0; i < queryCount; i++) {
+            sum += rankBoard.getRange(offset + 1, pageSize).size();
+        }
+        double rangeNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+        // 老做法越深越慢，次数按深度减少
+        int prefixCount = std::max(1, std::min(queryCount, 20000000 / (offset + pageSize)));
+        begin = Clock::now();
+        for (int i = 0; i < prefixCount; i++) {
+            std::vector<RankInfo> top = rankBoard.getTopNPlayers(offset + pageSize);
+            sum += top.size() - offset;
+        }
+        double prefixNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / prefixCount;
+        std::cout << "page at rank " << offset + 1 << ": getRange " << rangeNs << " ns, getTopNPlayers + drop prefix "
+                  << prefixNs << " ns (checksum " << sum << ")" << std::endl;
+    }
+
+    // 游标翻完整个排行榜，核对排名连续、顺序正确
+    for (bool writes : {false, true}) {
+        RankCursor cursor;
+        std::vector<RankInfo> page = rankBoard.getRange(1, pageSize, &cursor);
+        int64_t pages = 1;
+        int64_t seen = page.size();
+        bool ordered = true;
+        RankInfo last = page.back();
+        auto begin = Clock::now();
+        while (!cursor.done()) {
+            if (writes) {
+                // 新玩家排在最后，不影响已经翻过的部分
+                rankBoard.updateScore("Late" + std::to_string(pages), -1, 200000 + pages);
+            }
+            int expectRank = cursor.nextRank();
+            page = rankBoard.nextPage(cursor, pageSize);
+            ordered = ordered && !page.empty() && expectRank == seen + 1 &&
+                      (page[0].score < last.score || (page[0].score == last.score && page[0].timestamp >= last.timestamp));
+            seen += page.size();
+            last = page.back();
+            pages++;
+        }
+        double pageNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / pages;
+        std::cout << "cursor " << (writes ? "with a write between pages" : "without writes") << ": " << pages
+                  << " pages, " << pageNs << " ns/page, " << seen << " players, ordered: " << (ordered ? "yes" : "NO")
+                  << std::endl;
+    }
+
+    RankCursor cursor;
+    size_t inRange = rankBoard.getRangeByScore(500000, 400000, pageSize, &cursor).size();
+    while (!cursor.done()) {
+        inRange += rankBoard.nextPage(cursor, pageSize).size();
+    }
+    size_t expect = 0;
+    for (SkipListNode* cur = rankBoard.getHeadNode()->level[0].forward; cur; cur = cur->level[0].forward) {
+        expect += cur->score <= 500000 && cur->score >= 400000;
+    }
+    std::cout << "getRangeByScore [400000, 500000] paged: " << inRange << " players, expected " << expect << std::endl;
+}
+
+// 查询结果的几种形式：返回vector<RankInfo>(每次分配数组并拷贝每个playerId)、填调用方复用的buffer、visitor，
+// 统计每次查询的耗时和operator new次数，并发读模式下再测一遍
+static void runViewBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    // 真实的玩家id一般超过短字符串优化的长度，拷贝一次就要分配一次
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        std::string id = std::to_string(i);
+        ids.push_back("player-" + std::string(20 - id.size(), '0') + id);
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    std::vector<ScoreUpdate> all;
+    all.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        all.push_back(ScoreUpdate{ids[i], scoreDis(gen), 100000 + i % 1000});
+    }
+    const int queryCount = 200000;
+    std::vector<int> targets(queryCount);
+    for (int& t : targets) {
+        t = playerDis(gen);
+    }
+    for (bool concurrent : {false, true}) {
+        RankBoard rankBoard(12345, concurrent);
+        rankBoard.updateScores(all);
+        std::vector<RankView> buffer;
+        // 跑一遍queryCount次query，返回每次的耗时和分配次数
+        auto measure = [&](const char* name, auto query) {
+            int64_t sum = query(0);  // 预热，buffer的容量在这里分配好
+            uint64_t allocations = heapAllocations();
+            auto begin = Clock::now();
+            for (int i = 0; i < queryCount; i++) {
+                sum += query(i);
+            }
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+            double perQuery = double(heapAllocations() - allocations) / queryCount;
+            std::cout << (concurrent ? "concurrent " : "") << name << ": " << ns << " ns/op, " << perQuery
+                      << " allocations/op (checksum " << sum << ")" << std::endl;
+        };
+        measure("getTopNPlayers(10) vector<RankInfo>", [&](int) {
+            return int64_t(rankBoard.getTopNPlayers(10).size());
+        });
+        measure("getTopNPlayers(10) reused buffer", [&](int) {
+            return int64_t(rankBoard.getTopNPlayers(10, buffer));
+        });
+        measure("forEachTop(10)", [&](int) {
+            int64_t sum = 0;
+            rankBoard.forEachTop(10, [&](const RankView& view) { sum += view.playerId.size(); });
+            return sum / 26;
+        });
+        measure("getNearbyPlayers(10) vector<RankInfo>", [&](int i) {
+            return int64_t(rankBoard.getNearbyPlayers(ids[targets[i]], 10).size());
+        });
+        measure("getNearbyPlayers(10) reused buffer", [&](int i) {
+            return int64_t(rankBoard.getNearbyPlayers(ids[targets[i]], 10, buffer));
+        });
+        measure("forEachNearby(10)", [&](int i) {
+            int64_t sum = 0;
+            rankBoard.forEachNearby(ids[targets[i]], 10, [&](const RankView& view) { sum += view.playerId.size(); });
+            return sum / 26;
+        });
+    }
+}
+
+// 前K名缓存：Zipf分布挑玩家加分(少数活跃玩家占大部分更新，会慢慢爬到榜首)，统计缓存没动的更新比例和写入的额外开销，
+// 再比较读前100名的几种方式，最后一个写线程不停更新时多个读线程的吞吐
+static void runTopKBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    const int k = 100;
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::vector<int64_t> initial(playerCount);
+    std::vector<ScoreUpdate> all;
+    all.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        initial[i] = scoreDis(gen);
+        all.push_back(ScoreUpdate{ids[i], initial[i], 100000});
+    }
+    // Zipf(s=1)：第i个玩家被选中的概率正比于1/(i+1)，按累积分布二分查找
+    std::vector<double> cdf(playerCount);
+    double total = 0;
+    for (int i = 0; i < playerCount; i++) {
+        total += 1.0 / (i + 1);
+        cdf[i] = total;
+    }
+    std::uniform_real_distribution<double> zipfDis(0, total);
+    const int updateCount = 1000000;
+    std::vector<std::pair<int, int64_t>> updates;  // 玩家和加的分
+    updates.reserve(updateCount);
+    std::uniform_int_distribution<int64_t> deltaDis(1, 1000);
+    for (int i = 0; i < updateCount; i++) {
+        int player = static_cast<int>(std::lower_bound(cdf.begin(), cdf.end(), zipfDis(gen)) - cdf.begin());
+        updates.emplace_back(std::min(player, playerCount - 1), deltaDis(gen));
+    }
+
+    for (bool cached : {false, true}) {
+        RankBoard rankBoard(12345);
+        rankBoard.updateScores(all);
+        if (cached) {
+            rankBoard.setTopKCache(k);
+        }
+        std::vector<int64_t> scores = initial;
+        time_t timestamp = 100001;
+        auto begin = Clock::now();
+        for (const auto& u : updates) {
+            scores[u.first] += u.second;
+            rankBoard.updateScore(ids[u.first], scores[u.first], timestamp++);
+        }
+        double updateNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / updateCount;
+        std::cout << "zipf updateScore " << (cached ? "with" : "without") << " top-" << k << " cache: " << updateNs << " ns/op";
+        if (cached) {
+            TopKStats stats = rankBoard.topKStats();
+            std::vector<RankInfo> top = rankBoard.getTopNPlayers(k);
+            std::shared_ptr<const TopKList> list = rankBoard.getTopK();
+            bool match = list && list->players.size() == top.size();
+            for (size_t i = 0; match && i < top.size(); i++) {
+                match = list->players[i].playerId == top[i].playerId && list->players[i].score == top[i].score;
+            }
+            std::cout << ", cache untouched " << 100.0 * stats.skipped / updateCount << "%, patched " << stats.patched
+                      << ", matches board: " << (match ? "yes" : "NO");
+        }
+        std::cout << std::endl;
+    }
+
+    RankBoard rankBoard(12345, true);
+    rankBoard.updateScores(all);
+    rankBoard.setTopKCache(k);
+    const int queryCount = 200000;
+    std::vector<RankView> buffer;
+    std::shared_ptr<const TopKList> list;
+    size_t sum = 0;
+    auto begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        sum += rankBoard.getTopNPlayers(k).size();
+    }
+    double vectorNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+    begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        sum += rankBoard.getTopNPlayers(k, buffer);
+    }
+    double bufferNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+    begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        rankBoard.refreshTopK(list);
+        sum += list->players.size();
+    }
+    double cacheNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+    std::cout << "top " << k << ": getTopNPlayers " << vectorNs << " ns, reused buffer " << bufferNs << " ns, refreshTopK "
+              << cacheNs << " ns (checksum " << sum << ")" << std::endl;
+
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (bool useCache : {false, true}) {
+        for (int readers = 1; readers <= maxThreads; readers *= 2) {
+            std::atomic<bool> stop{false};
+            std::atomic<int64_t> reads{0};
+            int64_t writes = 0;
+            std::thread writer([&] {
+                std::vector<int64_t> scores = initial;
+                time_t timestamp = 200000;
+                for (size_t i = 0; !stop.load(std::memory_order_relaxed); i = (i + 1) % updates.size()) {
+                    const auto& u = updates[i];
+                    scores[u.first] += u.second;
+                    rankBoard.updateScore(ids[u.first], scores[u.first], timestamp++);
+                    writes++;
+                }
+            });
+            std::vector<std::thread> threads;
+            for (int t = 0; t < readers; t++) {
+                threads.emplace_back([&] {
+                    std::vector<RankView> views;
+                    std::shared_ptr<const TopKList> cachedList;
+                    int64_t count = 0;
+                    while (!stop.load(std::memory_order_relaxed)) {
+                        if (useCache) {
+                            rankBoard.refreshTopK(cachedList);
+                        } else {
+                            rankBoard.getTopNPlayers(k, views);
+                        }
+                        count++;
+                    }
+                    reads += count;
+                });
+            }
+            begin = Clock::now();
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            stop = true;
+            for (std::thread& t : threads) {
+                t.join();
+            }
+            writer.join();
+            double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+            std::cout << (useCache ? "refreshTopK readers " : "getTopNPlayers readers ") << readers << ": "
+                      << reads / seconds / 1000 << " k/s, updateScore " << writes / seconds / 1000 << " k/s" << std::endl;
+        }
+    }
+}
+
+// 分数分布：countInScoreRange/rankOfScore/percentileOf/scoreAtPercentile和遍历第0层的做法对比
+static void runPercentileBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    std::vector<ScoreUpdate> all;
+    all.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        all.push_back(ScoreUpdate{ids[i], scoreDis(gen), 100000 + i % 1000});
+    }
+    RankBoard rankBoard(12345);
+    rankBoard.updateScores(all);
+
+    const int queryCount = 200000;
+    int64_t sum = 0;
+    auto begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        int64_t lo = scoreDis(gen);
+        sum += rankBoard.countInScoreRange(lo, lo + 100000);
+    }
+    double rangeNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+    begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        sum += rankBoard.rankOfScore(scoreDis(gen));
+    }
+    double rankNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+    double percentSum = 0;
+    begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        percentSum += rankBoard.percentileOf(ids[playerDis(gen)]);
+    }
+    double percentileNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+    begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        int64_t score;
+        if (rankBoard.scoreAtPercentile(1 + i % 100, score)) {
+            sum += score;
+        }
+    }
+    double scoreNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+    std::cout << "countInScoreRange " << rangeNs << " ns, rankOfScore " << rankNs << " ns, percentileOf " << percentileNs
+              << " ns, scoreAtPercentile " << scoreNs << " ns (checksum " << sum + int64_t(percentSum) << ")" << std::endl;
+
+    // 原来只能遍历第0层数一遍
+    const int scanCount = 20;
+    int64_t lo = 400000, hi = 500000;
+    int scanned = 0;
+    begin = Clock::now();
+    for (int i = 0; i < scanCount; i++) {
+        scanned = 0;
+        for (SkipListNode* cur = rankBoard.getHeadNode()->level[0].forward; cur; cur = cur->level[0].forward) {
+            scanned += cur->score >= lo && cur->score <= hi;
+        }
+    }
+    double scanNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / scanCount;
+    std::cout << "count [" << lo << ", " << hi << "]: level-0 walk " << scanNs << " ns, " << scanned
+              << " players, countInScoreRange " << rankBoard.countInScoreRange(lo, hi) << " players" << std::endl;
+}
+
+// 时间窗口：日榜、周榜、赛季榜各playerCount个玩家，更新流越过日榜边界，统计每次updateScore的耗时分布和触发轮换那一次的耗时，
+// 和原来在写线程里清空一个同样大的排行榜对比
+static void runWindowBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    const time_t day = 86400;
+    const time_t start = 1700000000 / day * day;
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    WindowedRankBoard windowed({{"daily", day, 7}, {"weekly", 7 * day, 4}, {"season", 0, 2}}, start, 12345);
+    auto begin = Clock::now();
+    for (int i = 0; i < playerCount; i++) {
+        windowed.updateScore(ids[i], scoreDis(gen), start + i % (day / 2));
+    }
+    double fillMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    std::cout << "3 windows x " << playerCount << " players: " << fillMs * 1e6 / playerCount << " ns/updateScore" << std::endl;
+
+    // 前一半在第一天，后一半在第二天的第一个小时
+    const int updateCount = 200000;
+    std::vector<double> latencies(updateCount);
+    double rolloverNs = 0;
+    for (int i = 0; i < updateCount; i++) {
+        time_t timestamp = i < updateCount / 2 ? start + day - 1 : start + day + i % 3600;
+        const std::string& id = ids[playerDis(gen)];
+        int64_t score = scoreDis(gen);
+        auto opBegin = Clock::now();
+        windowed.updateScore(id, score, timestamp);
+        latencies[i] = std::chrono::duration<double, std::nano>(Clock::now() - opBegin).count();
+        if (i == updateCount / 2) {
+            rolloverNs = latencies[i];
+        }
+    }
+    std::vector<double> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    double maxBefore = *std::max_element(latencies.begin(), latencies.begin() + updateCount / 2);
+    double maxAfter = *std::max_element(latencies.begin() + updateCount / 2 + 1, latencies.end());
+    std::cout << "updateScore across a daily rollover: p50 " << sorted[updateCount / 2] << " ns, p99.9 "
+              << sorted[updateCount * 999 / 1000] << " ns, max before " << maxBefore << " ns, rollover op " << rolloverNs
+              << " ns, max after (background freeze running) " << maxAfter << " ns" << std::endl;
+    begin = Clock::now();
+    windowed.waitIdle();
+    double freezeMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    WindowedRankBoard::FinishedWindow yesterday;
+    bool frozen = windowed.finished(0, 0, yesterday);
+    std::cout << "background freeze finished " << freezeMs << " ms after the last update, yesterday: "
+              << (frozen ? std::to_string(yesterday.snapshot->size()) + " players" : "missing")
+              << ", today: " << windowed.current(0)->memoryStats().players << " players" << std::endl;
+
+    // 原来的做法：写线程里清空或者销毁一个同样大的排行榜
+    for (bool concurrent : {false, true}) {
+        auto rankBoard = std::make_unique<RankBoard>(12345, concurrent);
+        std::vector<ScoreUpdate> all;
+        all.reserve(playerCount);
+        for (int i = 0; i < playerCount; i++) {
+            all.push_back(ScoreUpdate{ids[i], scoreDis(gen), start + i});
+        }
+        rankBoard->updateScores(all);
+        begin = Clock::now();
+        rankBoard->clear();
+        double clearMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        rankBoard->updateScores(all);
+        begin = Clock::now();
+        rankBoard.reset();
+        double destroyMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        std::cout << (concurrent ? "concurrent-read " : "") << "board with " << playerCount << " players: clear "
+                  << clearMs << " ms, destroy " << destroyMs << " ms on the writer thread" << std::endl;
+    }
+}
+
+// 注册表：playerCount个玩家分到每个约200人的排行榜里(公会榜)，对比各自独立的RankBoard、共用玩家表的注册表，
+// 以及内存预算只有一半时的注册表，再测访问常驻和已压缩的排行榜的耗时
+static void runRegistryBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    const int boardCount = std::max(1, playerCount / 200);
+    std::vector<std::string> ids;
+    std::vector<std::string> names;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    for (int i = 0; i < boardCount; i++) {
+        names.push_back("guild" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::vector<int64_t> scores(playerCount);
+    for (auto& score : scores) {
+        score = scoreDis(gen);
+    }
+
+    size_t separateBytes = 0;
+    {
+        std::vector<std::unique_ptr<RankBoard>> boards;
+        for (int i = 0; i < boardCount; i++) {
+            boards.push_back(std::make_unique<RankBoard>(12345 + i));
+        }
+        for (int i = 0; i < playerCount; i++) {
+            boards[i % boardCount]->updateScore(ids[i], scores[i], i);
+        }
+        for (auto& board : boards) {
+            MemoryStats stats = board->memoryStats();
+            separateBytes += sizeof(RankBoard) + stats.reservedBytes + stats.indexBytes + stats.playerTableBytes;
+        }
+    }
+    std::cout << boardCount << " separate boards, " << playerCount << " players: " << separateBytes / 1024 << " KB"
+              << std::endl;
+
+    for (bool budgeted : {false, true}) {
+        RankBoardRegistry registry(0, 12345);
+        auto begin = Clock::now();
+        for (int i = 0; i < playerCount; i++) {
+            registry.updateScore(names[i % boardCount], ids[i], scores[i], i);
+        }
+        double fillNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / playerCount;
+        RegistryStats stats = registry.stats();
+        if (budgeted) {
+            registry.setMemoryBudget(stats.residentBytes / 2);
+            stats = registry.stats();
+        }
+        size_t total = stats.residentBytes + stats.spilledBytes + stats.playerTableBytes;
+        std::cout << "registry" << (budgeted ? " with half budget" : "") << ": " << total / 1024 << " KB ("
+                  << stats.residentBoards << " resident boards " << stats.residentBytes / 1024 << " KB, "
+                  << stats.boards - stats.residentBoards << " spilled " << stats.spilledBytes / 1024
+                  << " KB, player table " << stats.playerTableBytes / 1024 << " KB), " << fillNs << " ns/updateScore"
+                  << std::endl;
+        if (!budgeted) {
+            continue;
+        }
+        // 最近用过的一半常驻，轮流访问最早的一半会不断压缩和恢复
+        const int accessCount = 20000;
+        std::uniform_int_distribution<int> hotDis(boardCount / 2, boardCount - 1);
+        begin = Clock::now();
+        for (int i = 0; i < accessCount; i++) {
+            registry.getTopNPlayers(names[hotDis(gen)], 10);
+        }
+        double hotNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / accessCount;
+        uint64_t reloadsBefore = registry.stats().reloads;
+        begin = Clock::now();
+        for (int i = 0; i < accessCount; i++) {
+            registry.getTopNPlayers(names[i % (boardCount / 2 + 1)], 10);
+        }
+        double coldNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / accessCount;
+        stats = registry.stats();
+        std::cout << "getTopNPlayers(10): resident " << hotNs << " ns, cycling through spilled boards " << coldNs
+                  << " ns (" << stats.reloads - reloadsBefore << " reloads, " << stats.spills << " spills in total)"
+                  << std::endl;
+    }
+}
+
+// 跳表和计数B+树正面对比：同样的玩家和分数，比较每个玩家占用的内存和各操作的耗时，结果先核对一致
+template <class Board>
+static void runEngineBenchmark(const char* name, int playerCount, const std::vector<std::string>& ids,
+                               std::vector<RankInfo>& check) {
+    using Clock = std::chrono::steady_clock;
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    size_t heapBefore = heapBytesInUse();
+    auto board = std::make_unique<Board>();
+    auto begin = Clock::now();
+    for (int i = 0; i < playerCount; i++) {
+        board->updateScore(ids[i], scoreDis(gen), 100000 + i);
+    }
+    double insertNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / playerCount;
+    double bytesPerPlayer = double(heapBytesInUse() - heapBefore) / playerCount;
+    MemoryStats memory = board->memoryStats();
+    double structureBytes = double(memory.reservedBytes + memory.indexBytes) / playerCount;
+    std::vector<PlayerHandle> handles(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        handles[i] = board->getHandle(ids[i]);
+    }
+
+    const int opCount = 1000000;
+    begin = Clock::now();
+    for (int i = 0; i < opCount; i++) {
+        board->updateScore(handles[playerDis(gen)], scoreDis(gen), 200000 + i);
+    }
+    double updateNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / opCount;
+    int64_t sum = 0;
+    begin = Clock::now();
+    for (int i = 0; i < opCount; i++) {
+        sum += board->getRank(handles[playerDis(gen)]);
+    }
+    double rankNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / opCount;
+    const int queryCount = 100000;
+    begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        sum += board->getTopNPlayers(100).size();
+    }
+    double topNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+    begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        sum += board->getNearbyPlayers(ids[playerDis(gen)], 10).size();
+    }
+    double nearbyNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+    std::cout << name << ": " << bytesPerPlayer << " bytes/player (" << structureBytes << " without player ids), insert " << insertNs << " ns, updateScore "
+              << updateNs << " ns, getRank " << rankNs << " ns, getTopNPlayers(100) " << topNs
+              << " ns, getNearbyPlayers(10) " << nearbyNs << " ns (checksum " << sum << ")" << std::endl;
+    std::vector<RankInfo> top = board->getTopNPlayers(1000);
+    if (check.empty()) {
+        check = top;
+        return;
+    }
+    bool same = check.size() == top.size();
+    for (size_t i = 0; same && i < top.size(); i++) {
+        same = check[i].playerId == top[i].playerId && check[i].score == top[i].score;
+    }
+    std::cout << "top 1000 identical: " << (same ? "yes" : "NO") << std::endl;
+}
+
+static void runBTreeBenchmark(int playerCount) {
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::vector<RankInfo> check;
+    runEngineBenchmark<RankBoard>("skip list", playerCount, ids, check);
+    runEngineBenchmark<BTreeRankBoard>("counted B+tree", playerCount, ids, check);
+}
+
+// 分层排行榜：前10万名精确，其余按分数分桶计数；和全部放在跳表里的RankBoard比较内存、耗时和尾部排名的误差
+static void runTieredBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    std::vector<int64_t> scores(playerCount);
+    for (auto& score : scores) {
+        score = scoreDis(gen);
+    }
+    TieredOptions options;
+    options.headSize = std::min(100000, std::max(1, playerCount / 10));
+    options.minScore = 0;
+    options.maxScore = 1000000;
+    options.buckets = 1 << 16;
+    RankBoard exact(12345);
+    TieredRankBoard tiered(options, 12345);
+    for (int i = 0; i < playerCount; i++) {
+        exact.updateScore(ids[i], scores[i], 100000 + i);
+        tiered.updateScore(ids[i], scores[i], 100000 + i);
+    }
+    // 一半更新小幅加分，一半随机，头尾之间不断有人升降
+    const int opCount = 1000000;
+    std::vector<std::pair<int, int64_t>> updates(opCount);
+    for (int i = 0; i < opCount; i++) {
+        int player = playerDis(gen);
+        scores[player] = i % 2 ? scoreDis(gen) : std::min<int64_t>(1000000, scores[player] + 1000);
+        updates[i] = {player, scores[player]};
+    }
+    double updateNs[2];
+    for (int which = 0; which < 2; which++) {
+        auto begin = Clock::now();
+        for (int i = 0; i < opCount; i++) {
+            if (which == 0) {
+                exact.updateScore(ids[updates[i].first], updates[i].second, 200000 + i);
+            } else {
+                tiered.updateScore(ids[updates[i].first], updates[i].second, 200000 + i);
+            }
+        }
+        updateNs[which] = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / opCount;
+    }
+    const int queryCount = 200000;
+    int64_t sum = 0;
+    double errorSum = 0;
+    int maxError = 0;
+    int tailQueries = 0;
+    int headMismatches = 0;
+    auto begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        sum += exact.getRank(ids[(i * 7919) % playerCount]);
+    }
+    double exactRankNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+    begin = Clock::now();
+    for (int i = 0; i < queryCount; i++) {
+        sum += tiered.getRank(ids[(i * 7919) % playerCount]);
+    }
+    double tieredRankNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+    for (int i = 0; i < queryCount; i++) {
+        const std::string& id = ids[(i * 7919) % playerCount];
+        int error = std::abs(tiered.getRank(id) - exact.getRank(id));
+        if (tiered.isExact(id)) {
+            headMismatches += error != 0;
+            continue;
+        }
+        errorSum += error;
+        maxError = std::max(maxError, error);
+        tailQueries++;
+    }
+    TierStats stats = tiered.tierStats();
+    std::vector<RankInfo> exactTop = exact.getTopNPlayers(static_cast<int>(stats.headPlayers));
+    std::vector<RankInfo> tieredTop = tiered.getTopNPlayers(static_cast<int>(stats.headPlayers));
+    bool topSame = exactTop.size() == tieredTop.size();
+    for (size_t i = 0; topSame && i < exactTop.size(); i++) {
+        topSame = exactTop[i].playerId == tieredTop[i].playerId;
+    }
+    MemoryStats memory = exact.memoryStats();
+    std::cout << "skip list: " << (memory.reservedBytes + memory.indexBytes) / (1024 * 1024) << " MB, updateScore "
+              << updateNs[0] << " ns, getRank " << exactRankNs << " ns" << std::endl;
+    std::cout << "tiered (head " << stats.headPlayers << ", tail " << stats.tailPlayers << "): "
+              << (stats.headBytes + stats.tailBytes) / (1024 * 1024) << " MB (head " << stats.headBytes / (1024 * 1024)
+              << " MB, tail " << stats.tailBytes / (1024 * 1024) << " MB), updateScore " << updateNs[1]
+              << " ns, getRank " << tieredRankNs << " ns, " << stats.promoted << " promoted, " << stats.demoted
+              << " demoted" << std::endl;
+    std::cout << "player ids: " << memory.playerTableBytes / (1024 * 1024) << " MB in each board; top "
+              << stats.headPlayers << " identical: " << (topSame ? "yes" : "NO") << ", head rank mismatches "
+              << headMismatches << ", tail rank error mean " << (tailQueries ? errorSum / tailQueries : 0) << " max "
+              << maxError << " (checksum " << sum << ")" << std::endl;
+}
+
+// 预写日志：对比开关日志时updateScore的吞吐，再做一次检查点，继续写一半更新后从转储加日志恢复，和原排行榜比较
+static void runJournalBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    const std::string dumpPath = "RankBoard.bench.dump";
+    const std::string journalPath = "RankBoard.bench.journal";
+    std::remove(dumpPath.c_str());
+    std::remove(journalPath.c_str());
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::vector<ScoreUpdate> updates;
+    updates.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        updates.push_back(ScoreUpdate{ids[playerDis(gen)], scoreDis(gen), 100000 + i % 1000});
+    }
+
+    RankBoard plain(12345);
+    auto begin = Clock::now();
+    for (const ScoreUpdate& u : updates) {
+        plain.updateScore(u.playerId, u.score, u.timestamp);
+    }
+    double plainNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+
+    RankJournal journal;
+    if (!journal.open(journalPath)) {
+        std::cout << "cannot open " << journalPath << std::endl;
+        return;
+    }
+    RankBoard rankBoard(12345);
+    rankBoard.setJournal(&journal);
+    begin = Clock::now();
+    for (const ScoreUpdate& u : updates) {
+        rankBoard.updateScore(u.playerId, u.score, u.timestamp);
+    }
+    double journalNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    begin = Clock::now();
+    journal.sync();
+    double syncMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    long journalBytes = 0;
+    if (FILE* file = std::fopen(journalPath.c_str(), "rb")) {
+        std::fseek(file, 0, SEEK_END);
+        journalBytes = std::ftell(file);
+        std::fclose(file);
+    }
+    std::cout << "updateScore " << playerCount << " times: journal off " << plainNs / playerCount << " ns/op, on "
+              << journalNs / playerCount << " ns/op, final sync " << syncMs << " ms, " << journal.flushCount()
+              << " flushes, " << journalBytes / 1048576.0 << " MB" << std::endl;
+
+    // 检查点之后再写一半更新，模拟崩溃前最后一段只在日志里的数据
+    begin = Clock::now();
+    bool ok = rankBoard.checkpoint(dumpPath);
+    double checkpointMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    for (int i = 0; i < playerCount / 2; i++) {
+        rankBoard.updateScore(ids[playerDis(gen)], scoreDis(gen), 200000 + i % 1000);
+    }
+    journal.sync();
+
+    RankBoard recovered(54321);
+    std::string error;
+    begin = Clock::now();
+    ok = ok && recovered.recover(dumpPath, journalPath, &error);
+    double recoverMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    std::cout << "checkpoint " << checkpointMs << " ms, recover dump + " << playerCount / 2 << " journal records "
+              << recoverMs << " ms" << (ok ? "" : " (failed: " + error + ")") << std::endl;
+
+    bool match = ok;
+    SkipListNode* a = rankBoard.getHeadNode()->level[0].forward;
+    SkipListNode* b = recovered.getHeadNode()->level[0].forward;
+    for (; match && a && b; a = a->level[0].forward, b = b->level[0].forward) {
+        match = a->score == b->score && a->timestamp == b->timestamp &&
+                rankBoard.playerTable().name(a->player) == recovered.playerTable().name(b->player);
+    }
+    match = match && !a && !b;
+    std::cout << "recovered board matches: " << (match ? "yes" : "NO") << std::endl;
+    rankBoard.setJournal(nullptr);
+    journal.close();
+    std::remove(dumpPath.c_str());
+    std::remove(journalPath.c_str());
+}
+
+// 分片榜：先和单个榜对比前N名、排名和前后N名是否完全一致，再测1到8个分片、每个分片一个写线程的写入吞吐
+static void runShardedBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    {
+        // 分数和时间戳范围小，让同分同时间戳按playerid排序的情况足够多
+        std::mt19937_64 gen(12345);
+        RankBoard single(12345);
+        ShardedRankBoard sharded(8, 12345);
+        for (int i = 0; i < playerCount; i++) {
+            int64_t score = gen() % 1000;
+            time_t timestamp = gen() % 100;
+            single.updateScore(ids[i], score, timestamp);
+            sharded.updateScore(ids[i], score, timestamp);
+        }
+        auto same = [](const std::vector<RankInfo>& a, const std::vector<RankInfo>& b) {
+            if (a.size() != b.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < a.size(); i++) {
+                if (a[i].playerId != b[i].playerId || a[i].score != b[i].score || a[i].timestamp != b[i].timestamp) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        bool match = same(single.getTopNPlayers(1000), sharded.getTopNPlayers(1000));
+        for (int i = 0; i < 1000 && match; i++) {
+            const std::string& id = ids[gen() % playerCount];
+            match = single.getRank(id) == sharded.getRank(id) &&
+                    same(single.getNearbyPlayers(id, 11), sharded.getNearbyPlayers(id, 11));
+        }
+        std::cout << "sharded(8) results match single board: " << (match ? "yes" : "NO") << std::endl;
+
+        const int queryCount = 100000;
+        std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+        int64_t rankSum = 0;
+        auto begin = Clock::now();
+        for (int i = 0; i < queryCount; i++) {
+            rankSum += sharded.getRank(ids[playerDis(gen)]);
+        }
+        double rankNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        begin = Clock::now();
+        size_t topSum = 0;
+        for (int i = 0; i < 1000; i++) {
+            topSum += sharded.getTopNPlayers(100).size();
+        }
+        double topNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        std::cout << "sharded(8) getRank: " << rankNs / queryCount << " ns/op, getTopNPlayers(100): " << topNs / 1000
+                  << " ns/op (checksum " << rankSum + topSum << ")" << std::endl;
+    }
+
+    for (int shardCount = 1; shardCount <= 8; shardCount *= 2) {
+        ShardedRankBoard sharded(shardCount, 12345);
+        std::vector<ScoreUpdate> all;
+        all.reserve(playerCount);
+        for (int i = 0; i < playerCount; i++) {
+            all.push_back(ScoreUpdate{ids[i], i % 1000000, 100000});
+        }
+        sharded.updateScores(all);
+        std::atomic<bool> stop{false};
+        std::atomic<int64_t> writes{0};
+        std::vector<std::thread> writers;
+        for (int t = 0; t < shardCount; t++) {
+            writers.emplace_back([&, t] {
+                std::mt19937_64 gen(t + 1);
+                std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+                int64_t count = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    sharded.updateScore(ids[playerDis(gen)], gen() % 1000000, 100001 + count);
+                    count++;
+                }
+                writes += count;
+            });
+        }
+        auto begin = Clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        stop = true;
+        for (std::thread& t : writers) {
+            t.join();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        std::cout << "sharded(" << shardCount << ") " << shardCount << " writers: updateScore "
+                  << writes / seconds / 1000 << " k/s" << std::endl;
+    }
+}
+
+// 一致性检查：一个写线程随机更新、批量更新和清空重灌，读线程检查每次读到的结果是否自洽，
+// 返回发现的错误个数
+static int runStress(int playerCount, int seconds) {
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    RankBoard rankBoard(12345, true);
+    // 分数和时间戳范围都很小，制造大量同分同时间戳的玩家
+    std::vector<ScoreUpdate> all;
+    for (int i = 0; i < playerCount; i++) {
+        all.push_back(ScoreUpdate{ids[i], i % 100, i % 10});
+    }
+    rankBoard.updateScores(all);
+    rankBoard.setTopKCache(50);
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> errors{0};
+    std::atomic<int64_t> reads{0};
+    int64_t writes = 0;
+    std::thread writer([&] {
+        std::mt19937_64 gen(1);
+        std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+        while (!stop.load(std::memory_order_relaxed)) {
+            int op = gen() % 1000;
+            if (op == 0) {
+                rankBoard.clear();
+                rankBoard.updateScores(all);
+            } else if (op < 10) {
+                std::vector<ScoreUpdate> batch;
+                for (int i = 0; i < 100; i++) {
+                    batch.push_back(ScoreUpdate{ids[playerDis(gen)], int64_t(gen() % 100), time_t(gen() % 10)});
+                }
+                rankBoard.updateScores(batch);
+            } else {
+                rankBoard.updateScore(ids[playerDis(gen)], gen() % 100, gen() % 10);
+            }
+            writes++;
+        }
+    });
+    // 相邻两名必须严格按分数、时间戳、playerid排好，不能重复
+    auto ordered = [](const std::vector<RankInfo>& list) {
+        for (size_t i = 1; i < list.size(); i++) {
+            const RankInfo& a = list[i-1];
+            const RankInfo& b = list[i];
+            if (a.score != b.score ? a.score < b.score
+                : a.timestamp != b.timestamp ? a.timestamp > b.timestamp : a.playerId >= b.playerId) {
+                return false;
+            }
+        }
+        return true;
+    };
+    int readers = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 gen(t + 100);
+            std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+            RankCursor cursor;
+            std::shared_ptr<const TopKList> topK;
+            int64_t count = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const std::string& id = ids[playerDis(gen)];
+                int rank = rankBoard.getRank(id);
+                if (rank < 0 || rank > playerCount) {
+                    errors++;
+                }
+                std::vector<RankInfo> top = rankBoard.getTopNPlayers(50);
+                if (!ordered(top)) {
+                    errors++;
+                }
+                // 清空重灌的瞬间玩家可能不在榜上，在榜上时结果里一定有自己
+                std::vector<RankInfo> nearby = rankBoard.getNearbyPlayers(id, 11);
+                bool self = nearby.empty();
+                for (const RankInfo& info : nearby) {
+                    self = self || info.playerId == id;
+                }
+                if (!ordered(nearby) || !self) {
+                    errors++;
+                }
+                // visitor：排名连续，在榜上时结果里一定有自己
+                int lastRank = 0;
+                bool viewSelf = false;
+                rankBoard.forEachNearby(id, 7, [&](const RankView& view) {
+                    if (lastRank != 0 && view.rank != lastRank + 1) {
+                        errors++;
+                    }
+                    viewSelf = viewSelf || view.playerId == id;
+                    lastRank = view.rank;
+                });
+                if (lastRank != 0 && !viewSelf) {
+                    errors++;
+                }
+                // 翻页：每一页内部有序，排名不超过玩家数
+                std::vector<RankInfo> page = cursor.done() ? rankBoard.getRange(playerDis(gen) + 1, 20, &cursor)
+                                                           : rankBoard.nextPage(cursor, 20);
+                if (!ordered(page) || cursor.nextRank() > playerCount + 1) {
+                    errors++;
+                }
+                // 前K名缓存：排名从1连续，按分数从高到低
+                rankBoard.refreshTopK(topK);
+                for (size_t i = 0; i < topK->players.size(); i++) {
+                    const RankView& view = topK->players[i];
+                    if (view.rank != static_cast<int>(i) + 1 || (i > 0 && view.score > topK->players[i-1].score)) {
+                        errors++;
+                    }
+                }
+                count += 6;
+            }
+            reads += count;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    writer.join();
+    std::cout << "stress " << seconds << "s, " << readers << " readers: " << reads << " reads, " << writes
+              << " writes, " << errors << " errors" << std::endl;
+    return errors;
+}
+
+// incrementScore：小幅加分时节点只在原来的位置附近挪动，和删除再插入比较；删除再插入是并发读模式下的路径，多了原子写和epoch回收
+// 玩家多时两边都受第一次从上往下查找的缓存未命中限制，差别主要在小排行榜上
+static void runIncrementBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    RankBoard local(12345);
+    RankBoard reinsert(12345, true);
+    for (int i = 0; i < playerCount; i++) {
+        int64_t score = scoreDis(gen);
+        local.updateScore(ids[i], score, 100000 + i);
+        reinsert.updateScore(ids[i], score, 100000 + i);
+    }
+    const int opCount = 1000000;
+    const int64_t maxDeltas[] = {20, 10000, 1000000};
+    std::vector<std::pair<int, int64_t>> ops(opCount);
+    time_t timestamp = 200000;
+    for (int64_t maxDelta : maxDeltas) {
+        std::uniform_int_distribution<int64_t> deltaDis(1, maxDelta);
+        for (auto& op : ops) {
+            op = {playerDis(gen), deltaDis(gen)};
+        }
+        double ns[2];
+        int64_t sum = 0;
+        for (int which = 0; which < 2; which++) {
+            RankBoard& board = which == 0 ? local : reinsert;
+            auto begin = Clock::now();
+            for (int i = 0; i < opCount; i++) {
+                sum += board.incrementScore(ids[ops[i].first], ops[i].second, timestamp + i).rank;
+            }
+            ns[which] = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / opCount;
+        }
+        timestamp += opCount;
+        std::cout << "incrementScore +[1, " << maxDelta << "]: local move " << ns[0] << " ns, remove+insert " << ns[1]
+                  << " ns (checksum " << sum << ")" << std::endl;
+    }
+    std::cout << "incrementScore rankings match: " << (sameRanking(local, reinsert) ? "yes" : "NO") << std::endl;
+}
+
+// 增量流和整份切片对比：每一轮1%的玩家改分数，副本拉增量追上，和重新生成快照、整份加载比耗时和传输的字节数
+// 字节数按rank_server协议的编码算：增量每条35字节加playerId，切片每行18字节加playerId
+static void runReplicaBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    RankDeltaFeed feed;
+    RankBoard primary(12345);
+    primary.setDeltaFeed(&feed);
+    for (int i = 0; i < playerCount; i++) {
+        primary.updateScore(ids[i], scoreDis(gen), 100000 + i);
+    }
+    // 基础快照
+    std::shared_ptr<const RankSnapshot> base = primary.snapshot();
+    RankReplica follower(1);
+    RankReplica lagger(2);
+    follower.loadBase(*base, feed.lastSequence());
+    lagger.loadBase(*base, feed.lastSequence());
+    size_t sliceBytes = 0;
+    for (int rank = 1; rank <= base->size(); rank++) {
+        sliceBytes += 18 + base->playerId(base->at(rank)).size();
+    }
+    base.reset();
+
+    const int rounds = 10;
+    const int perRound = std::max(1, playerCount / 100);
+    double applyMs = 0;
+    double sliceMs = 0;
+    size_t deltaBytes = 0;
+    size_t deltaCount = 0;
+    std::vector<RankDelta> deltas;
+    time_t timestamp = 200000;
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < perRound; i++) {
+            primary.updateScore(ids[playerDis(gen)], scoreDis(gen), timestamp++);
+        }
+        // 副本：读增量并应用
+        auto begin = Clock::now();
+        uint64_t through = 0;
+        feed.read(follower.sequence(), 1 << 20, deltas, through);
+        follower.apply(deltas, through);
+        applyMs += std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        for (const RankDelta& delta : deltas) {
+            deltaBytes += 35 + delta.playerId.size();
+        }
+        deltaCount += deltas.size();
+        // 切片：生成快照，另一边整份加载
+        begin = Clock::now();
+        std::shared_ptr<const RankSnapshot> slice = primary.snapshot();
+        RankReplica fresh(3);
+        fresh.loadBase(*slice, 0);
+        sliceMs += std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    }
+    auto begin = Clock::now();
+    bool compacted = false;
+    uint64_t through = 0;
+    feed.read(lagger.sequence(), 1024, deltas, through, &compacted);
+    lagger.apply(deltas, through);
+    double lagMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    size_t lagDeltas = deltas.size();
+    DeltaFeedStats stats = feed.stats();
+    std::cout << "replica per round (" << perRound << " updates): deltas " << deltaCount / rounds << ", "
+              << deltaBytes / rounds / 1024 << " KB, read+apply " << applyMs / rounds << " ms; full slice "
+              << sliceBytes / 1024 << " KB, snapshot+load " << sliceMs / rounds << " ms" << std::endl;
+    std::cout << "replica lagging " << rounds << " rounds: " << rounds * perRound << " updates compacted to " << lagDeltas
+              << (compacted ? "" : " (not compacted)") << ", read+apply " << lagMs << " ms; feed " << stats.records
+              << " records, " << stats.bytes / (1024 * 1024) << " MB" << std::endl;
+    std::cout << "replica ranking matches primary: follower " << (sameRanking(primary, follower.board()) ? "yes" : "NO")
+              << ", lagging " << (sameRanking(primary, lagger.board()) ? "yes" : "NO") << std::endl;
+}
+
+// 内置统计：混合更新和查询后打印stats()，编译时打开RANKBOARD_STATS和不打开各跑一次，对比每轮耗时就是统计本身的开销
+static void runStatsBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    RankBoard rankBoard(12345);
+    for (int i = 0; i < playerCount; i++) {
+        rankBoard.updateScore(ids[i], scoreDis(gen), 100000 + i);
+    }
+    std::vector<PlayerHandle> handles(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        handles[i] = rankBoard.getHandle(ids[i]);
+    }
+    // 每轮：2次更新、2次查排名，前10名、前后10名和一页排名各一次
+    const int roundCount = 200000;
+    int64_t sum = 0;
+    auto begin = Clock::now();
+    for (int i = 0; i < roundCount; i++) {
+        rankBoard.updateScore(handles[playerDis(gen)], scoreDis(gen), 200000 + i);
+        rankBoard.updateScore(handles[playerDis(gen)], scoreDis(gen), 200000 + i);
+        sum += rankBoard.getRank(handles[playerDis(gen)]);
+        sum += rankBoard.getRank(handles[playerDis(gen)]);
+        sum += rankBoard.getTopNPlayers(10).size();
+        sum += rankBoard.getNearbyPlayers(ids[playerDis(gen)], 10).size();
+        sum += rankBoard.getRange(1 + playerDis(gen), 10).size();
+    }
+    double roundNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / roundCount;
+    std::cout << "mixed round " << roundNs << " ns (checksum " << sum << ")" << std::endl;
+    std::cout << rankBoard.stats().toString();
+}
+
+int main(int argc, char* argv[]) {
+    // ./RankBoardBench suite [最大玩家数] [uniform|zipf|ties]：和std::set基准对比的压测套件
+    if (argc > 1 && std::string(argv[1]) == "suite") {
+        SuiteOptions options = suiteOptions(argc - 2, argv + 2);
+        runSuite<RankBoard>("RankBoard", options, [] { return std::make_unique<RankBoard>(12345); });
+        runSuite<BTreeRankBoard>("BTreeRankBoard", options, [] { return std::make_unique<BTreeRankBoard>(); });
+        runSuite<SetRankBoard>("std::set", options, [] { return std::make_unique<SetRankBoard>(); });
+        return 0;
+    }
+    // ./RankBoardBench stress [秒数]
+    if (argc > 1 && std::string(argv[1]) == "stress") {
+        return runStress(10000, argc > 2 ? std::atoi(argv[2]) : 10) == 0 ? 0 : 1;
+    }
+    // ./RankBoardBench [玩家数] [core|scaling|sharded|snapshot|dump|journal|range|views|topk|percentile|windows|registry|btree|tiered|increment|replica|stats]，不指定项目时全部跑一遍
+    int playerCount = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    std::string only = argc > 2 ? argv[2] : "";
+    if (only.empty() || only == "core") {
+        runBenchmark(playerCount);
+    }
+    if (only.empty() || only == "scaling") {
+        runReadScaling(playerCount);
+    }
+    if (only.empty() || only == "sharded") {
+        runShardedBenchmark(playerCount);
+    }
+    if (only.empty() || only == "snapshot") {
+        runSnapshotBenchmark(playerCount);
+    }
+    if (only.empty() || only == "dump") {
+        runDumpBenchmark(playerCount);
+    }
+    if (only.empty() || only == "journal") {
+        runJournalBenchmark(playerCount);
+    }
+    if (only.empty() || only == "range") {
+        runRangeBenchmark(playerCount);
+    }
+    if (only.empty() || only == "views") {
+        runViewBenchmark(playerCount);
+    }
+    if (only.empty() || only == "topk") {
+        runTopKBenchmark(playerCount);
+    }
+    if (only.empty() || only == "percentile") {
+        runPercentileBenchmark(playerCount);
+    }
+    if (only.empty() || only == "windows") {
+        runWindowBenchmark(playerCount);
+    }
+    if (only.empty() || only == "registry") {
+        runRegistryBenchmark(playerCount);
+    }
+    if (only.empty() || only == "btree") {
+        runBTreeBenchmark(playerCount);
+    }
+    if (only.empty() || only == "tiered") {
+        runTieredBenchmark(playerCount);
+    }
+    if (only.empty() || only == "increment") {
+        runIncrementBenchmark(playerCount);
+    }
+    if (only.empty() || only == "replica") {
+        runReplicaBenchmark(playerCount);
+    }
+    if (only.empty() || only == "stats") {
+        runStatsBenchmark(playerCount);
+    }
+    return 0;
+}
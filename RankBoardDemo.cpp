@@ -0,0 +1,83 @@
+#include "RankBoard.h"
+
+int main() {
+    //插入积分
+    RankBoard rankBoard;
+    rankBoard.updateScore("Player5", 62,100005);
+    rankBoard.updateScore("Player6", 60,100006);
+    // 更新积分测试，注意此时相同分数新加入的玩家应排在后面
+    rankBoard.updateScore("Player7", 60,100007);
+    rankBoard.updateScore("Player8", 40,100008);
+    rankBoard.updateScore("Player9", 30,100009);
+
+    rankBoard.updateScore("Player1", 10,100001);
+    rankBoard.updateScore("Player2", 80,100002);
+    rankBoard.updateScore("Player3", 70,100003);
+    // Player4积分更新2次
+    rankBoard.updateScore("Player4", 65,100004);
+    rankBoard.updateScore("Player4", 60,100005);
+    // 按顺序打印排名
+    rankBoard.print();
+
+    // 查询排名测试
+    std::cout << "Player1 rank: " << rankBoard.getRank("Player1") << std::endl;
+    std::cout << "Player2 rank: " << rankBoard.getRank("Player2") << std::endl;
+    std::cout << "Player3 rank: " << rankBoard.getRank("Player3") << std::endl;
+    std::cout << "Player4 rank: " << rankBoard.getRank("Player4") << std::endl;
+    std::cout << "Player5 rank: " << rankBoard.getRank("Player5") << std::endl;
+    std::cout << "Player6 rank: " << rankBoard.getRank("Player6") << std::endl;
+    std::cout << "Player7 rank: " << rankBoard.getRank("Player7") << std::endl;
+    std::cout << "Player8 rank: " << rankBoard.getRank("Player8") << std::endl;
+    std::cout << "Player9 rank: " << rankBoard.getRank("Player9") << std::endl;
+
+    {
+        // 获取前N名玩家测试 top5
+        std::vector<RankInfo> topPlayers = rankBoard.getTopNPlayers(5);
+        std::cout << "Top 5 players: " << std::endl;
+        for (const auto& player : topPlayers) {
+            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+        }
+    }
+
+    { 
+        // 获取前N名玩家测试 top20
+        std::vector<RankInfo> topPlayers = rankBoard.getTopNPlayers(20);
+        std::cout << "Top 20 players: " << std::endl;
+        for (const auto& player : topPlayers) {
+            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+        }
+    }
+    {
+        // 获取自己名次前后N名玩家测试 
+        std::cout << "Nearby players of Player5:  Nearby :5" << std::endl;
+        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 5);
+        for (const auto& player : nearbyPlayers) {
+            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+        }
+    }
+    {
+        // 获取自己名次前后N名玩家测试 
+        std::cout << "Nearby players of Player5: Nearby :4" << std::endl;
+        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 4);
+        for (const auto& player : nearbyPlayers) {
+            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+        }
+    }
+    {
+        // 获取自己名次前后N名玩家测试 
+        std::cout << "Nearby players of Player5: Nearby :2 " << std::endl;
+        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 2);
+        for (const auto& player : nearbyPlayers) {
+            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+        }
+    }
+    {
+        // 获取自己名次前后N名玩家测试 
+        std::cout << "Nearby players of Player5: Nearby :200" << std::endl;
+        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 200);
+        for (const auto& player : nearbyPlayers) {
+            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+        }
+    }
+    return 0;
+}
@@ -1,126 +1,712 @@
 #include "RankBoardDense.h"
 
-// 生成随机层数
+#include <cmath>
+
+bool TieList::before(const PlayerEntry& a, const PlayerEntry& b, const PlayerTable& players) {
+    if (a.timestamp != b.timestamp) {
+        return a.timestamp < b.timestamp;
+    }
+    return a.player != b.player && players.name(a.player) < players.name(b.player);
+}
+
+TieList::~TieList() {
+    if (root) {
+        freeTree(root, depth);
+    }
+}
+
+TieList::Block* TieList::newBlock() {
+    void* mem = pool->allocate(sizeof(Block));
+    return new (mem) Block{PlayerEntryList(SlabStlAllocator<PlayerEntry>(pool)), nullptr, nullptr};
+}
+
+// 从块链表里摘下再释放
+void TieList::freeBlock(Block* block) {
+    if (block->prev) {
+        block->prev->next = block->next;
+    }
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+    block->~Block();
+    pool->deallocate(block, sizeof(Block));
+}
+
+void TieList::freeTree(void* node, int level) {
+    if (level == 0) {
+        freeBlock(static_cast<Block*>(node));
+        return;
+    }
+    Inner* inner = static_cast<Inner*>(node);
+    for (int i = 0; i < inner->count; i++) {
+        freeTree(inner->child[i], level - 1);
+    }
+    pool->deallocate(inner, sizeof(Inner));
+}
+
+int TieList::sizeOf(const void* node, int level) {
+    if (level == 0) {
+        return static_cast<int>(static_cast<const Block*>(node)->entries.size());
+    }
+    const Inner* inner = static_cast<const Inner*>(node);
+    int n = 0;
+    for (int i = 0; i < inner->count; i++) {
+        n += inner->size[i];
+    }
+    return n;
+}
+
+const PlayerEntry& TieList::lastOf(const void* node, int level) {
+    if (level == 0) {
+        return static_cast<const Block*>(node)->entries.back();
+    }
+    const Inner* inner = static_cast<const Inner*>(node);
+    return inner->last[inner->count - 1];
+}
+
+int TieList::findChild(const Inner* inner, const PlayerEntry& entry, const PlayerTable& players) {
+    int lo = 0;
+    int hi = inner->count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (before(inner->last[mid], entry, players)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void TieList::insert(const PlayerEntry& entry, const PlayerTable& players) {
+    count++;
+    if (!root) {
+        Block* block = newBlock();
+        block->entries.push_back(entry);
+        root = block;
+        depth = 0;
+        return;
+    }
+    void* sibling = insertInto(root, depth, entry, players);
+    if (!sibling) {
+        return;
+    }
+    // 根拆开了，长高一层
+    Inner* inner = static_cast<Inner*>(pool->allocate(sizeof(Inner)));
+    inner->count = 2;
+    inner->child[0] = root;
+    inner->child[1] = sibling;
+    for (int i = 0; i < 2; i++) {
+        inner->size[i] = sizeOf(inner->child[i], depth);
+        inner->last[i] = lastOf(inner->child[i], depth);
+    }
+    root = inner;
+    depth++;
+}
+
+void* TieList::insertInto(void* node, int level, const PlayerEntry& entry, const PlayerTable& players) {
+    if (level == 0) {
+        Block* block = static_cast<Block*>(node);
+        PlayerEntryList& entries = block->entries;
+        auto pos = std::lower_bound(entries.begin(), entries.end(), entry, [&players](const PlayerEntry& x, const PlayerEntry& y) {
+            return before(x, y, players);
+        });
+        entries.insert(pos, entry);
+        if (entries.size() < BLOCK_SIZE) {
+            return nullptr;
+        }
+        // 后一半搬到新块里，接在链表里这一块的后面
+        Block* half = newBlock();
+        half->entries.assign(entries.begin() + BLOCK_SIZE / 2, entries.end());
+        entries.resize(BLOCK_SIZE / 2);
+        half->prev = block;
+        half->next = block->next;
+        if (block->next) {
+            block->next->prev = half;
+        }
+        block->next = half;
+        return half;
+    }
+    Inner* inner = static_cast<Inner*>(node);
+    int i = findChild(inner, entry, players);
+    void* sibling = insertInto(inner->child[i], level - 1, entry, players);
+    if (!sibling) {
+        inner->size[i]++;
+        inner->last[i] = lastOf(inner->child[i], level - 1);
+        return nullptr;
+    }
+    return addChild(inner, i, sibling, level);
+}
+
+void* TieList::addChild(Inner* inner, int i, void* sibling, int level) {
+    inner->size[i] = sizeOf(inner->child[i], level - 1);
+    inner->last[i] = lastOf(inner->child[i], level - 1);
+    for (int j = inner->count; j > i + 1; j--) {
+        inner->size[j] = inner->size[j-1];
+        inner->last[j] = inner->last[j-1];
+        inner->child[j] = inner->child[j-1];
+    }
+    inner->size[i+1] = sizeOf(sibling, level - 1);
+    inner->last[i+1] = lastOf(sibling, level - 1);
+    inner->child[i+1] = sibling;
+    if (++inner->count < FANOUT) {
+        return nullptr;
+    }
+    // 后一半搬到新的内部节点
+    Inner* half = static_cast<Inner*>(pool->allocate(sizeof(Inner)));
+    half->count = FANOUT - FANOUT / 2;
+    for (int j = 0; j < half->count; j++) {
+        half->size[j] = inner->size[FANOUT / 2 + j];
+        half->last[j] = inner->last[FANOUT / 2 + j];
+        half->child[j] = inner->child[FANOUT / 2 + j];
+    }
+    inner->count = FANOUT / 2;
+    return half;
+}
+
+void TieList::removeChild(Inner* inner, int i) {
+    for (int j = i + 1; j < inner->count; j++) {
+        inner->size[j-1] = inner->size[j];
+        inner->last[j-1] = inner->last[j];
+        inner->child[j-1] = inner->child[j];
+    }
+    inner->count--;
+}
+
+void TieList::erase(const PlayerEntry& entry, const PlayerTable& players) {
+    if (!root || !eraseFrom(root, depth, entry, players)) {
+        return;
+    }
+    count--;
+    if (depth == 0) {
+        if (count == 0) {
+            freeBlock(static_cast<Block*>(root));
+            root = nullptr;
+        }
+        return;
+    }
+    // 根只剩一个子树时降一层
+    while (depth > 0 && static_cast<Inner*>(root)->count <= 1) {
+        Inner* inner = static_cast<Inner*>(root);
+        root = inner->count == 1 ? inner->child[0] : nullptr;
+        pool->deallocate(inner, sizeof(Inner));
+        depth = root ? depth - 1 : 0;
+    }
+}
+
+bool TieList::eraseFrom(void* node, int level, const PlayerEntry& entry, const PlayerTable& players) {
+    if (level == 0) {
+        PlayerEntryList& entries = static_cast<Block*>(node)->entries;
+        auto pos = std::lower_bound(entries.begin(), entries.end(), entry, [&players](const PlayerEntry& x, const PlayerEntry& y) {
+            return before(x, y, players);
+        });
+        if (pos == entries.end() || pos->player != entry.player) {
+            return false;
+        }
+        entries.erase(pos);
+        return true;
+    }
+    Inner* inner = static_cast<Inner*>(node);
+    int i = findChild(inner, entry, players);
+    if (!eraseFrom(inner->child[i], level - 1, entry, players)) {
+        return false;
+    }
+    if (--inner->size[i] == 0) {
+        freeTree(inner->child[i], level - 1);
+        removeChild(inner, i);
+        return true;
+    }
+    inner->last[i] = lastOf(inner->child[i], level - 1);
+    // 相邻两块都很空时合并，块数不会越删越多
+    if (level == 1 && i + 1 < inner->count && inner->size[i] + inner->size[i+1] <= static_cast<int>(BLOCK_SIZE / 2)) {
+        Block* block = static_cast<Block*>(inner->child[i]);
+        Block* next = static_cast<Block*>(inner->child[i+1]);
+        block->entries.insert(block->entries.end(), next->entries.begin(), next->entries.end());
+        inner->size[i] += inner->size[i+1];
+        inner->last[i] = inner->last[i+1];
+        freeBlock(next);
+        removeChild(inner, i + 1);
+    }
+    return true;
+}
+
+int TieList::indexOf(const PlayerEntry& entry, const PlayerTable& players) const {
+    if (!root) {
+        return 0;
+    }
+    int index = 0;
+    const void* node = root;
+    for (int level = depth; level > 0; level--) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        int i = findChild(inner, entry, players);
+        for (int j = 0; j < i; j++) {
+            index += inner->size[j];
+        }
+        node = inner->child[i];
+    }
+    const PlayerEntryList& entries = static_cast<const Block*>(node)->entries;
+    auto pos = std::lower_bound(entries.begin(), entries.end(), entry, [&players](const PlayerEntry& x, const PlayerEntry& y) {
+        return before(x, y, players);
+    });
+    return index + static_cast<int>(pos - entries.begin());
+}
+
+int TieList::upperBound(const PlayerEntry& entry, const PlayerTable& players) const {
+    if (!root) {
+        return 0;
+    }
+    int index = 0;
+    const void* node = root;
+    for (int level = depth; level > 0; level--) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        // 第一个最后一个玩家排在entry之后的子树，没有时全部玩家都不排在entry之后
+        int lo = 0;
+        int hi = inner->count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (!before(entry, inner->last[mid], players)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        for (int j = 0; j < lo; j++) {
+            index += inner->size[j];
+        }
+        if (lo == inner->count) {
+            return index;
+        }
+        node = inner->child[lo];
+    }
+    const PlayerEntryList& entries = static_cast<const Block*>(node)->entries;
+    auto pos = std::upper_bound(entries.begin(), entries.end(), entry, [&players](const PlayerEntry& x, const PlayerEntry& y) {
+        return before(x, y, players);
+    });
+    return index + static_cast<int>(pos - entries.begin());
+}
+
+TieList::Iterator TieList::at(int index) const {
+    if (index < 0 || index >= count) {
+        return end();
+    }
+    const void* node = root;
+    for (int level = depth; level > 0; level--) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        int i = 0;
+        while (index >= inner->size[i]) {
+            index -= inner->size[i];
+            i++;
+        }
+        node = inner->child[i];
+    }
+    return Iterator(static_cast<const Block*>(node), index);
+}
+
+TieList::Iterator TieList::begin() const {
+    if (!root) {
+        return end();
+    }
+    const void* node = root;
+    for (int level = depth; level > 0; level--) {
+        node = static_cast<const Inner*>(node)->child[0];
+    }
+    return Iterator(static_cast<const Block*>(node), 0);
+}
+
+uint64_t SkipList::nextRandom() {
+    uint64_t z = (rngState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// 生成随机层数，按p=1/4的几何分布，一次随机数每两位决定是否再升一层
 int SkipList::randomLevel() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dis(1, MAX_LVL);
-    return dis(gen);
+    uint64_t bits = nextRandom();
+    int height = 1;
+    while (height < MAX_LVL && (bits & 3) == 0) {
+        height++;
+        bits >>= 2;
+    }
+    return height;
 }
-bool SkipList::checkThisNode(SkipListNode* node,std::string playerId){
-    for (size_t i = 0; i < node->playerRankInfo.size(); i++){
-        if(playerId == node->playerRankInfo[i].playerId ){
-            return true;
+
+SkipListNode* SkipList::createNode(int height, int64_t score) {
+    void* mem = pool.allocate(sizeof(SkipListNode) + height * sizeof(SkipListLevel));
+    return new (mem) SkipListNode(score, height, &pool);
+}
+
+void SkipList::freeNode(SkipListNode* node) {
+    size_t bytes = sizeof(SkipListNode) + node->height * sizeof(SkipListLevel);
+    node->~SkipListNode();
+    pool.deallocate(node, bytes);
+}
+
+void SkipList::destroyNodes() {
+    SkipListNode* curr = head;
+    while (curr) {
+        SkipListNode* next = curr->level[0].forward;
+        curr->~SkipListNode();
+        curr = next;
+    }
+}
+
+SkipList::~SkipList() {
+    destroyNodes();
+}
+
+void SkipList::clear() {
+    destroyNodes();
+    pool.release();
+    std::vector<PlayerSlot>().swap(index);
+    length = 0;
+    players = 0;
+    level = 1;
+    head = createNode(MAX_LVL, 0);
+    RANKBOARD_STATS_ONLY(counters.resetStructure();)
+}
+
+MemoryStats SkipList::memoryStats() const {
+    MemoryStats stats;
+    stats.players = players;
+    stats.reservedBytes = pool.bytesReserved();
+    stats.usedBytes = pool.bytesInUse();
+    stats.indexBytes = index.capacity() * sizeof(PlayerSlot);
+    stats.playerTableBytes = 0;
+    return stats;
+}
+
+// 查找玩家所在的节点（根据玩家句柄查找）,通过索引O(1)定位
+SkipListNode* SkipList::find(PlayerHandle player) {
+    if (player >= index.size()) {
+        return nullptr;
+    }
+    return index[player].node;
+}
+// 每个分数只有一个节点，按分数从上往下找到分数更高的最后一个节点，同时累加span和players
+bool SkipList::getRank(PlayerHandle player, int& nodesBefore, int& playersBefore) {
+    SkipListNode* node = find(player);
+    if (!node) {
+        return false;
+    }
+    SkipListNode* curr = head;
+    nodesBefore = 0;
+    playersBefore = 0;
+    RANKBOARD_STATS_ONLY(int visited = level;)
+    for (int i = level-1; i >= 0; i--) {
+        while (curr->level[i].forward && curr->level[i].forward->score > node->score) {
+            nodesBefore += curr->level[i].span;
+            playersBefore += curr->level[i].players;
+            curr = curr->level[i].forward;
+            RANKBOARD_STATS_ONLY(visited++;)
         }
     }
-    return false;
+    RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+    return true;
 }
-// 查找节点（根据 playerid 查找）,这里只知道playerid不知道分数，只能线性查找
-SkipListNode* SkipList::find(const std::string& playerid) {
+
+int SkipList::getPosition(PlayerHandle player) {
+    int nodesBefore, playersBefore;
+    if (!getRank(player, nodesBefore, playersBefore)) {
+        return -1;
+    }
+    const PlayerSlot& slot = index[player];
+    return playersBefore + slot.node->playerRankInfo.indexOf(PlayerEntry{player, slot.timestamp}, *playerTable);
+}
+// 按排名获取节点 从1开始
+SkipListNode* SkipList::getNodeByRank(int rank) {
+    if (rank < 1 || rank > length) {
+        return nullptr;
+    }
     SkipListNode* curr = head;
-    while (curr->next[0] && !checkThisNode(curr->next[0],playerid)) {
-        curr = curr->next[0];
+    int traversed = 0;
+    RANKBOARD_STATS_ONLY(int visited = 0;)
+    for (int i = level-1; i >= 0; i--) {
+        while (curr->level[i].forward && traversed + curr->level[i].span <= rank) {
+            traversed += curr->level[i].span;
+            curr = curr->level[i].forward;
+            RANKBOARD_STATS_ONLY(visited++;)
+        }
+        RANKBOARD_STATS_ONLY(visited++;)
+        if (traversed == rank) {
+            RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+            return curr;
+        }
     }
-    return curr->next[0];
+    RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+    return nullptr;
 }
-// 获得玩家排名 从1开始
-int SkipList::getRank(const std::string& playerid) {
+// 按玩家数从上往下找，停在累计玩家数不超过position的最后一个节点，它的下一个节点就包含第position个玩家
+SkipListNode* SkipList::getNodeByPosition(int position, int& offset) {
+    if (position < 0 || position >= players) {
+        return nullptr;
+    }
     SkipListNode* curr = head;
-    int rank = 0;
-    while (curr->next[0] &&  !checkThisNode(curr->next[0],playerid)) {
-        curr = curr->next[0];
-        rank++;
+    int traversed = 0;
+    RANKBOARD_STATS_ONLY(int visited = level;)
+    for (int i = level-1; i >= 0; i--) {
+        while (curr->level[i].forward && traversed + curr->level[i].players <= position) {
+            traversed += curr->level[i].players;
+            curr = curr->level[i].forward;
+            RANKBOARD_STATS_ONLY(visited++;)
+        }
     }
-    if (curr->next[0]){
-        return rank;
+    RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+    offset = position - traversed;
+    return curr->level[0].forward;
+}
+
+SkipListNode* SkipList::firstAtMost(int64_t score, int& playersBefore) {
+    SkipListNode* curr = head;
+    playersBefore = 0;
+    RANKBOARD_STATS_ONLY(int visited = level;)
+    for (int i = level-1; i >= 0; i--) {
+        while (curr->level[i].forward && curr->level[i].forward->score > score) {
+            playersBefore += curr->level[i].players;
+            curr = curr->level[i].forward;
+            RANKBOARD_STATS_ONLY(visited++;)
+        }
     }
-    return -1;
+    RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+    return curr->level[0].forward;
 }
-// 插入节点
-void SkipList::insert(int64_t score, const std::string& playerid, time_t timestamp) {
-    int level = randomLevel();
-    //std::cout<< "level="<<level<<std::endl;
-    SkipListNode* update[MAX_LVL];
+
+void SkipList::resetFinger(Finger& finger) {
     for (int i = 0; i < MAX_LVL; i++) {
-        update[i] = nullptr;
+        finger.update[i] = head;
+        finger.rank[i] = 0;
+        finger.players[i] = 0;
     }
-    // 找到每一层链表中的前置节点
-    SkipListNode* curr = head;
-    for (int i = MAX_LVL-1 ; i >= 0; i--) {
-        while (curr->next[i] && (curr->next[i]->score >= score) ) {
-            curr = curr->next[i];
+}
+
+// 每个分数只有一个节点，手指只按分数前进，停在分数大于score的最后一个节点，
+// 这样每一层的前置节点都跨过了score所在的节点。某一层需要前进时它下面的层也一定需要前进，
+// 从第0层往上找到最高需要前进的层，只从这一层开始往下找
+void SkipList::seek(Finger& finger, int64_t score) {
+    auto before = [score](const SkipListNode* node) {
+        return node->score > score;
+    };
+    int top = -1;
+    while (top + 1 < level) {
+        SkipListNode* forward = finger.update[top+1]->level[top+1].forward;
+        if (!forward || !before(forward)) {
+            break;
+        }
+        top++;
+    }
+    if (top < 0) {
+        return;
+    }
+    SkipListNode* curr = finger.update[top];
+    int rank = finger.rank[top];
+    int count = finger.players[top];
+    RANKBOARD_STATS_ONLY(int visited = top + 2;)
+    for (int i = top; i >= 0; i--) {
+        // 下层原来的位置可能比从上层走下来的位置更靠后
+        if (finger.rank[i] > rank) {
+            curr = finger.update[i];
+            rank = finger.rank[i];
+            count = finger.players[i];
+        }
+        while (curr->level[i].forward && before(curr->level[i].forward)) {
+            rank += curr->level[i].span;
+            count += curr->level[i].players;
+            curr = curr->level[i].forward;
+            RANKBOARD_STATS_ONLY(visited++;)
         }
-        update[i] = curr;
+        finger.update[i] = curr;
+        finger.rank[i] = rank;
+        finger.players[i] = count;
+    }
+    RANKBOARD_STATS_ONLY(counters.recordVisits(visited);)
+}
+
+// 手指需要按分数查找过
+void SkipList::insertAt(Finger& finger, int64_t score, PlayerHandle player, time_t timestamp) {
+    SkipListNode** update = finger.update;
+    int* rank = finger.rank;
+    int* count = finger.players;
+    if (player >= index.size()) {
+        index.resize(player + 1, PlayerSlot{nullptr, 0});
     }
+    index[player] = PlayerSlot{nullptr, timestamp};
     // 如果第0层已存在这个分数的节点
-    if(update[0]&& (update[0]->score == score))
+    SkipListNode* node = update[0]->level[0].forward;
+    if(node && node->score == score)
     {
-        auto &tmp = update[0]->playerRankInfo.emplace_back();
-        tmp.playerId = playerid;
-        tmp.score = score;
-        tmp.timestamp = timestamp;
+        node->playerRankInfo.insert(PlayerEntry{player, timestamp}, *playerTable);
+        RANKBOARD_STATS_ONLY(counters.tieGroupResized(node->playerRankInfo.size() - 1, node->playerRankInfo.size());)
+        // 每一层的前置节点都跨过了这个节点
+        for (int i = 0; i < level; i++) {
+            update[i]->level[i].players++;
+        }
+        index[player].node = node;
+        players++;
         return ; 
     }
-    // 新建节点
-    SkipListNode* newNode = new SkipListNode(score, playerid, timestamp);
-    for (int i = 0; i < level; i++) {
-        newNode->next[i] = update[i]->next[i];
-        update[i]->next[i] = newNode;
+    int height = randomLevel();
+    //std::cout<< "level="<<height<<std::endl;
+    // 新节点比当前最高层还高，新增的层前置节点都是头节点
+    if (height > level) {
+        for (int i = level; i < height; i++) {
+            rank[i] = 0;
+            count[i] = 0;
+            update[i] = head;
+            update[i]->level[i].span = length;
+            update[i]->level[i].players = players;
+        }
+        level = height;
+    }
+    // 新建节点，拆分前置节点的span和players
+    SkipListNode* newNode = createNode(height, score);
+    newNode->playerRankInfo.insert(PlayerEntry{player, timestamp}, *playerTable);
+    RANKBOARD_STATS_ONLY(counters.nodeAdded(height);)
+    RANKBOARD_STATS_ONLY(counters.tieGroupResized(0, 1);)
+    for (int i = 0; i < height; i++) {
+        newNode->level[i].forward = update[i]->level[i].forward;
+        update[i]->level[i].forward = newNode;
+        newNode->level[i].span = update[i]->level[i].span - (rank[0] - rank[i]);
+        update[i]->level[i].span = (rank[0] - rank[i]) + 1;
+        newNode->level[i].players = update[i]->level[i].players - (count[0] - count[i]);
+        update[i]->level[i].players = (count[0] - count[i]) + 1;
+    }
+    // 更高的层跨过了新节点
+    for (int i = height; i < level; i++) {
+        update[i]->level[i].span++;
+        update[i]->level[i].players++;
     }
+    length++;
+    players++;
+    index[player].node = newNode;
 }
 
-// 删除节点
-void SkipList::remove(const std::string& playerid) {
-    SkipListNode* node =  find(playerid);
-    if (!node){
-        return;
-    }
+// 手指需要按节点的分数查找过，每一层的前置节点都跨过了这个节点，节点只剩这一个玩家时才摘掉节点
+void SkipList::removeAt(Finger& finger, SkipListNode* node, const PlayerEntry& entry) {
+    SkipListNode** update = finger.update;
+    node->playerRankInfo.erase(entry, *playerTable);
+    RANKBOARD_STATS_ONLY(counters.tieGroupResized(node->playerRankInfo.size() + 1, node->playerRankInfo.size());)
+    players--;
     
-    if (node->playerRankInfo.size() > 1){
+    if (!node->playerRankInfo.empty()){
         //当这个节点存在多个数据，只删自己这一个数据
-        for (auto itr = node->playerRankInfo.begin(); itr!= node->playerRankInfo.end();itr++ )
-        {
-            if(itr->playerId == playerid)
-            {
-                node->playerRankInfo.erase(itr);
-                return ;
-            }
-        }  
-    }else{
-        // 这个节点只有一个数据，删除节点
-        SkipListNode* update[MAX_LVL];
-        for (int i = 0; i < MAX_LVL; i++) {
-            update[i] = nullptr;
+        for (int i = 0; i < level; i++) {
+            update[i]->level[i].players--;
         }
-
-        SkipListNode* curr = head;
-        for (int i =0; i < MAX_LVL; i++) {
-            while (curr->next[i] &&  !checkThisNode(curr->next[i],playerid)) {
-                curr = curr->next[i];
+    }else{
+        for (int i = 0; i < level; i++) {
+            if (update[i]->level[i].forward == node) {
+                update[i]->level[i].span += node->level[i].span - 1;
+                update[i]->level[i].players += node->level[i].players - 1;
+                update[i]->level[i].forward = node->level[i].forward;
+            } else {
+                update[i]->level[i].span--;
+                update[i]->level[i].players--;
             }
-            update[i] = curr;
         }
-
-        for (int i = 0; i < MAX_LVL; i++) {
-            if (update[i] && update[i]->next[i] == node) {
-                update[i]->next[i] = node->next[i];
-            }
+        // 最高层空了就降层
+        while (level > 1 && head->level[level-1].forward == nullptr) {
+            level--;
         }
-        delete node;
+        length--;
+        RANKBOARD_STATS_ONLY(counters.nodeRemoved(node->height);)
+        freeNode(node);
+    }
+}
+
+// 插入节点
+void SkipList::insert(int64_t score, PlayerHandle player, time_t timestamp) {
+    // 找到每一层链表中的前置节点，从当前最高层开始
+    Finger finger;
+    resetFinger(finger);
+    seek(finger, score);
+    insertAt(finger, score, player, timestamp);
+}
+
+// 删除节点
+void SkipList::remove(PlayerHandle player) {
+    SkipListNode* node =  find(player);
+    if (!node){
+        return;
     }
+    // 每个分数只有一个节点，按分数从上往下找前置节点，节点不摘掉时也要更新它们跨过的玩家数
+    Finger finger;
+    resetFinger(finger);
+    seek(finger, node->score);
+    removeAt(finger, node, PlayerEntry{player, index[player].timestamp});
+    index[player].node = nullptr;
+}
+
+// 手指只能往分数低的方向走，先处理分数高的那一头，另一头从手指的位置接着找
+void SkipList::update(PlayerHandle player, int64_t score, time_t timestamp) {
+    SkipListNode* node = find(player);
+    Finger finger;
+    resetFinger(finger);
+    if (!node) {
+        seek(finger, score);
+        insertAt(finger, score, player, timestamp);
+        return;
+    }
+    PlayerEntry old{player, index[player].timestamp};
+    if (node->score == score) {
+        // 玩家还在原来的节点里，跨过的节点数和玩家数都不变
+        node->playerRankInfo.erase(old, *playerTable);
+        node->playerRankInfo.insert(PlayerEntry{player, timestamp}, *playerTable);
+        index[player].timestamp = timestamp;
+    } else if (score < node->score) {
+        seek(finger, node->score);
+        removeAt(finger, node, old);
+        seek(finger, score);
+        insertAt(finger, score, player, timestamp);
+    } else {
+        int64_t oldScore = node->score;
+        seek(finger, score);
+        insertAt(finger, score, player, timestamp);
+        seek(finger, oldScore);
+        removeAt(finger, node, old);
+    }
+}
+
+void SkipList::insertSorted(const std::vector<SkipListEntry>& entries) {
+    Finger finger;
+    resetFinger(finger);
+    for (const SkipListEntry& entry : entries) {
+        seek(finger, entry.score);
+        insertAt(finger, entry.score, entry.player, entry.timestamp);
+    }
+}
+
+void SkipList::removeSorted(const std::vector<PlayerHandle>& handles) {
+    Finger finger;
+    resetFinger(finger);
+    for (PlayerHandle player : handles) {
+        SkipListNode* node = find(player);
+        seek(finger, node->score);
+        removeAt(finger, node, PlayerEntry{player, index[player].timestamp});
+        index[player].node = nullptr;
+    }
+}
+
+void SkipList::beginAppend() {
+    resetFinger(tail);
+}
+
+// 分数不高于已有的节点，手指每次最多越过最后一个节点，同分时insertAt直接并入它
+void SkipList::append(int64_t score, PlayerHandle player, time_t timestamp) {
+    seek(tail, score);
+    insertAt(tail, score, player, timestamp);
 }
 
 // 打印最底层跳表，包含所有插入的元素
-void SkipList::print() {
-    SkipListNode* curr = head->next[0];
+void SkipList::print(const PlayerTable& players) {
+    SkipListNode* curr = head->level[0].forward;
     int nodeIndex = 1;
     while (curr) {
         std::cout << "nodeIndex= "<< nodeIndex;  
-        for (size_t i = 0; i < curr->playerRankInfo.size(); i++){
-            std::cout << ",playerId= " <<  curr->playerRankInfo[i].playerId << ",score =  " << curr->playerRankInfo[i].score<<". " ;
+        for (const PlayerEntry& entry : curr->playerRankInfo){
+            std::cout << ",playerId= " <<  players.name(entry.player) << ",score =  " << curr->score<<". " ;
         }
         std::cout <<std::endl;  
-        curr = curr->next[0];
+        curr = curr->level[0].forward;
         nodeIndex++;
     }
 }
@@ -130,45 +716,232 @@ SkipListNode* SkipList::getHeadNode(){
 }
 
 void RankBoard::print(){
-    skipList.print();
+    skipList.print(*players);
+}
+
+SkipListNode* RankBoard::getHeadNode(){
+    return skipList.getHeadNode();
+}
+
+int RankBoard::getNodeCount(){
+    return skipList.size();
+}
+
+int RankBoard::getPlayerCount(){
+    return skipList.playerCount();
+}
+
+void RankBoard::clear(){
+    version++;
+    skipList.clear();
+}
+
+MemoryStats RankBoard::memoryStats() const{
+    MemoryStats stats = skipList.memoryStats();
+    stats.playerTableBytes = players->memoryBytes();
+    return stats;
+}
+
+BoardStatsReport RankBoard::stats() const {
+#ifdef RANKBOARD_STATS
+    return skipList.boardStats().report();
+#else
+    return BoardStatsReport();
+#endif
+}
+
+bool RankBoard::dump(const std::string& path, uint64_t sequence) {
+    DumpWriter writer;
+    if (!writer.open(path, DUMP_DENSE, sequence)) {
+        return false;
+    }
+    for (SkipListNode* cur = skipList.getHeadNode()->level[0].forward; cur; cur = cur->level[0].forward) {
+        for (const PlayerEntry& entry : cur->playerRankInfo) {
+            writer.append(cur->score, entry.timestamp, players->name(entry.player));
+        }
+    }
+    return writer.finish();
+}
+
+// 文件里的记录已经按排名排好，同分的连续出现，直接从尾部追加
+bool RankBoard::load(const std::string& path, uint64_t* sequence, std::string* error) {
+    DumpReader reader;
+    if (!reader.open(path, error)) {
+        return false;
+    }
+    version++;
+    skipList.clear();
+    skipList.beginAppend();
+    DumpReader::Record record;
+    while (reader.next(record)) {
+        skipList.append(record.score, players->intern(record.playerId), record.timestamp);
+    }
+    if (sequence) {
+        *sequence = reader.getHeader().sequence;
+    }
+    return true;
+}
+
+void RankBoard::fillRankInfo(RankInfo& info, const SkipListNode* node, const PlayerEntry& entry) const {
+    info.playerId = players->name(entry.player);
+    info.score = node->score;
+    info.timestamp = entry.timestamp;
+}
+
+PlayerHandle RankBoard::getHandle(const std::string& playerId) {
+    return players->intern(playerId);
 }
 
 // 更新玩家积分，如果不存在则添加新玩家，加入时间戳参数并处理相同分数排序逻辑
 void RankBoard::updateScore(const std::string& playerId, int64_t newScore,time_t timestamp) {
-    SkipListNode* node =  skipList.find(playerId);
-    if (node==nullptr) {
-        // 不存在则添加新玩家，赋予当前时间戳
-        skipList.insert(newScore,playerId,timestamp);
-    } else {
-        // 存在则删除,再创建新的node
-        skipList.remove(playerId);
-        skipList.insert(newScore,playerId,timestamp);
+    updateScore(players->intern(playerId), newScore, timestamp);
+}
+
+void RankBoard::updateScore(PlayerHandle player, int64_t newScore, time_t timestamp) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::UpdateScore);)
+    // 存在则删除老数据（索引定位）,再插入
+    version++;
+    skipList.update(player, newScore, timestamp);
+}
+
+void RankBoard::updateScores(const ScoreUpdate* updates, size_t count) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::UpdateScores);)
+    // 转成句柄，记下输入顺序
+    struct Pending {
+        PlayerHandle player;
+        time_t timestamp;
+        size_t order;
+        int64_t score;
+    };
+    std::vector<Pending> pending;
+    pending.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        pending.push_back(Pending{players->intern(updates[i].playerId), updates[i].timestamp, i, updates[i].score});
+    }
+    // 每个玩家只保留输入顺序上的最后一条，和逐条调用updateScore的结果一致
+    std::sort(pending.begin(), pending.end(), [](const Pending& a, const Pending& b) {
+        if (a.player != b.player) {
+            return a.player < b.player;
+        }
+        return a.order < b.order;
+    });
+    version++;
+    std::vector<PlayerHandle> oldPlayers;
+    std::vector<Pending> last;
+    last.reserve(pending.size());
+    for (size_t i = 0; i < pending.size(); i++) {
+        if (i + 1 < pending.size() && pending[i+1].player == pending[i].player) {
+            continue;
+        }
+        if (skipList.find(pending[i].player)) {
+            oldPlayers.push_back(pending[i].player);
+        }
+        last.push_back(pending[i]);
+    }
+    // 老数据按所在节点的分数从高到低一趟删掉
+    std::sort(oldPlayers.begin(), oldPlayers.end(), [this](PlayerHandle a, PlayerHandle b) {
+        return skipList.find(a)->score > skipList.find(b)->score;
+    });
+    skipList.removeSorted(oldPlayers);
+    // 新分数从高到低一趟插入，同分玩家在节点里的顺序由TieList决定
+    std::sort(last.begin(), last.end(), [](const Pending& a, const Pending& b) {
+        return a.score > b.score;
+    });
+    std::vector<SkipListEntry> entries;
+    entries.reserve(last.size());
+    for (const Pending& p : last) {
+        entries.push_back(SkipListEntry{p.score, p.timestamp, p.player});
     }
+    skipList.insertSorted(entries);
 }
 
 // 查询玩家当前排名
 int RankBoard::getRank(const std::string& playerId) {
-    return  skipList.getRank(playerId) + 1;
+    PlayerHandle player = players->lookup(playerId);
+    if (player == PlayerTable::INVALID) {
+        return 0;
+    }
+    return getRank(player);
+}
+
+// 分数更高的玩家数加1
+int RankBoard::getRank(PlayerHandle player) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetRank);)
+    int nodesBefore, playersBefore;
+    if (!skipList.getRank(player, nodesBefore, playersBefore)) {
+        return 0;
+    }
+    return playersBefore + 1;
+}
+
+int RankBoard::countInScoreRange(int64_t lo, int64_t hi) {
+    if (lo > hi) {
+        return 0;
+    }
+    // 不低于lo的玩家数减去高于hi的玩家数
+    int atLeast = lo == INT64_MIN ? skipList.playerCount() : skipList.countAbove(lo - 1);
+    return atLeast - skipList.countAbove(hi);
+}
+
+int RankBoard::rankOfScore(int64_t score) {
+    return skipList.countAbove(score) + 1;
+}
+
+double RankBoard::percentileOf(const std::string& playerId) {
+    PlayerHandle player = players->lookup(playerId);
+    SkipListNode* node = player == PlayerTable::INVALID ? nullptr : skipList.find(player);
+    if (!node) {
+        return -1;
+    }
+    return 100.0 * (skipList.countAbove(node->score) + 1) / skipList.playerCount();
+}
+
+bool RankBoard::scoreAtPercentile(double p, int64_t& score) {
+    if (!(p > 0 && p <= 100)) {
+        return false;
+    }
+    int count = skipList.playerCount();
+    int position = std::min(count, std::max(1, static_cast<int>(std::ceil(p * count / 100)))) - 1;
+    int offset;
+    SkipListNode* node = skipList.getNodeByPosition(position, offset);
+    if (!node) {
+        return false;
+    }
+    score = node->score;
+    return true;
+}
+
+int RankBoard::getDenseRank(const std::string& playerId) {
+    PlayerHandle player = players->lookup(playerId);
+    if (player == PlayerTable::INVALID) {
+        return 0;
+    }
+    return getDenseRank(player);
+}
+
+// 更高的分数个数加1
+int RankBoard::getDenseRank(PlayerHandle player) {
+    int nodesBefore, playersBefore;
+    if (!skipList.getRank(player, nodesBefore, playersBefore)) {
+        return 0;
+    }
+    return nodesBefore + 1;
 }
 
 // 获取前N名玩家的分数和名次
 std::vector<RankInfo> RankBoard::getTopNPlayers(int n) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetTopN);)
     std::vector<RankInfo> topNPlayers;
-    topNPlayers.reserve(n);
     if(n < 1){
         return topNPlayers;
     }
-    SkipListNode* cur =  skipList.getHeadNode();
-    while ( cur->next[0] && n > 0){
-        for (size_t i = 0; i < cur->next[0]->playerRankInfo.size(); i++)
-        {
-            RankInfo& tmp =  topNPlayers.emplace_back();
-            tmp.playerId = cur->next[0]->playerRankInfo[i].playerId;
-            tmp.score = cur->next[0]->playerRankInfo[i].score;
-            tmp.timestamp = cur->next[0]->playerRankInfo[i].timestamp;
+    n = std::min(n, skipList.playerCount());
+    topNPlayers.reserve(n);
+    // 同分的玩家按顺序排开，取够n个为止，最后一个节点可能只取一部分
+    for (SkipListNode* cur = skipList.getHeadNode()->level[0].forward; cur && n > 0; cur = cur->level[0].forward) {
+        for (auto it = cur->playerRankInfo.begin(); it != cur->playerRankInfo.end() && n > 0; ++it, n--) {
+            fillRankInfo(topNPlayers.emplace_back(), cur, *it);
         }
-        cur = cur->next[0];
-        n--;
     }
     return topNPlayers;
 }
@@ -176,113 +949,115 @@ std::vector<RankInfo> RankBoard::getTopNPlayers(int n) {
 // 查询自己名次前后共N名玩家的分数和名次
 // 这里需要区别共N名玩家是否包含自己,这里的做法是包含自己. 如果n是偶数,前后不对称,这里的做法是向前多取一位
 std::vector<RankInfo> RankBoard::getNearbyPlayers(const std::string& playerId, int n) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetNearby);)
     std::vector<RankInfo> nearbyPlayers;
     nearbyPlayers.reserve(n);
     if(n < 1){
         return nearbyPlayers;
     }
-    // 要找的n名玩家的起始node指针
-    SkipListNode* left_node = skipList.getHeadNode();
-    SkipListNode* cur = left_node;
-    int diff = 0;
-    while (cur->next[0] && skipList.checkThisNode(cur->next[0],playerId)){
-        cur = cur->next[0];
-        if(diff == n/2 ){
-            left_node = left_node->next[0];
-        }else{
-            diff++;
-        }
-    }
-
-    if (!cur->next[0]){
+    PlayerHandle player = players->lookup(playerId);
+    int position = player == PlayerTable::INVALID ? -1 : skipList.getPosition(player);
+    if (position < 0){
         // 没找到该玩家
         return nearbyPlayers;
     }
+    // 要找的n名玩家中的第一个，排在自己前面n/2个玩家，按玩家数直接定位到节点和节点里的位置
+    int offset = 0;
+    SkipListNode* left_node = skipList.getNodeByPosition(std::max(0, position - n/2), offset);
     // 填充n个玩家
-    while (n > 0 && left_node->next[0])
+    for (auto it = left_node->playerRankInfo.at(offset); n > 0 && left_node; n--)
     {
-        for (size_t i = 0; i < left_node->next[0]->playerRankInfo.size(); i++)
-        {
-            RankInfo& tmp =  nearbyPlayers.emplace_back();
-            tmp.playerId = left_node->next[0]->playerRankInfo[i].playerId;
-            tmp.score = left_node->next[0]->playerRankInfo[i].score;
-            tmp.timestamp = left_node->next[0]->playerRankInfo[i].timestamp;
+        fillRankInfo(nearbyPlayers.emplace_back(), left_node, *it);
+        if (++it == left_node->playerRankInfo.end()) {
+            left_node = left_node->level[0].forward;
+            if (left_node) {
+                it = left_node->playerRankInfo.begin();
+            }
         }
-        left_node = left_node->next[0];
-        n--;
     }
     return nearbyPlayers;
 }
 
 
-int main() {
-    //插入积分
-    RankBoard rankBoard;
-
-    rankBoard.updateScore("Player1", 100,100001);
-    rankBoard.updateScore("Player2", 100,100002);
-    rankBoard.updateScore("Player3", 95,100003);
-    rankBoard.updateScore("Player4", 95,100004);
-    rankBoard.updateScore("Player5", 90,100005);
- 
-    // 按顺序打印排名
-    rankBoard.print();
-
-    // 查询排名测试
-    std::cout << "Player1 rank: " << rankBoard.getRank("Player1") << std::endl;
-    std::cout << "Player2 rank: " << rankBoard.getRank("Player2") << std::endl;
-    std::cout << "Player3 rank: " << rankBoard.getRank("Player3") << std::endl;
-    std::cout << "Player4 rank: " << rankBoard.getRank("Player4") << std::endl;
-    std::cout << "Player5 rank: " << rankBoard.getRank("Player5") << std::endl;
-
-    {
-        // 获取前N名玩家测试 top5
-        std::vector<RankInfo> topPlayers = rankBoard.getTopNPlayers(5);
-        std::cout << "Top 5 players: " << std::endl;
-        for (const auto& player : topPlayers) {
-            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+void RankBoard::collect(SkipListNode* node, int offset, int position, int count, int64_t minScore,
+                        std::vector<RankInfo>& out, RankCursor* cursor) {
+    SkipListNode* lastNode = nullptr;
+    const PlayerEntry* last = nullptr;
+    while (node && count > 0 && node->score >= minScore) {
+        for (auto it = node->playerRankInfo.at(offset); it != node->playerRankInfo.end() && count > 0; ++it, count--) {
+            fillRankInfo(out.emplace_back(), node, *it);
+            lastNode = node;
+            last = &*it;
+            offset++;
         }
+        if (offset < node->playerRankInfo.size()) {
+            break;
+        }
+        node = node->level[0].forward;
+        offset = 0;
+    }
+    if (!cursor) {
+        return;
+    }
+    cursor->board = this;
+    cursor->minScore = minScore;
+    cursor->finished = !node || node->score < minScore;
+    cursor->node = node;
+    cursor->offset = offset;
+    cursor->version = version;
+    if (last) {
+        cursor->score = lastNode->score;
+        cursor->timestamp = last->timestamp;
+        cursor->playerId = players->name(last->player);
+        cursor->position = position + static_cast<int>(out.size());
     }
+}
 
-    { 
-        // 获取前N名玩家测试 top20
-        std::vector<RankInfo> topPlayers = rankBoard.getTopNPlayers(20);
-        std::cout << "Top 20 players: " << std::endl;
-        for (const auto& player : topPlayers) {
-            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
-        }
+std::vector<RankInfo> RankBoard::getRange(int startRank, int count, RankCursor* cursor) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetRange);)
+    std::vector<RankInfo> range;
+    if (startRank < 1 || count < 1) {
+        return range;
     }
-    {
-        // 获取自己名次前后N名玩家测试 
-        std::cout << "Nearby players of Player5:  Nearby :5" << std::endl;
-        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 5);
-        for (const auto& player : nearbyPlayers) {
-            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
-        }
+    range.reserve(std::min(count, skipList.playerCount()));
+    int offset = 0;
+    SkipListNode* node = skipList.getNodeByPosition(startRank - 1, offset);
+    collect(node, offset, startRank - 1, count, INT64_MIN, range, cursor);
+    return range;
+}
+
+std::vector<RankInfo> RankBoard::getRangeByScore(int64_t maxScore, int64_t minScore, int limit, RankCursor* cursor) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetRange);)
+    std::vector<RankInfo> range;
+    if (limit < 1 || maxScore < minScore) {
+        return range;
     }
-    {
-        // 获取自己名次前后N名玩家测试 
-        std::cout << "Nearby players of Player5: Nearby :4" << std::endl;
-        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 4);
-        for (const auto& player : nearbyPlayers) {
-            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
-        }
+    int before;
+    SkipListNode* node = skipList.firstAtMost(maxScore, before);
+    collect(node, 0, before, limit, minScore, range, cursor);
+    return range;
+}
+
+std::vector<RankInfo> RankBoard::nextPage(RankCursor& cursor, int count) {
+    RANKBOARD_STATS_ONLY(StatsTimer timer(skipList.boardStats(), BoardOp::GetRange);)
+    std::vector<RankInfo> page;
+    if (cursor.finished || cursor.board != this || count < 1) {
+        return page;
     }
-    {
-        // 获取自己名次前后N名玩家测试 
-        std::cout << "Nearby players of Player5: Nearby :2 " << std::endl;
-        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 2);
-        for (const auto& player : nearbyPlayers) {
-            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
-        }
+    page.reserve(count);
+    if (cursor.version == version) {
+        // 上一页之后没有修改，节点和节点里的位置都没变
+        collect(cursor.node, cursor.offset, cursor.position, count, cursor.minScore, page, &cursor);
+        return page;
     }
-    {
-        // 获取自己名次前后N名玩家测试 
-        std::cout << "Nearby players of Player5: Nearby :200" << std::endl;
-        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 200);
-        for (const auto& player : nearbyPlayers) {
-            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
-        }
+    // 找到上一页最后一个玩家的分数所在的节点，在同分玩家里定位到它后面
+    int before;
+    SkipListNode* node = skipList.firstAtMost(cursor.score, before);
+    int offset = 0;
+    PlayerHandle player = players->lookup(cursor.playerId);
+    if (node && node->score == cursor.score && player != PlayerTable::INVALID) {
+        offset = node->playerRankInfo.upperBound(PlayerEntry{player, cursor.timestamp}, *players);
     }
-    return 0;
+    collect(node, offset, before + offset, count, cursor.minScore, page, &cursor);
+    return page;
 }
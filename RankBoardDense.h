@@ -1,9 +1,13 @@
 /* 
     密集版本相较于原始版本，每个节点记录多个同分的RankInfo
     删除时检查是不是本节点唯一一个数据，如果是唯一数据删除节点，否则删除RankInfo
+    每一层的前进指针除了跨过的节点数(span)，还记录跨过的玩家数(players)，
+    竞争排名("1224"，同分同名次，下一名跳过)按玩家数累加，密集排名("1223")按节点数累加，都是O(logn)。
+    节点内的同分玩家按时间戳、playerId存在计数B+树(TieList)里，同分玩家的插入、删除和求名次都是O(logn)。
 */
 
 #include <iostream>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
 #include <string>
@@ -11,6 +15,12 @@
 #include <algorithm>
 #include <chrono>
 #include <random>
+#include <unordered_map>
+
+#include "BoardStats.h"
+#include "PlayerTable.h"
+#include "RankDump.h"
+#include "SlabAllocator.h"
 
 
  // 跳表最大层数
@@ -23,19 +33,141 @@ struct RankInfo {
     time_t timestamp;
 };
 
-// 跳表节点结构体
+// 排行榜占用的内存
+struct MemoryStats {
+    size_t players;        // 玩家数
+    size_t reservedBytes;  // 节点内存池向系统申请的内存
+    size_t usedBytes;      // 其中节点和同分玩家数组实际占用的部分
+    size_t indexBytes;     // 句柄到节点索引的占用
+    size_t playerTableBytes;  // 玩家id表的占用
+};
+
+// 节点里记录的一个同分玩家，分数就是节点的分数
+struct PlayerEntry {
+    PlayerHandle player;
+    time_t timestamp;
+};
+
+// 同分玩家数组，内存也从排行榜的内存池分配
+using PlayerEntryList = std::vector<PlayerEntry, SlabStlAllocator<PlayerEntry>>;
+
+// 一个节点里的同分玩家，按时间戳从小到大、再按playerId排好，分块存放：每块是有序数组，块满了对半拆开。
+// 块是一棵计数B+树的叶子，内部节点记录每个子树的玩家数和最后一个玩家：定位、求位置、按位置取都从根往下走，
+// 插入删除只移动一个块和路径上的几个内部节点，10万人同分时每次也只有O(log)。只有一个块时没有内部节点
+class TieList {
+    struct Block;
+public:
+    // 按排名顺序遍历，块之间用链表串起来
+    class Iterator {
+    public:
+        Iterator(const Block* block, size_t offset) : block(block), offset(offset) {}
+        const PlayerEntry& operator*() const { return block->entries[offset]; }
+        const PlayerEntry* operator->() const { return &block->entries[offset]; }
+        Iterator& operator++() {
+            if (++offset == block->entries.size()) {
+                block = block->next;
+                offset = 0;
+            }
+            return *this;
+        }
+        bool operator==(const Iterator& other) const { return block == other.block && offset == other.offset; }
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+    private:
+        const Block* block;
+        size_t offset;
+    };
+
+    explicit TieList(SlabAllocator* pool) : pool(pool) {}
+    ~TieList();
+    TieList(const TieList&) = delete;
+    TieList& operator=(const TieList&) = delete;
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    // 按顺序插入玩家
+    void insert(const PlayerEntry& entry, const PlayerTable& players);
+    // 删除玩家，entry的时间戳必须和插入时一致
+    void erase(const PlayerEntry& entry, const PlayerTable& players);
+    // 玩家在节点里的位置，从0开始
+    int indexOf(const PlayerEntry& entry, const PlayerTable& players) const;
+    // 不排在entry之后的玩家个数，entry不需要在节点里
+    int upperBound(const PlayerEntry& entry, const PlayerTable& players) const;
+    // 从第index个玩家开始遍历
+    Iterator at(int index) const;
+    Iterator begin() const;
+    Iterator end() const { return Iterator(nullptr, 0); }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 128;  // 块满了拆成两半
+    static constexpr int FANOUT = 32;          // 内部节点满了拆成两半
+    struct Block {
+        PlayerEntryList entries;
+        Block* prev;
+        Block* next;
+    };
+    struct Inner {
+        int count;
+        int size[FANOUT];          // 每个子树的玩家数
+        PlayerEntry last[FANOUT];  // 每个子树的最后一个玩家
+        void* child[FANOUT];       // 深度为1时是Block，否则是Inner
+    };
+    SlabAllocator* pool;
+    void* root = nullptr;  // depth为0时是Block
+    int depth = 0;
+    int count = 0;
+    // 节点内的排序：时间戳小的在前，再按playerId
+    static bool before(const PlayerEntry& a, const PlayerEntry& b, const PlayerTable& players);
+    // 第一个最后一个玩家不排在entry之前的子树，都排在前面时返回最后一个
+    static int findChild(const Inner* inner, const PlayerEntry& entry, const PlayerTable& players);
+    Block* newBlock();
+    void freeBlock(Block* block);
+    void freeTree(void* node, int level);
+    static int sizeOf(const void* node, int level);
+    static const PlayerEntry& lastOf(const void* node, int level);
+    // 插入到子树里，子树拆开时返回新的右半边
+    void* insertInto(void* node, int level, const PlayerEntry& entry, const PlayerTable& players);
+    // 从子树里删除，没找到返回false
+    bool eraseFrom(void* node, int level, const PlayerEntry& entry, const PlayerTable& players);
+    // 把新拆出的sibling放在inner的第i个子树后面，inner满了时拆开并返回右半边
+    void* addChild(Inner* inner, int i, void* sibling, int level);
+    void removeChild(Inner* inner, int i);
+};
+
+// 批量更新中的一条
+struct ScoreUpdate {
+    std::string playerId;
+    int64_t score;
+    time_t timestamp;
+};
+
+// 批量插入时的一条数据
+struct SkipListEntry {
+    int64_t score;
+    time_t timestamp;
+    PlayerHandle player;
+};
+
+struct SkipListNode;
+
+// 跳表某一层的前进指针，span为这一步跨过的节点数，用来计算密集排名；players为跨过的玩家数，用来计算竞争排名
+struct SkipListLevel {
+    SkipListNode* forward;
+    int span;
+    int players;
+};
+
+// 跳表节点结构体，按层数分配，level数组只有height个
 struct SkipListNode {
     int64_t score;
-    std::vector<RankInfo> playerRankInfo;
-    SkipListNode* next[MAX_LVL]; // 跳表最大层数
-    SkipListNode(int64_t s, const std::string& pid, time_t t) {
-        for (int i = 0; i < MAX_LVL; i++) {
-            next[i] = nullptr;
+    TieList playerRankInfo;  // 同分玩家
+    int height;        // 节点层数
+    SkipListLevel level[];
+    SkipListNode(int64_t s, int h, SlabAllocator* pool)
+        : playerRankInfo(pool), height(h) {
+        for (int i = 0; i < h; i++) {
+            level[i].forward = nullptr;
+            level[i].span = 0;
+            level[i].players = 0;
         }
-       auto& tmp =  playerRankInfo.emplace_back();
-       tmp.playerId = pid;
-       tmp.score = s;
-       tmp.timestamp = t;
        score =s;
     }
 };
@@ -43,40 +175,189 @@ struct SkipListNode {
 // 跳表类
 class SkipList {
 public:
-    //查找这个玩家是否在这个节点中
-    bool checkThisNode(SkipListNode* node,std::string playerId);
-    SkipList() {
-        head = new SkipListNode(0, "", 0);  // 初始化时间戳为 0
+    // players为玩家id表，同分玩家按playerId排序时用；seed为层数随机数种子，每个跳表独立
+    explicit SkipList(const PlayerTable* players, uint64_t seed = std::random_device{}())
+        : playerTable(players), rngState(seed) {
+        head = createNode(MAX_LVL, 0);
+    }
+    ~SkipList();
+    SkipList(const SkipList&) = delete;
+    SkipList& operator=(const SkipList&) = delete;
+    // 查找玩家所在的节点（根据玩家句柄查找）,通过索引O(1)定位
+    SkipListNode* find(PlayerHandle player);
+    // 排在玩家所在节点前面的节点数和玩家数，不存在返回false
+    bool getRank(PlayerHandle player, int& nodesBefore, int& playersBefore);
+    // 玩家在排行榜里的位置(同分按时间戳排开) 从0开始，不存在返回-1
+    int getPosition(PlayerHandle player);
+    // 按排名获取节点 从1开始，超出范围返回nullptr
+    SkipListNode* getNodeByRank(int rank);
+    // 第position个玩家(从0开始)所在的节点，offset为它在节点里的位置，超出范围返回nullptr
+    SkipListNode* getNodeByPosition(int position, int& offset);
+    // 第一个分数不高于score的节点，playersBefore为排在它前面的玩家数，没有返回nullptr
+    SkipListNode* firstAtMost(int64_t score, int& playersBefore);
+    // 分数比score高的玩家数
+    int countAbove(int64_t score) {
+        int playersBefore;
+        firstAtMost(score, playersBefore);
+        return playersBefore;
     }
-    // 查找节点（根据 playerid 查找）,这里只知道playerid不知道分数，只能线性查找
-    SkipListNode* find(const std::string& playerid);
-    // 获得玩家排名 从1开始
-    int getRank(const std::string& playerid);
     // 插入节点
-    void insert(int64_t score, const std::string& playerid, time_t timestamp) ;
+    void insert(int64_t score, PlayerHandle player, time_t timestamp) ;
     // 删除节点
-    void remove(const std::string& playerid);
+    void remove(PlayerHandle player);
+    // 更新玩家的分数和时间戳，不存在则插入；删除和插入共用一个查找手指，分数不变时只调整节点内的顺序
+    void update(PlayerHandle player, int64_t score, time_t timestamp);
+    // 批量插入，entries必须已按分数从高到低排好且玩家都不在跳表中，每次从上一个位置继续查找
+    void insertSorted(const std::vector<SkipListEntry>& entries);
+    // 批量删除，handles必须已按所在节点的分数从高到低排好
+    void removeSorted(const std::vector<PlayerHandle>& handles);
+    // 从空跳表开始按分数从高到低在尾部追加，和最后一个节点同分时并入该节点，用于从转储文件加载
+    void beginAppend();
+    void append(int64_t score, PlayerHandle player, time_t timestamp);
     // 打印最底层跳表，包含所有插入的元素
-    void print() ;
+    void print(const PlayerTable& players) ;
     SkipListNode* getHeadNode();
+    // 节点总数（不同分数的个数）
+    int size() const { return length; }
+    // 玩家总数
+    int playerCount() const { return players; }
+    // 清空所有节点，内存池整体释放
+    void clear();
+    // 内存占用统计
+    MemoryStats memoryStats() const;
+    RANKBOARD_STATS_ONLY(BoardStats& boardStats() const { return counters; })
 
 private:
+    SlabAllocator pool;  // 节点和同分玩家数组的内存池
+    const PlayerTable* playerTable;
     SkipListNode* head;  // 头节点
+    int length = 0;      // 节点总数
+    int players = 0;     // 玩家总数
+    int level = 1;       // 当前最高层数，查找从这一层开始
+    uint64_t rngState;   // 层数随机数状态
+    RANKBOARD_STATS_ONLY(mutable BoardStats counters{false};)
+    // 玩家句柄到所在节点和时间戳的索引，句柄是连续分配的，直接用数组，insert和remove时同步维护
+    // 时间戳用来在节点的同分玩家里二分定位
+    struct PlayerSlot {
+        SkipListNode* node;
+        time_t timestamp;
+    };
+    std::vector<PlayerSlot> index;
+    // 从内存池按层数分配空节点，只分配height个前进指针
+    SkipListNode* createNode(int height, int64_t score);
+    void freeNode(SkipListNode* node);
+    // 析构所有节点（包括头节点），同分玩家多的节点数组是单独分配的，需要析构释放
+    void destroyNodes();
+    // splitmix64，比每次构造mt19937快得多
+    uint64_t nextRandom();
     // 生成随机层数
     int randomLevel();
+    // 查找手指：每一层排在当前分数之前的最后一个节点，以及到它为止的节点数和玩家数
+    struct Finger {
+        SkipListNode* update[MAX_LVL];
+        int rank[MAX_LVL];
+        int players[MAX_LVL];
+    };
+    Finger tail;  // append用
+    void resetFinger(Finger& finger);
+    // 把手指移动到分数比score高的最后一个节点，分数不能比上一次高
+    void seek(Finger& finger, int64_t score);
+    // 在手指位置插入玩家，手指后面是同分节点时并入，否则新建节点；手指不动
+    void insertAt(Finger& finger, int64_t score, PlayerHandle player, time_t timestamp);
+    // 从节点中删除玩家，节点空了就摘掉；不修改索引
+    void removeAt(Finger& finger, SkipListNode* node, const PlayerEntry& entry);
+};
+
+class RankBoard;
+
+// 翻页游标：记住下一页从哪个节点的第几个玩家开始，以及上一页最后一个玩家。
+// 这期间排行榜没有修改时直接从记下的位置接着取；有修改时按上一页最后一个玩家的排序键重新定位，O(logn)
+class RankCursor {
+public:
+    // 下一页第一个玩家的排名，同分的按时间戳排开，从1开始
+    int nextRank() const { return position + 1; }
+    // 已经取到排行榜或分数范围的末尾
+    bool done() const { return finished; }
+private:
+    friend class RankBoard;
+    const RankBoard* board = nullptr;
+    SkipListNode* node = nullptr;  // 下一页开始的节点和节点里的位置，只在版本号没变时使用
+    int offset = 0;
+    uint64_t version = 0;
+    int64_t score = 0;             // 上一页最后一个玩家的排序键
+    time_t timestamp = 0;
+    std::string playerId;
+    int64_t minScore = INT64_MIN;  // 按分数翻页时分数的下界
+    int position = 0;
+    bool finished = true;
 };
 
 class RankBoard {
+    std::shared_ptr<PlayerTable> players;
     SkipList skipList;
+    uint64_t version = 0;  // 每次修改加1，游标用来判断能不能直接接着取
+    // 把节点里的一个玩家填成RankInfo
+    void fillRankInfo(RankInfo& info, const SkipListNode* node, const PlayerEntry& entry) const;
+    // 从node的第offset个玩家(整体第position个，从0开始)往后取最多count个分数不低于minScore的玩家，记下翻页位置
+    void collect(SkipListNode* node, int offset, int position, int count, int64_t minScore,
+                 std::vector<RankInfo>& out, RankCursor* cursor);
 public:
+    RankBoard() : RankBoard(std::random_device{}()) {}
+    // 指定跳表层数的随机数种子，便于复现
+    explicit RankBoard(uint64_t seed) : players(std::make_shared<PlayerTable>()), skipList(players.get(), seed) {}
     void print();
     // 更新玩家积分，如果不存在则添加新玩家，加入时间戳参数并处理相同分数排序逻辑
     void updateScore(const std::string& playerId, int64_t newScore,time_t timestamp);
-    // 查询玩家当前排名
+    // 同上，playerid已经换成句柄
+    void updateScore(PlayerHandle player, int64_t newScore, time_t timestamp);
+    // 批量更新：同一玩家有多条时保留输入顺序上的最后一条，不比较时间戳，和逐条调用updateScore的结果一致；
+    // 按分数排好后一趟删除、一趟插入
+    void updateScores(const ScoreUpdate* updates, size_t count);
+    void updateScores(const std::vector<ScoreUpdate>& updates) { updateScores(updates.data(), updates.size()); }
+    // 查询玩家当前排名，同分同名次，下一名跳过("1224")，不存在返回0
     int getRank(const std::string& playerId);
-    // 获取前N名玩家的分数和名次
+    int getRank(PlayerHandle player);
+    // 密集排名，同分同名次，下一名不跳过("1223")，不存在返回0
+    int getDenseRank(const std::string& playerId);
+    int getDenseRank(PlayerHandle player);
+    // 玩家id对应的句柄，不存在则分配一个，频繁调用的地方可以先换成句柄
+    PlayerHandle getHandle(const std::string& playerId);
+    // 玩家id表
+    const PlayerTable& playerTable() const { return *players; }
+    // 获取前N名玩家的分数和名次，按玩家计数，同分的按时间戳排开
     std::vector<RankInfo> getTopNPlayers(int n) ;
-    // 查询自己名次前后共N名玩家的分数和名次
+    // 查询自己名次前后共N名玩家的分数和名次，同分的按时间戳排开后按玩家计数
     // 这里需要区别共N名玩家是否包含自己,这里的做法是包含自己. 如果n是偶数,前后不对称,这里的做法是向前多取一位
     std::vector<RankInfo> getNearbyPlayers(const std::string& playerId, int n);
+    // 分数在[lo, hi]之间的玩家数，O(logn)
+    int countInScoreRange(int64_t lo, int64_t hi);
+    // 分数为score的玩家能排到第几名，和getRank一样同分同名次，O(logn)
+    int rankOfScore(int64_t score);
+    // 玩家排在前百分之多少，按分数算(同分的玩家相同)：100人里的第1名是1，最后一名是100；不在榜上返回-1
+    double percentileOf(const std::string& playerId);
+    // 排在前p%位置的玩家的分数，p在(0, 100]之间，100取最后一名；榜上没人或p超出范围返回false
+    bool scoreAtPercentile(double p, int64_t& score);
+    // 排名从startRank(从1开始，同分的按时间戳排开)起的count个玩家，按玩家数直接定位再往后取，O(logn+count)；
+    // cursor不为空时记下翻页位置
+    std::vector<RankInfo> getRange(int startRank, int count, RankCursor* cursor = nullptr);
+    // 分数在[minScore, maxScore]之间的玩家，从高到低最多limit个，O(logn+limit)
+    std::vector<RankInfo> getRangeByScore(int64_t maxScore, int64_t minScore, int limit, RankCursor* cursor = nullptr);
+    // 从游标接着取下一页最多count个玩家，游标来自getRange或getRangeByScore
+    std::vector<RankInfo> nextPage(RankCursor& cursor, int count);
+    // 获得跳表头节点，用于顺序遍历
+    SkipListNode* getHeadNode();
+    // 不同分数的节点个数
+    int getNodeCount();
+    // 玩家总数
+    int getPlayerCount();
+    // 清空排行榜，比如赛季结束
+    void clear();
+    // 排行榜占用的内存
+    MemoryStats memoryStats() const;
+    // 各操作的耗时分布、每次查找访问的节点数、各层节点数和同分玩家数分布，编译时没有定义RANKBOARD_STATS时enabled为false
+    BoardStatsReport stats() const;
+    // 按排名顺序转储到文件，sequence为已经应用到的日志序号；先写临时文件，落盘后再替换path，失败时原文件不变
+    bool dump(const std::string& path, uint64_t sequence = 0);
+    // 从转储文件加载，替换当前内容，O(n)；文件损坏时返回false，排行榜不变
+    bool load(const std::string& path, uint64_t* sequence = nullptr, std::string* error = nullptr);
 };
@@ -0,0 +1,336 @@
+#include "BenchSuite.h"
+#include "RankBoardDense.h"
+
+#include <cmath>
+#include <cstdio>
+
+// 压测：先灌入playerCount个玩家，再随机更新已有玩家的积分，查询排名和前后名次
+// 同时抽样模拟原来按playerid线性查找的开销作对比
+static int runBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::mt19937_64 gen(12345);
+    // 分数范围比玩家数小，保证有大量同分
+    std::uniform_int_distribution<int64_t> scoreDis(0, playerCount / 4);
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+
+    RankBoard rankBoard(12345);
+    time_t timestamp = 100000;
+    auto begin = Clock::now();
+    for (int i = 0; i < playerCount; i++) {
+        rankBoard.updateScore(ids[i], scoreDis(gen), timestamp++);
+    }
+    double insertNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    std::cout << "insert " << playerCount << " players: " << insertNs / playerCount << " ns/op" << std::endl;
+
+    // 节点平均层数和内存占用
+    double heightSum = 0;
+    for (SkipListNode* cur = rankBoard.getHeadNode()->level[0].forward; cur; cur = cur->level[0].forward) {
+        heightSum += cur->height;
+    }
+    int nodeCount = rankBoard.getNodeCount();
+    MemoryStats stats = rankBoard.memoryStats();
+    std::cout << "score nodes: " << nodeCount << ", avg node height: " << heightSum / nodeCount
+              << ", bytes per player: " << double(stats.usedBytes) / playerCount
+              << ", reserved MB: " << stats.reservedBytes / (1 << 20) << ", index MB: " << stats.indexBytes / (1 << 20)
+              << ", player table MB: " << stats.playerTableBytes / (1 << 20) << std::endl;
+
+    const int updateCount = 200000;
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    begin = Clock::now();
+    for (int i = 0; i < updateCount; i++) {
+        rankBoard.updateScore(ids[playerDis(gen)], scoreDis(gen), timestamp++);
+    }
+    double updateNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    std::cout << "updateScore (indexed): " << updateNs / updateCount << " ns/op" << std::endl;
+
+    // 同一批玩家先逐条更新一遍，再换新分数批量更新一遍
+    for (int batchSize : {1000, 10000, 100000}) {
+        std::vector<ScoreUpdate> batch;
+        batch.reserve(batchSize);
+        for (int i = 0; i < batchSize; i++) {
+            batch.push_back(ScoreUpdate{ids[playerDis(gen)], scoreDis(gen), timestamp++});
+        }
+        begin = Clock::now();
+        for (const ScoreUpdate& u : batch) {
+            rankBoard.updateScore(u.playerId, u.score, u.timestamp);
+        }
+        double loopNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        for (ScoreUpdate& u : batch) {
+            u.score = scoreDis(gen);
+            u.timestamp = timestamp++;
+        }
+        begin = Clock::now();
+        rankBoard.updateScores(batch);
+        double batchNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        std::cout << "batch " << batchSize << ": updateScore loop " << loopNs / batchSize << " ns/op, updateScores "
+                  << batchNs / batchSize << " ns/op" << std::endl;
+    }
+
+    int64_t rankSum = 0;
+    begin = Clock::now();
+    for (int i = 0; i < updateCount; i++) {
+        rankSum += rankBoard.getRank(ids[playerDis(gen)]);
+    }
+    double rankNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    std::cout << "getRank: " << rankNs / updateCount << " ns/op (checksum " << rankSum << ")" << std::endl;
+
+    size_t nearbySum = 0;
+    begin = Clock::now();
+    for (int i = 0; i < updateCount; i++) {
+        nearbySum += rankBoard.getNearbyPlayers(ids[playerDis(gen)], 10).size();
+    }
+    double nearbyNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    std::cout << "getNearbyPlayers(10): " << nearbyNs / updateCount << " ns/op (checksum " << nearbySum << ")" << std::endl;
+
+    // 原来的updateScore至少要按playerid线性查找两次，这里只测一次查找
+    const int scanCount = 100;
+    SkipListNode* head = rankBoard.getHeadNode();
+    size_t found = 0;
+    begin = Clock::now();
+    for (int i = 0; i < scanCount; i++) {
+        const std::string& target = ids[playerDis(gen)];
+        SkipListNode* cur = head;
+        bool hit = false;
+        while (cur->level[0].forward && !hit) {
+            cur = cur->level[0].forward;
+            for (auto it = cur->playerRankInfo.begin(); it != cur->playerRankInfo.end() && !hit; ++it) {
+                hit = rankBoard.playerTable().name(it->player) == target;
+            }
+        }
+        found += hit;
+    }
+    double scanNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    std::cout << "linear find (old path, found " << found << "/" << scanCount << "): " << scanNs / scanCount << " ns/op" << std::endl;
+
+    begin = Clock::now();
+    rankBoard.clear();
+    double clearMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    std::cout << "clear: " << clearMs << " ms, reserved bytes after clear: " << rankBoard.memoryStats().reservedBytes << std::endl;
+    return 0;
+}
+
+// 热点分数：playerCount个玩家全部同分，反复更新其中的玩家(分数不变、时间戳变化，或者离开再回来)，
+// 以及查询排名和前后名次，节点内的操作都不能是线性的
+static void runTieBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    RankBoard rankBoard(12345);
+    time_t timestamp = 100000;
+    for (int i = 0; i < playerCount; i++) {
+        rankBoard.updateScore(ids[i], 1000, timestamp + gen() % playerCount);
+    }
+    const int opCount = 200000;
+    auto begin = Clock::now();
+    for (int i = 0; i < opCount; i++) {
+        rankBoard.updateScore(ids[playerDis(gen)], 1000, timestamp + gen() % playerCount);
+    }
+    double updateNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    begin = Clock::now();
+    for (int i = 0; i < opCount; i++) {
+        const std::string& id = ids[playerDis(gen)];
+        rankBoard.updateScore(id, 999, timestamp);
+        rankBoard.updateScore(id, 1000, timestamp + gen() % playerCount);
+    }
+    double moveNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    int64_t rankSum = 0;
+    begin = Clock::now();
+    for (int i = 0; i < opCount; i++) {
+        rankSum += rankBoard.getRank(ids[playerDis(gen)]) + rankBoard.getDenseRank(ids[playerDis(gen)]);
+    }
+    double rankNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    size_t nearbySum = 0;
+    begin = Clock::now();
+    for (int i = 0; i < opCount; i++) {
+        nearbySum += rankBoard.getNearbyPlayers(ids[playerDis(gen)], 10).size();
+    }
+    double nearbyNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+    std::cout << playerCount << " tied players: updateScore same score " << updateNs / opCount
+              << " ns/op, leave and rejoin " << moveNs / opCount / 2 << " ns/op, getRank+getDenseRank "
+              << rankNs / opCount << " ns/op, getNearbyPlayers(10) " << nearbyNs / opCount
+              << " ns/op (checksum " << rankSum + nearbySum << ")" << std::endl;
+}
+
+// 翻页：不同深度的getRange和原来getTopNPlayers(offset+limit)丢掉前缀的做法对比，再用游标从头翻到尾
+static void runRangeBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, playerCount / 4);
+    std::vector<ScoreUpdate> all;
+    all.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        all.push_back(ScoreUpdate{"Player" + std::to_string(i), scoreDis(gen), 100000 + i});
+    }
+    RankBoard rankBoard(12345);
+    rankBoard.updateScores(all);
+
+    const int pageSize = 50;
+    for (int offset : {0, 10000, playerCount / 2, playerCount - pageSize}) {
+        if (offset < 0 || offset >= playerCount) {
+            continue;
+        }
+        const int queryCount = 10000;
+        size_t sum = 0;
+        auto begin = Clock::now();
+        for (int i = 0; i < queryCount; i++) {
+            sum += rankBoard.getRange(offset + 1, pageSize).size();
+        }
+        double rangeNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / queryCount;
+        int prefixCount = std::max(1, std::min(queryCount, 20000000 / (offset + pageSize)));
+        begin = Clock::now();
+        for (int i = 0; i < prefixCount; i++) {
+            std::vector<RankInfo> top = rankBoard.getTopNPlayers(offset + pageSize);
+            sum += top.size() - offset;
+        }
+        double prefixNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / prefixCount;
+        std::cout << "page at rank " << offset + 1 << ": getRange " << rangeNs << " ns, getTopNPlayers + drop prefix "
+                  << prefixNs << " ns (checksum " << sum << ")" << std::endl;
+    }
+
+    RankCursor cursor;
+    int64_t seen = rankBoard.getRange(1, pageSize, &cursor).size();
+    int64_t pages = 1;
+    auto begin = Clock::now();
+    while (!cursor.done()) {
+        seen += rankBoard.nextPage(cursor, pageSize).size();
+        pages++;
+    }
+    double pageNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / pages;
+    std::cout << "cursor: " << pages << " pages, " << pageNs << " ns/page, " << seen << " players" << std::endl;
+}
+
+// 重启：逐条重放updateScore和从转储文件加载的耗时对比，加载后和原排行榜逐个比较，再验证损坏的文件会被拒绝
+static void runDumpBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    const std::string path = "RankBoardDense.bench.dump";
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    std::uniform_int_distribution<int64_t> scoreDis(0, playerCount / 4);
+    RankBoard rankBoard(12345);
+    auto begin = Clock::now();
+    for (int i = 0; i < playerCount; i++) {
+        rankBoard.updateScore(ids[i], scoreDis(gen), 100000 + i);
+    }
+    double replayMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+    begin = Clock::now();
+    bool dumped = rankBoard.dump(path, 42);
+    double dumpMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+    RankBoard loaded(54321);
+    uint64_t sequence = 0;
+    std::string error;
+    begin = Clock::now();
+    bool ok = dumped && loaded.load(path, &sequence, &error);
+    double loadMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    std::cout << "restart " << playerCount << " players: replay updateScore " << replayMs << " ms, dump " << dumpMs
+              << " ms, load " << loadMs << " ms" << (ok ? "" : " (load failed: " + error + ")") << std::endl;
+
+    bool match = ok && sequence == 42 && rankBoard.getNodeCount() == loaded.getNodeCount();
+    SkipListNode* a = rankBoard.getHeadNode()->level[0].forward;
+    SkipListNode* b = loaded.getHeadNode()->level[0].forward;
+    for (; match && a && b; a = a->level[0].forward, b = b->level[0].forward) {
+        match = a->score == b->score && a->playerRankInfo.size() == b->playerRankInfo.size();
+        for (auto x = a->playerRankInfo.begin(), y = b->playerRankInfo.begin(); match && x != a->playerRankInfo.end(); ++x, ++y) {
+            match = x->timestamp == y->timestamp &&
+                    rankBoard.playerTable().name(x->player) == loaded.playerTable().name(y->player);
+        }
+    }
+    match = match && !a && !b;
+    for (int i = 0; i < 1000 && match; i++) {
+        const std::string& id = ids[gen() % playerCount];
+        match = rankBoard.getRank(id) == loaded.getRank(id);
+    }
+    std::cout << "loaded board matches: " << (match ? "yes" : "NO") << std::endl;
+
+    // 改掉文件中间的一个字节
+    if (FILE* file = std::fopen(path.c_str(), "r+b")) {
+        std::fseek(file, sizeof(DumpHeader) + 100, SEEK_SET);
+        std::fputc(0x5A, file);
+        std::fclose(file);
+    }
+    RankBoard corrupted(1);
+    bool rejected = !corrupted.load(path, nullptr, &error);
+    std::cout << "corrupted dump rejected: " << (rejected ? "yes (" + error + ")" : "NO") << std::endl;
+    std::remove(path.c_str());
+}
+
+
+// 内置统计：混合更新和查询后打印stats()，编译时打开RANKBOARD_STATS和不打开各跑一次，对比每轮耗时就是统计本身的开销
+static void runStatsBenchmark(int playerCount) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::string> ids;
+    ids.reserve(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        ids.push_back("Player" + std::to_string(i));
+    }
+    std::mt19937_64 gen(12345);
+    // 分数范围比玩家数小，同分组大小才有分布可看
+    std::uniform_int_distribution<int64_t> scoreDis(0, playerCount / 4);
+    std::uniform_int_distribution<int> playerDis(0, playerCount - 1);
+    RankBoard rankBoard(12345);
+    for (int i = 0; i < playerCount; i++) {
+        rankBoard.updateScore(ids[i], scoreDis(gen), 100000 + i);
+    }
+    std::vector<PlayerHandle> handles(playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        handles[i] = rankBoard.getHandle(ids[i]);
+    }
+    // 每轮：2次更新、2次查排名，前10名、前后10名和一页排名各一次
+    const int roundCount = 200000;
+    int64_t sum = 0;
+    auto begin = Clock::now();
+    for (int i = 0; i < roundCount; i++) {
+        rankBoard.updateScore(handles[playerDis(gen)], scoreDis(gen), 200000 + i);
+        rankBoard.updateScore(handles[playerDis(gen)], scoreDis(gen), 200000 + i);
+        sum += rankBoard.getRank(handles[playerDis(gen)]);
+        sum += rankBoard.getRank(handles[playerDis(gen)]);
+        sum += rankBoard.getTopNPlayers(10).size();
+        sum += rankBoard.getNearbyPlayers(ids[playerDis(gen)], 10).size();
+        sum += rankBoard.getRange(1 + playerDis(gen), 10).size();
+    }
+    double roundNs = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / roundCount;
+    std::cout << "mixed round " << roundNs << " ns (checksum " << sum << ")" << std::endl;
+    std::cout << rankBoard.stats().toString();
+}
+
+int main(int argc, char* argv[]) {
+    // ./RankBoardDenseBench suite [最大玩家数] [uniform|zipf|ties]：负载和RankBoardBench suite相同，结果可以直接对比
+    if (argc > 1 && std::string(argv[1]) == "suite") {
+        SuiteOptions options = suiteOptions(argc - 2, argv + 2);
+        runSuite<RankBoard>("RankBoardDense", options, [] { return std::make_unique<RankBoard>(12345); });
+        return 0;
+    }
+    // ./RankBoardDenseBench [玩家数] [core|ties|range|dump|stats]，不指定项目时全部跑一遍
+    int playerCount = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    std::string only = argc > 2 ? argv[2] : "";
+    if (only.empty() || only == "core") {
+        runBenchmark(playerCount);
+    }
+    if (only.empty() || only == "ties") {
+        runTieBenchmark(playerCount);
+    }
+    if (only.empty() || only == "range") {
+        runRangeBenchmark(playerCount);
+    }
+    if (only.empty() || only == "dump") {
+        runDumpBenchmark(playerCount);
+    }
+    if (only.empty() || only == "stats") {
+        runStatsBenchmark(playerCount);
+    }
+    return 0;
+}
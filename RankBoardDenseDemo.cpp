@@ -0,0 +1,76 @@
+#include "RankBoardDense.h"
+
+int main() {
+    //插入积分
+    RankBoard rankBoard;
+
+    rankBoard.updateScore("Player1", 100,100001);
+    rankBoard.updateScore("Player2", 100,100002);
+    rankBoard.updateScore("Player3", 95,100003);
+    rankBoard.updateScore("Player4", 95,100004);
+    rankBoard.updateScore("Player5", 90,100005);
+ 
+    // 按顺序打印排名
+    rankBoard.print();
+
+    // 查询排名测试
+    std::cout << "Player1 rank: " << rankBoard.getRank("Player1") << std::endl;
+    std::cout << "Player2 rank: " << rankBoard.getRank("Player2") << std::endl;
+    std::cout << "Player3 rank: " << rankBoard.getRank("Player3") << std::endl;
+    std::cout << "Player4 rank: " << rankBoard.getRank("Player4") << std::endl;
+    std::cout << "Player5 rank: " << rankBoard.getRank("Player5") << std::endl;
+    // 密集排名测试
+    std::cout << "Player3 dense rank: " << rankBoard.getDenseRank("Player3") << std::endl;
+    std::cout << "Player5 dense rank: " << rankBoard.getDenseRank("Player5") << std::endl;
+
+    {
+        // 获取前N名玩家测试 top5
+        std::vector<RankInfo> topPlayers = rankBoard.getTopNPlayers(5);
+        std::cout << "Top 5 players: " << std::endl;
+        for (const auto& player : topPlayers) {
+            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+        }
+    }
+
+    { 
+        // 获取前N名玩家测试 top20
+        std::vector<RankInfo> topPlayers = rankBoard.getTopNPlayers(20);
+        std::cout << "Top 20 players: " << std::endl;
+        for (const auto& player : topPlayers) {
+            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+        }
+    }
+    {
+        // 获取自己名次前后N名玩家测试 
+        std::cout << "Nearby players of Player5:  Nearby :5" << std::endl;
+        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 5);
+        for (const auto& player : nearbyPlayers) {
+            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+        }
+    }
+    {
+        // 获取自己名次前后N名玩家测试 
+        std::cout << "Nearby players of Player5: Nearby :4" << std::endl;
+        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 4);
+        for (const auto& player : nearbyPlayers) {
+            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+        }
+    }
+    {
+        // 获取自己名次前后N名玩家测试 
+        std::cout << "Nearby players of Player5: Nearby :2 " << std::endl;
+        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 2);
+        for (const auto& player : nearbyPlayers) {
+            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+        }
+    }
+    {
+        // 获取自己名次前后N名玩家测试 
+        std::cout << "Nearby players of Player5: Nearby :200" << std::endl;
+        std::vector<RankInfo> nearbyPlayers = rankBoard.getNearbyPlayers("Player5", 200);
+        for (const auto& player : nearbyPlayers) {
+            std::cout << player.playerId << " - Score: " << player.score << " - Timestamp: " << player.timestamp << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "RankBoardRegistry.h"
+
+namespace {
+
+void putVarint(std::vector<char>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+uint64_t getVarint(const char*& p) {
+    uint64_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        v |= uint64_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return v;
+        }
+    }
+}
+
+uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+}  // namespace
+
+RankBoardRegistry::RankBoardRegistry(size_t memoryBudget, uint64_t seed)
+    : players(std::make_shared<PlayerTable>()), budget(memoryBudget), seed(seed) {}
+
+std::unique_ptr<RankBoard> RankBoardRegistry::newBoard() {
+    return std::make_unique<RankBoard>(players, seed + created++, false, true);
+}
+
+RankBoardRegistry::Entry& RankBoardRegistry::acquire(const std::string& name) {
+    auto it = entries.find(name);
+    if (it == entries.end()) {
+        auto entry = std::make_unique<Entry>();
+        entry->name = name;
+        entry->board = newBoard();
+        lru.push_front(entry.get());
+        entry->lru = lru.begin();
+        it = entries.emplace(name, std::move(entry)).first;
+    }
+    Entry& entry = *it->second;
+    if (!entry.board) {
+        reload(entry);
+    } else {
+        lru.splice(lru.begin(), lru, entry.lru);
+    }
+    entry.users++;
+    return entry;
+}
+
+void RankBoardRegistry::release(Entry& entry) {
+    entry.users--;
+    measure(entry);
+    enforceBudget();
+}
+
+void RankBoardRegistry::measure(Entry& entry) {
+    MemoryStats stats = entry.board->memoryStats();
+    size_t bytes = sizeof(RankBoard) + stats.reservedBytes + stats.indexBytes;
+    residentBytes += bytes - entry.bytes;
+    entry.bytes = bytes;
+}
+
+void RankBoardRegistry::spill(Entry& entry) {
+    // 按排名顺序：句柄、和上一名的分数差(非负)、和上一名的时间戳差
+    std::vector<char> out;
+    int64_t lastScore = 0;
+    int64_t lastTimestamp = 0;
+    bool first = true;
+    size_t count = entry.board->memoryStats().players;
+    out.reserve(count * 8 + 8);
+    putVarint(out, count);
+    for (SkipListNode* cur = entry.board->getHeadNode()->level[0].forward; cur; cur = cur->level[0].forward) {
+        putVarint(out, cur->player);
+        putVarint(out, first ? zigzag(cur->score) : static_cast<uint64_t>(lastScore) - static_cast<uint64_t>(cur->score));
+        putVarint(out, zigzag(static_cast<int64_t>(cur->timestamp) - lastTimestamp));
+        lastScore = cur->score;
+        lastTimestamp = cur->timestamp;
+        first = false;
+    }
+    out.shrink_to_fit();
+    residentBytes -= entry.bytes;
+    entry.bytes = out.capacity();
+    spilledBytes += entry.bytes;
+    entry.spilled.swap(out);
+    entry.topK = entry.board->getTopKCacheSize();
+    entry.journal = entry.board->getJournal();
+    entry.deltaFeed = entry.board->getDeltaFeed();
+    entry.board.reset();
+    lru.erase(entry.lru);
+    spills++;
+}
+
+void RankBoardRegistry::reload(Entry& entry) {
+    const char* p = entry.spilled.data();
+    size_t count = getVarint(p);
+    std::vector<SkipListEntry> sorted;
+    sorted.reserve(count);
+    int64_t score = 0;
+    int64_t timestamp = 0;
+    for (size_t i = 0; i < count; i++) {
+        PlayerHandle player = static_cast<PlayerHandle>(getVarint(p));
+        uint64_t delta = getVarint(p);
+        score = i == 0 ? unzigzag(delta) : static_cast<int64_t>(static_cast<uint64_t>(score) - delta);
+        timestamp += unzigzag(getVarint(p));
+        sorted.push_back(SkipListEntry{score, static_cast<time_t>(timestamp), player});
+    }
+    entry.board = newBoard();
+    entry.board->loadSorted(sorted);
+    // 内容和压缩前一样，加载完再挂上
+    entry.board->setTopKCache(entry.topK);
+    entry.board->setJournal(entry.journal);
+    entry.board->setDeltaFeed(entry.deltaFeed);
+    spilledBytes -= entry.bytes;
+    std::vector<char>().swap(entry.spilled);
+    entry.bytes = 0;
+    measure(entry);
+    lru.push_front(&entry);
+    entry.lru = lru.begin();
+    reloads++;
+}
+
+void RankBoardRegistry::enforceBudget() {
+    if (budget == 0) {
+        return;
+    }
+    // 从最久没用的往前找没有在使用的
+    auto it = lru.end();
+    while (residentBytes > budget && it != lru.begin()) {
+        --it;
+        Entry& entry = **it;
+        if (entry.users > 0) {
+            continue;
+        }
+        // spill会把它从lru里删掉，先退回到后一个位置
+        ++it;
+        spill(entry);
+    }
+}
+
+void RankBoardRegistry::updateScore(const std::string& board, const std::string& playerId, int64_t newScore,
+                                    time_t timestamp) {
+    with(board, [&](RankBoard& b) { b.updateScore(playerId, newScore, timestamp); });
+}
+
+int RankBoardRegistry::getRank(const std::string& board, const std::string& playerId) {
+    return with(board, [&](RankBoard& b) { return b.getRank(playerId); });
+}
+
+std::vector<RankInfo> RankBoardRegistry::getTopNPlayers(const std::string& board, int n) {
+    return with(board, [&](RankBoard& b) { return b.getTopNPlayers(n); });
+}
+
+std::vector<RankInfo> RankBoardRegistry::getNearbyPlayers(const std::string& board, const std::string& playerId, int n) {
+    return with(board, [&](RankBoard& b) { return b.getNearbyPlayers(playerId, n); });
+}
+
+bool RankBoardRegistry::remove(const std::string& name) {
+    auto it = entries.find(name);
+    if (it == entries.end() || it->second->users > 0) {
+        return false;
+    }
+    Entry& entry = *it->second;
+    if (entry.board) {
+        residentBytes -= entry.bytes;
+        lru.erase(entry.lru);
+    } else {
+        spilledBytes -= entry.bytes;
+    }
+    entries.erase(it);
+    return true;
+}
+
+size_t RankBoardRegistry::boardBytes(const std::string& name) const {
+    auto it = entries.find(name);
+    return it == entries.end() ? 0 : it->second->bytes;
+}
+
+bool RankBoardRegistry::isSpilled(const std::string& name) const {
+    auto it = entries.find(name);
+    return it != entries.end() && !it->second->board;
+}
+
+RegistryStats RankBoardRegistry::stats() const {
+    RegistryStats stats;
+    stats.boards = entries.size();
+    stats.residentBoards = lru.size();
+    stats.residentBytes = residentBytes;
+    stats.spilledBytes = spilledBytes;
+    stats.playerTableBytes = players->memoryBytes();
+    stats.spills = spills;
+    stats.reloads = reloads;
+    return stats;
+}
+
+void RankBoardRegistry::setMemoryBudget(size_t bytes) {
+    budget = bytes;
+    enforceBudget();
+}
@@ -0,0 +1,103 @@
+/*
+    排行榜注册表：一个进程里按名字管理成千上万个小排行榜(公会榜、活动榜)。
+    所有排行榜共用一个PlayerTable，playerId只驻留一次；排行榜的句柄索引用哈希表，不按全局玩家数占内存。
+    设置内存预算后，常驻排行榜的内存超过预算时，按最近最少使用的顺序把冷的排行榜压缩成紧凑的字节串并释放跳表：
+    每个玩家按排名顺序存句柄、和上一名的分数差、和上一名的时间戳差，都是变长整数，一般不到10个字节。
+    再次访问时从字节串按排名顺序追加回跳表，O(n)。
+    压缩时记下前K名缓存、预写日志和增量流的设置，恢复后重新挂上；恢复不写日志，也不往增量流里记清空和重新插入。
+    排行榜只能在with的回调里使用，回调返回后它可能被压缩，不要把RankBoard的引用或节点指针带出来。
+    不是线程安全的，和不开并发读的RankBoard一样由一个线程使用。
+*/
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "RankBoard.h"
+
+// 注册表的内存占用
+struct RegistryStats {
+    size_t boards;            // 排行榜个数
+    size_t residentBoards;    // 其中常驻的
+    size_t residentBytes;     // 常驻排行榜的跳表、索引和对象本身
+    size_t spilledBytes;      // 压缩的排行榜的字节串
+    size_t playerTableBytes;  // 共用的玩家id表
+    uint64_t spills;          // 累计压缩次数
+    uint64_t reloads;         // 累计恢复次数
+};
+
+class RankBoardRegistry {
+public:
+    // memoryBudget为常驻排行榜的内存上限(字节)，0为不限制
+    explicit RankBoardRegistry(size_t memoryBudget = 0, uint64_t seed = std::random_device{}());
+    RankBoardRegistry(const RankBoardRegistry&) = delete;
+    RankBoardRegistry& operator=(const RankBoardRegistry&) = delete;
+
+    // 对名为name的排行榜调用fn(RankBoard&)并返回它的结果；不存在则新建，压缩了的先恢复
+    template <class Fn>
+    decltype(auto) with(const std::string& name, Fn&& fn) {
+        Entry& entry = acquire(name);
+        Release release{this, &entry};
+        return fn(*entry.board);
+    }
+    void updateScore(const std::string& board, const std::string& playerId, int64_t newScore, time_t timestamp);
+    int getRank(const std::string& board, const std::string& playerId);
+    std::vector<RankInfo> getTopNPlayers(const std::string& board, int n);
+    std::vector<RankInfo> getNearbyPlayers(const std::string& board, const std::string& playerId, int n);
+    bool contains(const std::string& name) const { return entries.count(name) != 0; }
+    // 删除排行榜，不存在返回false
+    bool remove(const std::string& name);
+    // 一个排行榜占用的内存：常驻时为跳表、索引和对象本身，压缩后为字节串；不存在返回0
+    size_t boardBytes(const std::string& name) const;
+    // 是否是压缩状态
+    bool isSpilled(const std::string& name) const;
+    RegistryStats stats() const;
+    // 修改内存预算，马上按新预算压缩
+    void setMemoryBudget(size_t bytes);
+    // 共用的玩家id表
+    const PlayerTable& playerTable() const { return *players; }
+
+private:
+    struct Entry {
+        std::string name;
+        std::unique_ptr<RankBoard> board;   // 压缩后为空
+        std::vector<char> spilled;          // 压缩后的字节串
+        int topK = 0;                       // 压缩时的前K名缓存大小、日志和增量流，恢复时重新设置
+        RankJournal* journal = nullptr;
+        RankDeltaFeed* deltaFeed = nullptr;
+        size_t bytes = 0;                   // 上次统计的占用
+        std::list<Entry*>::iterator lru;    // 在lru里的位置，只有常驻的在lru里
+        int users = 0;                      // 正在with里使用的次数，使用中的不会被压缩
+    };
+    // with返回时调用release
+    struct Release {
+        RankBoardRegistry* registry;
+        Entry* entry;
+        ~Release() { registry->release(*entry); }
+    };
+
+    std::shared_ptr<PlayerTable> players;
+    std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+    std::list<Entry*> lru;  // 常驻的排行榜，最近使用的在前面
+    size_t budget;
+    uint64_t seed;
+    uint64_t created = 0;   // 已创建的排行榜个数，和seed一起决定新排行榜的种子
+    size_t residentBytes = 0;
+    size_t spilledBytes = 0;
+    uint64_t spills = 0;
+    uint64_t reloads = 0;
+
+    std::unique_ptr<RankBoard> newBoard();
+    Entry& acquire(const std::string& name);
+    void release(Entry& entry);
+    // 重新统计一个常驻排行榜的占用
+    void measure(Entry& entry);
+    void spill(Entry& entry);
+    void reload(Entry& entry);
+    // 从最久没用的开始压缩，直到不超过预算
+    void enforceBudget();
+};
@@ -0,0 +1,212 @@
+#include "RankDeltaFeed.h"
+
+#include <algorithm>
+
+#include "RankSnapshot.h"
+
+void RankDeltaFeed::bind(std::shared_ptr<const PlayerTable> playerTable) {
+    std::lock_guard<std::mutex> guard(lock);
+    players = std::move(playerTable);
+}
+
+void RankDeltaFeed::append(DeltaKind kind, PlayerHandle player, int64_t oldScore, int64_t newScore, time_t timestamp) {
+    std::lock_guard<std::mutex> guard(lock);
+    log.push_back(Record{nextSequence++, oldScore, newScore, timestamp, player, kind});
+    if (log.size() >= nextCompact) {
+        std::vector<Record> compacted;
+        compactRange(log.data(), log.data() + log.size(), compacted);
+        log.swap(compacted);
+        compactions++;
+        // 压缩后还剩很多(玩家多、改动分散)时等它再翻一倍，不会每次追加都压缩
+        nextCompact = std::max(options.compactRecords, log.size() * 2);
+    }
+}
+
+void RankDeltaFeed::compact() {
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<Record> compacted;
+    compactRange(log.data(), log.data() + log.size(), compacted);
+    log.swap(compacted);
+    compactions++;
+    nextCompact = std::max(options.compactRecords, log.size() * 2);
+}
+
+void RankDeltaFeed::compactRange(const Record* begin, const Record* end, std::vector<Record>& out) const {
+    out.clear();
+    // 最后一次清空之前的记录都不用了
+    const Record* start = begin;
+    for (const Record* p = end; p != begin;) {
+        if ((--p)->kind == DeltaKind::Clear) {
+            start = p;
+            break;
+        }
+    }
+    // 句柄 -> 在out里的位置
+    const uint32_t NONE = UINT32_MAX;
+    std::vector<uint32_t> slot(players ? players->size() : 0, NONE);
+    for (const Record* p = start; p < end; p++) {
+        if (p->kind == DeltaKind::Clear) {
+            out.push_back(*p);
+            continue;
+        }
+        if (p->player >= slot.size()) {
+            slot.resize(p->player + 1, NONE);
+        }
+        uint32_t& at = slot[p->player];
+        if (at == NONE) {
+            at = static_cast<uint32_t>(out.size());
+            out.push_back(*p);
+            continue;
+        }
+        // 类型和老分数留第一条的，新分数、时间戳和序号取最后一条的
+        Record& merged = out[at];
+        merged.newScore = p->newScore;
+        merged.timestamp = p->timestamp;
+        merged.sequence = p->sequence;
+    }
+    std::sort(out.begin(), out.end(), [](const Record& a, const Record& b) { return a.sequence < b.sequence; });
+}
+
+void RankDeltaFeed::toDelta(const Record& record, RankDelta& delta) const {
+    delta.sequence = record.sequence;
+    delta.kind = record.kind;
+    if (record.kind == DeltaKind::Clear) {
+        delta.playerId.clear();
+    } else {
+        delta.playerId.assign(players->name(record.player));
+    }
+    delta.oldScore = record.oldScore;
+    delta.newScore = record.newScore;
+    delta.timestamp = record.timestamp;
+}
+
+bool RankDeltaFeed::read(uint64_t after, size_t maxRecords, std::vector<RankDelta>& out, uint64_t& through,
+                         bool* compacted) const {
+    std::lock_guard<std::mutex> guard(lock);
+    out.clear();
+    if (compacted) {
+        *compacted = false;
+    }
+    if (after < base) {
+        return false;
+    }
+    through = std::max(after, nextSequence - 1);
+    auto first = std::upper_bound(log.begin(), log.end(), after,
+                                  [](uint64_t sequence, const Record& record) { return sequence < record.sequence; });
+    size_t remaining = static_cast<size_t>(log.end() - first);
+    if (remaining <= maxRecords) {
+        out.resize(remaining);
+        for (size_t i = 0; i < remaining; i++) {
+            toDelta(first[i], out[i]);
+        }
+        return true;
+    }
+    // 副本落后太多：每个玩家只发最后一条
+    std::vector<Record> merged;
+    compactRange(&*first, log.data() + log.size(), merged);
+    out.resize(merged.size());
+    for (size_t i = 0; i < merged.size(); i++) {
+        toDelta(merged[i], out[i]);
+    }
+    compactedReads++;
+    if (compacted) {
+        *compacted = true;
+    }
+    return true;
+}
+
+uint64_t RankDeltaFeed::lastSequence() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return nextSequence - 1;
+}
+
+void RankDeltaFeed::truncate(uint64_t sequence) {
+    std::lock_guard<std::mutex> guard(lock);
+    sequence = std::min(sequence, nextSequence - 1);
+    auto last = std::upper_bound(log.begin(), log.end(), sequence,
+                                 [](uint64_t s, const Record& record) { return s < record.sequence; });
+    log.erase(log.begin(), last);
+    base = std::max(base, sequence);
+}
+
+DeltaFeedStats RankDeltaFeed::stats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    DeltaFeedStats stats;
+    stats.records = log.size();
+    stats.bytes = log.capacity() * sizeof(Record);
+    stats.baseSequence = base;
+    stats.lastSequence = nextSequence - 1;
+    stats.compactions = compactions;
+    stats.compactedReads = compactedReads;
+    return stats;
+}
+
+bool RankReplica::loadBase(const std::string& dumpPath, std::string* error) {
+    uint64_t sequence = 0;
+    if (!rankBoard.load(dumpPath, &sequence, error)) {
+        return false;
+    }
+    applied = sequence;
+    return true;
+}
+
+void RankReplica::loadBase(const RankSnapshot& snapshot, uint64_t sequence) {
+    std::vector<SkipListEntry> entries(snapshot.size());
+    for (int rank = 1; rank <= snapshot.size(); rank++) {
+        const RankSnapshot::Entry& entry = snapshot.at(rank);
+        std::string playerId(snapshot.playerId(entry));
+        entries[rank - 1] = SkipListEntry{entry.score, entry.timestamp, rankBoard.getHandle(playerId)};
+    }
+    rankBoard.loadSorted(entries);
+    applied = sequence;
+}
+
+// 相邻的更新攒成一批用updateScores写入，遇到清空时先把前面的写进去
+void RankReplica::apply(const std::vector<RankDelta>& deltas, uint64_t through) {
+    batch.clear();
+    for (const RankDelta& delta : deltas) {
+        if (delta.sequence <= applied) {
+            continue;
+        }
+        if (delta.kind == DeltaKind::Clear) {
+            if (!batch.empty()) {
+                rankBoard.updateScores(batch);
+                batch.clear();
+            }
+            rankBoard.clear();
+        } else {
+            batch.push_back(ScoreUpdate{delta.playerId, delta.newScore, delta.timestamp});
+        }
+        applied = delta.sequence;
+        appliedCount++;
+    }
+    if (!batch.empty()) {
+        rankBoard.updateScores(batch);
+        batch.clear();
+    }
+    applied = std::max(applied, through);
+}
+
+// 一次read就读到最新：落后不超过maxRecords条时原样读，否则读压缩后的
+bool RankReplica::catchUp(const RankDeltaFeed& feed, size_t maxRecords) {
+    uint64_t through = 0;
+    if (!feed.read(applied, maxRecords, buffer, through)) {
+        return false;
+    }
+    apply(buffer, through);
+    return true;
+}
+
+bool sameRanking(RankBoard& primary, RankBoard& replica) {
+    const PlayerTable& primaryPlayers = primary.playerTable();
+    const PlayerTable& replicaPlayers = replica.playerTable();
+    SkipListNode* a = primary.getHeadNode()->level[0].forward;
+    SkipListNode* b = replica.getHeadNode()->level[0].forward;
+    for (; a && b; a = a->level[0].forward, b = b->level[0].forward) {
+        if (a->score != b->score || a->timestamp != b->timestamp ||
+            primaryPlayers.name(a->player) != replicaPlayers.name(b->player)) {
+            return false;
+        }
+    }
+    return !a && !b;
+}
@@ -0,0 +1,136 @@
+/*
+    增量流：给只读副本用，代替定时拉取整个切片。
+    RankBoard::setDeltaFeed挂上以后，每次updateScore/updateScores按顺序记一条带序号的 (playerId, 老分数, 新分数, 时间戳)，
+    clear记一条清空，load/loadSorted记一条清空加上每个玩家一条插入。记录里存的是玩家句柄，读的时候才换成playerId。
+    副本RankReplica先加载基础快照，再按序号应用之后的增量，得到和主排行榜完全相同的排行榜：
+        基础快照可以是转储文件，主排行榜dump时把lastSequence()作为序号写进去；也可以是同一进程里的RankSnapshot加上生成时的序号。
+        挂上增量流之前就在榜上的玩家不在流里，副本要从那时的基础快照开始；挂上之后一直没截断时副本也可以从序号0开始。
+    压缩：每个玩家只留最后一条(last-write-wins)，老分数取合并的第一条的，最后一次清空之前的记录都去掉。
+        副本落后超过一次读取的条数时，read返回落后区间压缩后的结果，最多每个玩家一条；
+        流里的记录数超过compactRecords时原地压缩一次，流的大小不超过玩家数的两倍左右。
+        压缩后的记录保留最后一次写入的序号，副本不管停在哪个序号，应用之后的记录都得到最终相同的结果；
+        只是追赶的过程中副本的状态不一定是主排行榜在某个序号时的状态，老分数也可能和副本当时的分数不同。
+    truncate去掉不再需要的记录(比如新的基础快照已经包含了它们)，停在截断点之前的副本读取失败，需要重新加载基础快照。
+    追加由排行榜的写线程调用，读取可以在任何线程，一把锁保护。
+*/
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "PlayerTable.h"
+#include "RankBoard.h"
+
+enum class DeltaKind : uint8_t {
+    Update = 0,  // 已经在榜上的玩家换了分数
+    Insert = 1,  // 新上榜的玩家，没有老分数
+    Clear = 2,   // 清空排行榜
+};
+
+// 读出来的一条增量
+struct RankDelta {
+    uint64_t sequence;
+    DeltaKind kind;
+    std::string playerId;  // 清空时为空
+    int64_t oldScore;      // 插入和清空时为0
+    int64_t newScore;
+    time_t timestamp;
+};
+
+struct DeltaFeedStats {
+    size_t records;         // 流里现有的记录数
+    size_t bytes;
+    uint64_t baseSequence;  // 截断点，序号不大于它的记录已经去掉
+    uint64_t lastSequence;
+    uint64_t compactions;   // 原地压缩的次数
+    uint64_t compactedReads;  // 副本落后、返回压缩结果的次数
+};
+
+class RankDeltaFeed {
+public:
+    struct Options {
+        size_t compactRecords = 1 << 20;  // 记录数超过它时原地压缩
+    };
+
+    RankDeltaFeed() : RankDeltaFeed(Options()) {}
+    explicit RankDeltaFeed(const Options& options) : options(options), nextCompact(options.compactRecords) {}
+    RankDeltaFeed(const RankDeltaFeed&) = delete;
+    RankDeltaFeed& operator=(const RankDeltaFeed&) = delete;
+
+    // 以下由RankBoard的写线程调用
+    // 记录用哪个玩家id表解释句柄，setDeltaFeed时调用
+    void bind(std::shared_ptr<const PlayerTable> playerTable);
+    void append(DeltaKind kind, PlayerHandle player, int64_t oldScore, int64_t newScore, time_t timestamp);
+    void appendClear() { append(DeltaKind::Clear, PlayerTable::INVALID, 0, 0, 0); }
+
+    // 读取序号大于after的记录，按序号排好，through为读到的位置，下次从它接着读；
+    // 不超过maxRecords条时原样返回，超过时返回压缩后的结果(不受maxRecords限制)，compacted为true；
+    // after早于截断点时返回false，副本要重新加载基础快照
+    bool read(uint64_t after, size_t maxRecords, std::vector<RankDelta>& out, uint64_t& through,
+              bool* compacted = nullptr) const;
+    // 最后一条记录的序号，没有记录为0
+    uint64_t lastSequence() const;
+    // 去掉序号不大于sequence的记录
+    void truncate(uint64_t sequence);
+    // 原地压缩
+    void compact();
+    DeltaFeedStats stats() const;
+
+private:
+    struct Record {
+        uint64_t sequence;
+        int64_t oldScore;
+        int64_t newScore;
+        time_t timestamp;
+        PlayerHandle player;
+        DeltaKind kind;
+    };
+
+    Options options;
+    std::shared_ptr<const PlayerTable> players;
+    mutable std::mutex lock;
+    std::vector<Record> log;  // 按序号排好
+    uint64_t nextSequence = 1;
+    uint64_t base = 0;
+    size_t nextCompact;       // 记录数到这里时原地压缩
+    uint64_t compactions = 0;
+    mutable uint64_t compactedReads = 0;
+
+    // 把[begin, end)压缩进out，调用时持有lock
+    void compactRange(const Record* begin, const Record* end, std::vector<Record>& out) const;
+    void toDelta(const Record& record, RankDelta& delta) const;
+};
+
+// 只读副本：基础快照加增量，得到和主排行榜相同的排行榜
+class RankReplica {
+public:
+    explicit RankReplica(uint64_t seed = std::random_device{}()) : rankBoard(seed) {}
+
+    // 从主排行榜dump出的文件加载，文件里的序号就是增量流的序号
+    bool loadBase(const std::string& dumpPath, std::string* error = nullptr);
+    // 从同一进程里的快照加载，sequence为生成快照时增量流的lastSequence()
+    void loadBase(const RankSnapshot& snapshot, uint64_t sequence);
+    // 按顺序应用一批增量，序号不大于sequence()的跳过，through为这批读到的位置
+    void apply(const std::vector<RankDelta>& deltas, uint64_t through);
+    // 从同一进程里的增量流追到最新，落后超过maxRecords条时读压缩后的结果；返回false表示落后到截断点之前，要重新加载基础快照
+    bool catchUp(const RankDeltaFeed& feed, size_t maxRecords = 4096);
+    // 已经应用到的序号
+    uint64_t sequence() const { return applied; }
+    uint64_t deltasApplied() const { return appliedCount; }
+    RankBoard& board() { return rankBoard; }
+
+private:
+    RankBoard rankBoard;
+    uint64_t applied = 0;
+    uint64_t appliedCount = 0;
+    std::vector<RankDelta> buffer;
+    std::vector<ScoreUpdate> batch;
+};
+
+// 两个排行榜的排名顺序、playerId、分数和时间戳是否完全相同，用来校验副本
+bool sameRanking(RankBoard& primary, RankBoard& replica);
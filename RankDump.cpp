@@ -0,0 +1,289 @@
+#include "RankDump.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char DUMP_MAGIC[8] = {'R', 'A', 'N', 'K', 'D', 'U', 'M', 'P'};
+const size_t RECORD_FIXED_BYTES = 8 + 8 + 4;
+const size_t WRITE_BUFFER_BYTES = 1 << 20;
+
+void setError(std::string* error, const char* message) {
+    if (error) {
+        *error = message;
+    }
+}
+
+bool syncFile(FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifndef _WIN32
+    return fdatasync(fileno(file)) == 0;
+#else
+    return true;
+#endif
+}
+
+}  // namespace
+
+bool syncDirectory(const std::string& path) {
+#ifndef _WIN32
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#else
+    (void)path;
+    return true;
+#endif
+}
+
+void DumpChecksum::mix(uint64_t word) {
+    hash ^= word * 0x87C37B91114253D5ULL;
+    hash = (hash << 31) | (hash >> 33);
+    hash *= 0x4CF5AD432745937FULL;
+}
+
+void DumpChecksum::update(const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    total += size;
+    // 先把上次剩下的尾巴凑满8字节
+    while (pendingBytes > 0 && pendingBytes < 8 && size > 0) {
+        pending |= uint64_t(*p++) << (pendingBytes * 8);
+        pendingBytes++;
+        size--;
+    }
+    if (pendingBytes == 8) {
+        mix(pending);
+        pending = 0;
+        pendingBytes = 0;
+    }
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        mix(word);
+        p += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        pending |= uint64_t(*p++) << (pendingBytes * 8);
+        pendingBytes++;
+        size--;
+    }
+}
+
+uint64_t DumpChecksum::value() const {
+    uint64_t h = hash;
+    h ^= pending * 0x87C37B91114253D5ULL;
+    h ^= total;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return h;
+}
+
+DumpWriter::~DumpWriter() {
+    if (file) {
+        std::fclose(file);
+        std::remove(tmpPath.c_str());
+    }
+}
+
+bool DumpWriter::open(const std::string& dumpPath, uint32_t kind, uint64_t sequence) {
+    path = dumpPath;
+    tmpPath = dumpPath + ".tmp";
+    file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    std::memcpy(header.magic, DUMP_MAGIC, sizeof(DUMP_MAGIC));
+    header.version = DUMP_VERSION;
+    header.kind = kind;
+    header.sequence = sequence;
+    // 先占住header的位置，finish时回填
+    failed = std::fwrite(&header, sizeof(header), 1, file) != 1;
+    buffer.reserve(WRITE_BUFFER_BYTES);
+    return !failed;
+}
+
+void DumpWriter::append(int64_t score, int64_t timestamp, std::string_view playerId) {
+    uint32_t length = static_cast<uint32_t>(playerId.size());
+    size_t at = buffer.size();
+    buffer.resize(at + RECORD_FIXED_BYTES + length);
+    char* p = buffer.data() + at;
+    std::memcpy(p, &score, 8);
+    std::memcpy(p + 8, &timestamp, 8);
+    std::memcpy(p + 16, &length, 4);
+    std::memcpy(p + RECORD_FIXED_BYTES, playerId.data(), length);
+    header.count++;
+    if (buffer.size() >= WRITE_BUFFER_BYTES) {
+        flush();
+    }
+}
+
+void DumpWriter::flush() {
+    if (buffer.empty()) {
+        return;
+    }
+    checksum.update(buffer.data(), buffer.size());
+    header.bodyBytes += buffer.size();
+    if (!failed && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+        failed = true;
+    }
+    buffer.clear();
+}
+
+bool DumpWriter::finish() {
+    if (!file) {
+        return false;
+    }
+    flush();
+    header.checksum = checksum.value();
+    if (!failed) {
+        failed = std::fseek(file, 0, SEEK_SET) != 0 || std::fwrite(&header, sizeof(header), 1, file) != 1 ||
+                 !syncFile(file);
+    }
+    failed = std::fclose(file) != 0 || failed;
+    file = nullptr;
+    if (failed) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    // Windows上rename不能覆盖已有文件，只能先删掉，这中间崩溃会没有转储
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return syncDirectory(path);
+}
+
+DumpReader::~DumpReader() {
+    close();
+}
+
+bool DumpReader::open(const std::string& path, std::string* error) {
+    close();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        setError(error, "cannot open file");
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        setError(error, "cannot stat file");
+        return false;
+    }
+    size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            setError(error, "mmap failed");
+            return false;
+        }
+        // 顺序读，提示内核提前预读
+        madvise(p, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(p);
+        mapped = true;
+    }
+    ::close(fd);
+#else
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        setError(error, "cannot open file");
+        return false;
+    }
+    std::fseek(file, 0, SEEK_END);
+    size = static_cast<size_t>(std::ftell(file));
+    std::fseek(file, 0, SEEK_SET);
+    copy.resize(size);
+    size_t got = std::fread(copy.data(), 1, size, file);
+    std::fclose(file);
+    if (got != size) {
+        setError(error, "cannot read file");
+        return false;
+    }
+    data = copy.data();
+#endif
+    if (size < sizeof(DumpHeader)) {
+        setError(error, "file too short");
+        close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, DUMP_MAGIC, sizeof(DUMP_MAGIC)) != 0) {
+        setError(error, "bad magic");
+        close();
+        return false;
+    }
+    if (header.version != DUMP_VERSION) {
+        setError(error, "unsupported version");
+        close();
+        return false;
+    }
+    if (header.bodyBytes != size - sizeof(DumpHeader)) {
+        setError(error, "truncated file");
+        close();
+        return false;
+    }
+    DumpChecksum checksum;
+    checksum.update(data + sizeof(DumpHeader), header.bodyBytes);
+    if (checksum.value() != header.checksum) {
+        setError(error, "checksum mismatch");
+        close();
+        return false;
+    }
+    offset = sizeof(DumpHeader);
+    remaining = header.count;
+    return true;
+}
+
+bool DumpReader::next(Record& record) {
+    if (remaining == 0 || size - offset < RECORD_FIXED_BYTES) {
+        return false;
+    }
+    const char* p = data + offset;
+    uint32_t length;
+    std::memcpy(&record.score, p, 8);
+    std::memcpy(&record.timestamp, p + 8, 8);
+    std::memcpy(&length, p + 16, 4);
+    if (size - offset - RECORD_FIXED_BYTES < length) {
+        return false;
+    }
+    record.playerId = std::string_view(p + RECORD_FIXED_BYTES, length);
+    offset += RECORD_FIXED_BYTES + length;
+    remaining--;
+    return true;
+}
+
+void DumpReader::close() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<char*>(data), size);
+    }
+#endif
+    std::vector<char>().swap(copy);
+    data = nullptr;
+    size = 0;
+    offset = 0;
+    remaining = 0;
+    mapped = false;
+}
@@ -0,0 +1,102 @@
+/*
+    排行榜的二进制转储文件，普通版和密集版共用，重启时直接加载，不用重放所有updateScore。
+    文件布局：
+        DumpHeader
+        count条记录，按排名顺序：int64 score | int64 timestamp | uint32 playerId长度 | playerId
+    记录不对齐，读取时用memcpy。header里的checksum覆盖header之后的全部字节。
+    读取时用mmap把整个文件映射进来，校验通过后按顺序遍历记录，不拷贝文件内容。
+    写入时先写path.tmp，fsync之后改名覆盖原文件再fsync所在目录，中途崩溃或断电时原来的转储仍然完整。
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct DumpHeader {
+    char magic[8];         // "RANKDUMP"
+    uint32_t version;      // 文件格式版本
+    uint32_t kind;         // DUMP_SPARSE / DUMP_DENSE，只作说明，两种格式相同
+    uint64_t count;        // 记录数
+    uint64_t bodyBytes;    // header之后的字节数
+    uint64_t sequence;     // 转储时已经应用到的日志序号，没有日志时为0
+    uint64_t checksum;     // header之后全部字节的校验和
+};
+
+const uint32_t DUMP_VERSION = 1;
+const uint32_t DUMP_SPARSE = 0;
+const uint32_t DUMP_DENSE = 1;
+
+// 改名之后把path所在目录fsync，目录项落盘后断电也不会回到原来的文件；日志压缩也用它
+bool syncDirectory(const std::string& path);
+
+// 按8字节一组滚动计算的64位校验和，可以分多次update
+class DumpChecksum {
+public:
+    void update(const void* data, size_t size);
+    uint64_t value() const;
+private:
+    uint64_t hash = 0x9E3779B97F4A7C15ULL;
+    uint64_t pending = 0;   // 不满8字节的尾巴
+    size_t pendingBytes = 0;
+    uint64_t total = 0;
+    void mix(uint64_t word);
+};
+
+// 按排名顺序写记录，finish时回填header；写的是临时文件，finish成功才替换path，没有finish时删掉临时文件
+class DumpWriter {
+public:
+    DumpWriter() = default;
+    ~DumpWriter();
+    DumpWriter(const DumpWriter&) = delete;
+    DumpWriter& operator=(const DumpWriter&) = delete;
+
+    bool open(const std::string& path, uint32_t kind, uint64_t sequence);
+    void append(int64_t score, int64_t timestamp, std::string_view playerId);
+    // 写完header、落盘并改名成path，写入失败返回false，path保持原样
+    bool finish();
+
+private:
+    FILE* file = nullptr;
+    std::string path;
+    std::string tmpPath;
+    DumpHeader header{};
+    DumpChecksum checksum;
+    std::vector<char> buffer;
+    bool failed = false;
+    void flush();
+};
+
+// 映射转储文件并校验，校验通过后用next按顺序读出记录
+class DumpReader {
+public:
+    struct Record {
+        int64_t score;
+        int64_t timestamp;
+        std::string_view playerId;  // 指向映射的文件内容，reader关闭前有效
+    };
+
+    DumpReader() = default;
+    ~DumpReader();
+    DumpReader(const DumpReader&) = delete;
+    DumpReader& operator=(const DumpReader&) = delete;
+
+    // 打开并校验magic、版本、长度和校验和，失败返回false，error里是原因
+    bool open(const std::string& path, std::string* error = nullptr);
+    const DumpHeader& getHeader() const { return header; }
+    // 读下一条记录，没有了或者记录损坏返回false
+    bool next(Record& record);
+    void close();
+
+private:
+    DumpHeader header{};
+    const char* data = nullptr;  // 整个文件
+    size_t size = 0;
+    size_t offset = 0;
+    uint64_t remaining = 0;
+    bool mapped = false;         // mmap得到的还是读进内存的
+    std::vector<char> copy;      // 不支持mmap的平台把文件读进来
+};
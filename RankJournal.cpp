@@ -0,0 +1,346 @@
+#include "RankJournal.h"
+#include "RankDump.h"
+
+#include <chrono>
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t FRAME_HEADER_BYTES = 4 + 4;
+
+void putVarint(std::vector<char>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+bool getVarint(const char*& p, const char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        v |= uint64_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+// FNV-1a，记录都很短
+uint32_t checksumOf(const char* data, size_t size) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        h ^= static_cast<uint8_t>(data[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// 在out后面追加一条完整的记录
+void encode(std::vector<char>& out, uint64_t sequence, std::string_view playerId, int64_t score, int64_t timestamp) {
+    size_t frame = out.size();
+    out.resize(frame + FRAME_HEADER_BYTES);
+    putVarint(out, sequence);
+    putVarint(out, zigzag(score));
+    putVarint(out, zigzag(timestamp));
+    out.insert(out.end(), playerId.begin(), playerId.end());
+    size_t payload = out.size() - frame - FRAME_HEADER_BYTES;
+    uint32_t checksum = checksumOf(out.data() + frame + FRAME_HEADER_BYTES, payload);
+    uint32_t length = static_cast<uint32_t>(payload);
+    std::memcpy(out.data() + frame, &checksum, 4);
+    std::memcpy(out.data() + frame + 4, &length, 4);
+}
+
+// 顺序解析文件内容，每条完整的记录调用一次fn，返回最后一条的序号
+template <class Fn>
+uint64_t decodeAll(const std::vector<char>& data, Fn fn) {
+    uint64_t last = 0;
+    const char* p = data.data();
+    const char* end = p + data.size();
+    while (static_cast<size_t>(end - p) >= FRAME_HEADER_BYTES) {
+        uint32_t checksum;
+        uint32_t length;
+        std::memcpy(&checksum, p, 4);
+        std::memcpy(&length, p + 4, 4);
+        const char* payload = p + FRAME_HEADER_BYTES;
+        if (static_cast<size_t>(end - payload) < length || checksumOf(payload, length) != checksum) {
+            break;
+        }
+        const char* q = payload;
+        const char* payloadEnd = payload + length;
+        uint64_t sequence, score, timestamp;
+        if (!getVarint(q, payloadEnd, sequence) || !getVarint(q, payloadEnd, score) || !getVarint(q, payloadEnd, timestamp)) {
+            break;
+        }
+        fn(p, payloadEnd, sequence, std::string_view(q, payloadEnd - q), unzigzag(score), unzigzag(timestamp));
+        last = sequence;
+        p = payloadEnd;
+    }
+    return last;
+}
+
+bool readFile(const std::string& path, std::vector<char>& data) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    char chunk[64 * 1024];
+    size_t got;
+    while ((got = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + got);
+    }
+    std::fclose(file);
+    return true;
+}
+
+bool syncFile(FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifndef _WIN32
+    return fdatasync(fileno(file)) == 0;
+#else
+    return true;
+#endif
+}
+
+}  // namespace
+
+RankJournal::~RankJournal() {
+    close();
+}
+
+bool RankJournal::open(const std::string& journalPath, const Options& journalOptions) {
+    close();
+    path = journalPath;
+    options = journalOptions;
+    // 接着已有的记录编号，崩溃留下的半条记录截掉，后面的追加才能被完整读出
+    std::vector<char> data;
+    size_t validBytes = 0;
+    uint64_t last = 0;
+    if (readFile(path, data)) {
+        last = decodeAll(data, [&](const char*, const char* recordEnd, uint64_t, std::string_view, int64_t, int64_t) {
+            validBytes = recordEnd - data.data();
+        });
+    }
+    if (validBytes < data.size()) {
+        FILE* rewrite = std::fopen(path.c_str(), "wb");
+        if (!rewrite) {
+            return false;
+        }
+        bool ok = std::fwrite(data.data(), 1, validBytes, rewrite) == validBytes && syncFile(rewrite);
+        std::fclose(rewrite);
+        if (!ok) {
+            return false;
+        }
+    }
+    file = std::fopen(path.c_str(), "ab");
+    if (!file) {
+        return false;
+    }
+    nextSequence = last + 1;
+    durable = last;
+    flushes = 0;
+    writeFailed = false;
+    stopping = false;
+    flusher = std::thread(&RankJournal::run, this);
+    return true;
+}
+
+// compact重新打开失败时file已经是空的，刷盘线程还在跑，按线程判断是否打开过
+void RankJournal::close() {
+    if (!flusher.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wakeFlusher.notify_one();
+    flusher.join();
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+uint64_t RankJournal::append(std::string_view playerId, int64_t score, int64_t timestamp) {
+    std::unique_lock<std::mutex> guard(lock);
+    uint64_t sequence = nextSequence++;
+    encode(buffer, sequence, playerId, score, timestamp);
+    if (++bufferedRecords >= options.flushRecords) {
+        guard.unlock();
+        wakeFlusher.notify_one();
+    }
+    return sequence;
+}
+
+bool RankJournal::sync() {
+    std::unique_lock<std::mutex> guard(lock);
+    uint64_t target = nextSequence - 1;
+    while (durable < target && flusher.joinable() && !writeFailed) {
+        waiting = true;
+        wakeFlusher.notify_one();
+        flushed.wait(guard);
+    }
+    return durable >= target && !writeFailed;
+}
+
+// 后台线程：等到攒够记录、有人sync或者超时，交换出缓冲区写盘，写盘期间写线程继续往新缓冲区追加
+void RankJournal::run() {
+    std::vector<char> writing;
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wakeFlusher.wait_for(guard, std::chrono::milliseconds(options.flushIntervalMs), [this] {
+            return stopping || waiting || bufferedRecords >= options.flushRecords;
+        });
+        if (buffer.empty()) {
+            waiting = false;
+            flushed.notify_all();
+            if (stopping) {
+                return;
+            }
+            continue;
+        }
+        writing.swap(buffer);
+        buffer.clear();
+        bufferedRecords = 0;
+        uint64_t target = nextSequence - 1;
+        bool skip = writeFailed;
+        guard.unlock();
+        bool ok = false;
+        if (!skip) {
+            std::lock_guard<std::mutex> fileGuard(fileLock);
+            ok = writeOut(writing);
+        }
+        writing.clear();
+        guard.lock();
+        // 失败的批次不算落盘，之后的批次也不再写，sync返回false
+        if (ok) {
+            durable = target;
+            flushes++;
+        } else {
+            writeFailed = true;
+        }
+        waiting = false;
+        flushed.notify_all();
+    }
+}
+
+bool RankJournal::writeOut(const std::vector<char>& data) {
+    if (!file) {
+        return false;
+    }
+    return std::fwrite(data.data(), 1, data.size(), file) == data.size() && syncFile(file);
+}
+
+bool RankJournal::compact(uint64_t sequence) {
+    if (!sync()) {
+        return false;
+    }
+    // 拿住fileLock，刷盘线程写到一半的批次等改写完成后再写进新文件
+    std::lock_guard<std::mutex> fileGuard(fileLock);
+    if (!file) {
+        return false;
+    }
+    std::fflush(file);
+    std::vector<char> data;
+    if (!readFile(path, data)) {
+        return false;
+    }
+    // 最后一条记录总是留下，重新打开时序号才能接着往下编，回放时会按序号跳过它
+    std::vector<char> kept;
+    const char* lastBegin = nullptr;
+    const char* lastEnd = nullptr;
+    decodeAll(data, [&](const char* recordBegin, const char* recordEnd, uint64_t recordSequence, std::string_view,
+                        int64_t, int64_t) {
+        if (recordSequence > sequence) {
+            kept.insert(kept.end(), recordBegin, recordEnd);
+        }
+        lastBegin = recordBegin;
+        lastEnd = recordEnd;
+    });
+    if (kept.empty() && lastBegin) {
+        kept.assign(lastBegin, lastEnd);
+    }
+    // 先写临时文件再改名，中途崩溃时原日志仍然完整
+    std::string tmp = path + ".tmp";
+    FILE* out = std::fopen(tmp.c_str(), "wb");
+    if (!out) {
+        return false;
+    }
+    bool ok = std::fwrite(kept.data(), 1, kept.size(), out) == kept.size() && syncFile(out);
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    // Windows上rename不能覆盖已有的、还开着的文件，先关掉原日志再删掉，这中间崩溃只剩临时文件
+    std::fclose(file);
+    file = nullptr;
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+#ifndef _WIN32
+        std::remove(tmp.c_str());
+#endif
+        // Windows上原日志已经删了，留着临时文件，里面是转储之后的全部记录
+        return false;
+    }
+    // 目录项落盘之后才算压缩完成，否则断电后可能回到没压缩的日志
+    bool synced = syncDirectory(path);
+    if (file) {
+        std::fclose(file);
+    }
+    file = std::fopen(path.c_str(), "ab");
+    return file != nullptr && synced;
+}
+
+uint64_t RankJournal::lastSequence() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return nextSequence - 1;
+}
+
+uint64_t RankJournal::durableSequence() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return durable;
+}
+
+bool RankJournal::failed() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return writeFailed;
+}
+
+uint64_t RankJournal::flushCount() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return flushes;
+}
+
+uint64_t RankJournal::replay(const std::string& path, uint64_t after, const ReplayFn& fn) {
+    std::vector<char> data;
+    if (!readFile(path, data)) {
+        return after;
+    }
+    uint64_t last = decodeAll(data, [&](const char*, const char*, uint64_t sequence, std::string_view playerId,
+                                         int64_t score, int64_t timestamp) {
+        if (sequence > after) {
+            fn(sequence, playerId, score, timestamp);
+        }
+    });
+    return last > after ? last : after;
+}
@@ -0,0 +1,81 @@
+/*
+    updateScore的预写日志(append-only)，进程崩溃后用最近一次转储加日志恢复排行榜。
+    每次更新编码成一条紧凑的二进制记录追加到内存缓冲区，由后台线程批量写文件并fsync(组提交)：
+    攒够flushRecords条或者距上次刷盘超过flushIntervalMs毫秒就刷一次，写线程不用等磁盘。
+    代价是崩溃时可能丢失最后一个刷盘周期内的更新，需要确认落盘时调用sync()。
+    写文件或fsync失败后日志停止写盘(文件尾可能是半条记录，后面再写的恢复时也读不到)，sync()返回false，durableSequence()不再增长。
+    记录格式：uint32 校验和 | uint32 长度 | 内容(varint序号, zigzag varint分数, varint时间戳, playerId)
+    恢复时遇到不完整或校验失败的记录就停下，那是崩溃时写了一半的尾巴。
+    转储完成后用compact去掉转储已经包含的记录，日志不会无限增长；改写的日志先写临时文件并fsync，改名后再fsync所在目录。
+*/
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class RankJournal {
+public:
+    struct Options {
+        int flushIntervalMs = 5;    // 最长多久刷一次盘
+        size_t flushRecords = 4096; // 攒够多少条立即刷盘
+    };
+    // 回放时每条记录的回调
+    using ReplayFn = std::function<void(uint64_t sequence, std::string_view playerId, int64_t score, int64_t timestamp)>;
+
+    RankJournal() = default;
+    ~RankJournal();
+    RankJournal(const RankJournal&) = delete;
+    RankJournal& operator=(const RankJournal&) = delete;
+
+    // 打开日志文件追加写，启动刷盘线程；已有的记录保留，序号接着最后一条往下编
+    bool open(const std::string& path, const Options& options);
+    bool open(const std::string& path) { return open(path, Options()); }
+    // 刷完缓冲区后关闭
+    void close();
+    // 追加一条更新，返回它的序号，只保证进了缓冲区
+    uint64_t append(std::string_view playerId, int64_t score, int64_t timestamp);
+    // 等到目前为止追加的记录都落盘；写盘失败过或者日志没打开时返回false
+    bool sync();
+    // 去掉序号不大于sequence的记录，转储完成后调用
+    bool compact(uint64_t sequence);
+    // 最后追加的记录序号，没有记录为0
+    uint64_t lastSequence() const;
+    // 已经落盘的最大序号，写盘失败之后停在失败前的位置
+    uint64_t durableSequence() const;
+    // 是否写盘失败过，重新open之前一直为true
+    bool failed() const;
+    // 累计刷盘次数
+    uint64_t flushCount() const;
+
+    // 按顺序回放日志里序号大于after的记录，返回最后一条完整记录的序号，文件不存在返回after
+    static uint64_t replay(const std::string& path, uint64_t after, const ReplayFn& fn);
+
+private:
+    std::string path;
+    Options options;
+    FILE* file = nullptr;
+    std::thread flusher;
+    mutable std::mutex lock;              // 保护缓冲区和序号
+    std::mutex fileLock;                  // 保护file，刷盘线程写文件和compact改写文件互斥
+    std::condition_variable wakeFlusher;  // 缓冲区攒够了或者有人在等落盘
+    std::condition_variable flushed;      // 一次刷盘完成
+    std::vector<char> buffer;             // 还没写文件的记录
+    size_t bufferedRecords = 0;
+    uint64_t nextSequence = 1;
+    uint64_t durable = 0;
+    uint64_t flushes = 0;
+    bool waiting = false;                 // 有线程在sync
+    bool writeFailed = false;             // 写盘失败过，之后的记录不再写
+    bool stopping = false;
+
+    void run();
+    // 把buffer写进文件并fsync，调用时持有fileLock，不持有lock
+    bool writeOut(const std::vector<char>& data);
+};
@@ -0,0 +1,477 @@
+/*
+    rank_server的压测客户端：每个连接一个线程，阻塞socket，流水线地保持pipeline个请求在路上，
+    收到多少个回复就补发多少个，同一批请求一次send出去。
+    先用一个连接把players个玩家写进去，等它们出现在快照里，再按比例混合更新和读请求跑seconds秒，
+    输出总QPS和每种请求的p50/p99/p99.9延迟(从发出到收到回复，包括在服务端排队的时间)。
+    --replica 1时另开一个连接当副本：从序号0开始用Deltas请求拉增量流，压测期间一直跟着，
+    结束后追到最新，再按排名逐页取服务端的快照和副本比对(快照要等服务端发布，会重试几秒)。
+*/
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoardStats.h"
+#include "RankDeltaFeed.h"
+#include "RankProtocol.h"
+
+namespace {
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    int port = 7070;
+    std::string unixPath;     // 非空时连Unix socket
+    int connections = 4;
+    int pipeline = 32;        // 每个连接同时在路上的请求数
+    int seconds = 10;
+    int players = 1000000;
+    int writePercent = 10;    // 更新占的百分比，其余是读：getRank 70%，前10名、前后10名、翻页各10%
+    bool fill = true;         // 压测前先写入所有玩家
+    bool replica = false;     // 同时跑一个副本并校验
+};
+
+const int OP_KINDS = 6;
+const char* const OP_NAMES[OP_KINDS] = {"", "update", "getRank", "topN", "nearby", "range"};
+const int REPLICA_READ_RECORDS = 65536;  // 副本落后超过这么多条时服务端返回压缩后的增量
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+std::string playerName(int i) {
+    return "player-" + std::to_string(i);
+}
+
+int connectTo(const LoadOptions& options) {
+    int fd;
+    if (!options.unixPath.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, options.unixPath.c_str(), sizeof(address.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options.port));
+    if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1) {
+        return -1;
+    }
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 带缓冲地读回复
+class ResponseReader {
+public:
+    explicit ResponseReader(int fd) : fd(fd) {}
+    // 阻塞到至少有一个完整的回复，对每个回复调用fn；连接断开或者数据错误返回false
+    template <class Fn>
+    bool readSome(Fn&& fn) {
+        for (;;) {
+            RankResponse response;
+            bool any = false;
+            long consumed;
+            while ((consumed = decodeResponse(buffer.data() + pos, buffer.size() - pos, response)) > 0) {
+                pos += static_cast<size_t>(consumed);
+                fn(response);
+                any = true;
+            }
+            if (consumed < 0) {
+                return false;
+            }
+            buffer.erase(0, pos);
+            pos = 0;
+            if (any) {
+                return true;
+            }
+            size_t used = buffer.size();
+            buffer.resize(used + 64 * 1024);
+            ssize_t got = ::recv(fd, &buffer[used], 64 * 1024, 0);
+            buffer.resize(used + std::max<ssize_t>(got, 0));
+            if (got <= 0) {
+                return false;
+            }
+        }
+    }
+
+private:
+    int fd;
+    std::string buffer;
+    size_t pos = 0;
+};
+
+// 用一个连接写入所有玩家，每批确认完再发下一批
+bool fillPlayers(const LoadOptions& options) {
+    int fd = connectTo(options);
+    if (fd < 0) {
+        return false;
+    }
+    ResponseReader reader(fd);
+    std::mt19937_64 gen(7);
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    const int chunk = 10000;
+    std::string out;
+    bool ok = true;
+    for (int first = 0; first < options.players && ok; first += chunk) {
+        int count = std::min(chunk, options.players - first);
+        out.clear();
+        for (int i = 0; i < count; i++) {
+            encodeUpdate(out, static_cast<uint32_t>(i), playerName(first + i), scoreDis(gen), first + i);
+        }
+        ok = sendAll(fd, out);
+        for (int acked = 0; ok && acked < count;) {
+            ok = reader.readSome([&](const RankResponse&) { acked++; });
+        }
+    }
+    // 等最后一个玩家出现在快照里
+    for (int rank = 0; ok && rank == 0;) {
+        out.clear();
+        encodeGetRank(out, 0, playerName(options.players - 1));
+        ok = sendAll(fd, out) && reader.readSome([&](const RankResponse& response) { rank = response.rank; });
+        if (rank == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    ::close(fd);
+    return ok;
+}
+
+struct WorkerResult {
+    StatsHistogram latency[OP_KINDS];  // 纳秒
+    uint64_t errors = 0;
+    bool failed = false;
+};
+
+void runWorker(const LoadOptions& options, int worker, uint64_t deadline, WorkerResult& result) {
+    int fd = connectTo(options);
+    if (fd < 0) {
+        result.failed = true;
+        return;
+    }
+    // 请求号就是槽位号，回复乱序也能对上
+    struct Slot {
+        RankOp op;
+        uint64_t sentAt;
+    };
+    std::vector<Slot> slots(options.pipeline);
+    std::vector<uint32_t> freeSlots;
+    for (int i = options.pipeline - 1; i >= 0; i--) {
+        freeSlots.push_back(static_cast<uint32_t>(i));
+    }
+    std::mt19937_64 gen(1000 + worker);
+    std::uniform_int_distribution<int> percentDis(0, 99);
+    std::uniform_int_distribution<int> playerDis(0, std::max(0, options.players - 1));
+    std::uniform_int_distribution<int64_t> scoreDis(0, 1000000);
+    std::uniform_int_distribution<int> startDis(1, std::max(1, options.players - 10));
+    time_t timestamp = static_cast<time_t>(options.players) + worker * 1000000000LL;
+    ResponseReader reader(fd);
+    std::string out;
+    int inFlight = 0;
+    for (;;) {
+        uint64_t now = nowNs();
+        out.clear();
+        while (!freeSlots.empty() && now < deadline) {
+            uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            std::string player = playerName(playerDis(gen));
+            int percent = percentDis(gen);
+            RankOp op;
+            if (percent < options.writePercent) {
+                op = RankOp::Update;
+                encodeUpdate(out, slot, player, scoreDis(gen), timestamp++);
+            } else if ((percent = percentDis(gen)) < 70) {
+                op = RankOp::GetRank;
+                encodeGetRank(out, slot, player);
+            } else if (percent < 80) {
+                op = RankOp::TopN;
+                encodeTopN(out, slot, 10);
+            } else if (percent < 90) {
+                op = RankOp::Nearby;
+                encodeNearby(out, slot, player, 10);
+            } else {
+                op = RankOp::Range;
+                encodeRange(out, slot, startDis(gen), 10);
+            }
+            slots[slot] = Slot{op, now};
+            inFlight++;
+        }
+        if (!out.empty() && !sendAll(fd, out)) {
+            result.failed = true;
+            break;
+        }
+        if (inFlight == 0) {
+            break;
+        }
+        bool ok = reader.readSome([&](const RankResponse& response) {
+            uint64_t done = nowNs();
+            if (response.id >= slots.size()) {
+                result.errors++;
+                return;
+            }
+            const Slot& slot = slots[response.id];
+            result.latency[static_cast<int>(slot.op)].record(done - slot.sentAt);
+            if (response.status != RankStatus::Ok || response.op != slot.op) {
+                result.errors++;
+            }
+            freeSlots.push_back(response.id);
+            inFlight--;
+        });
+        if (!ok) {
+            result.failed = true;
+            break;
+        }
+    }
+    ::close(fd);
+}
+
+struct ReplicaResult {
+    uint64_t pulls = 0;
+    uint64_t compactedPulls = 0;
+    double catchUpMs = 0;    // 压测结束后追到最新用的时间
+    int players = 0;
+    bool failed = false;
+    bool matched = false;
+};
+
+// 拉一次增量应用到副本，返回这次拉到的条数，出错返回-1
+long pullDeltas(int fd, ResponseReader& reader, RankReplica& replica, std::vector<RankDelta>& deltas, ReplicaResult& result) {
+    std::string out;
+    encodeDeltas(out, 0, replica.sequence(), REPLICA_READ_RECORDS);
+    if (!sendAll(fd, out)) {
+        return -1;
+    }
+    long count = -1;
+    bool ok = reader.readSome([&](const RankResponse& response) {
+        if (response.status == RankStatus::Ok && decodeDeltas(response, deltas)) {
+            replica.apply(deltas, response.through);
+            count = static_cast<long>(deltas.size());
+            result.compactedPulls += response.compacted;
+        }
+    });
+    result.pulls++;
+    return ok ? count : -1;
+}
+
+// 按排名逐页比对服务端的快照和副本
+bool compareWithServer(int fd, ResponseReader& reader, RankReplica& replica) {
+    std::vector<RankInfo> rows;
+    int start = 1;
+    for (;;) {
+        std::string out;
+        encodeRange(out, 0, start, 1000);
+        bool same = true;
+        uint32_t count = 0;
+        if (!sendAll(fd, out) || !reader.readSome([&](const RankResponse& response) {
+                same = response.status == RankStatus::Ok && decodeRows(response, rows);
+                count = response.rowCount;
+            })) {
+            return false;
+        }
+        std::vector<RankInfo> expected = replica.board().getRange(start, count > 0 ? static_cast<int>(count) : 1);
+        if (count == 0) {
+            return same && expected.empty();
+        }
+        for (size_t i = 0; same && i < rows.size(); i++) {
+            same = i < expected.size() && rows[i].playerId == expected[i].playerId && rows[i].score == expected[i].score &&
+                   rows[i].timestamp == expected[i].timestamp;
+        }
+        if (!same || expected.size() != rows.size()) {
+            return false;
+        }
+        start += static_cast<int>(count);
+    }
+}
+
+void runReplica(const LoadOptions& options, const std::atomic<bool>& loadDone, ReplicaResult& result) {
+    int fd = connectTo(options);
+    if (fd < 0) {
+        result.failed = true;
+        return;
+    }
+    ResponseReader reader(fd);
+    RankReplica replica(99);
+    std::vector<RankDelta> deltas;
+    // 压测期间一直跟着，没有新增量时歇一下
+    while (!loadDone.load(std::memory_order_acquire)) {
+        long count = pullDeltas(fd, reader, replica, deltas, result);
+        if (count < 0) {
+            result.failed = true;
+            ::close(fd);
+            return;
+        }
+        if (count == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    // 压测线程都收到了确认，服务端已经写完，拉到空为止就是追上了
+    auto begin = std::chrono::steady_clock::now();
+    long count;
+    while ((count = pullDeltas(fd, reader, replica, deltas, result)) > 0) {
+    }
+    result.catchUpMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    result.players = static_cast<int>(replica.board().memoryStats().players);
+    result.failed = count < 0;
+    // 服务端的快照按间隔发布，没对上时等一会儿再比
+    for (int attempt = 0; !result.failed && !result.matched && attempt < 50; attempt++) {
+        if (attempt > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        result.matched = compareWithServer(fd, reader, replica);
+    }
+    ::close(fd);
+}
+
+void printRow(const char* name, const HistogramSummary& summary) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-8s %10llu %9.1f %9.1f %9.1f %9.1f %9.1f", name,
+                  static_cast<unsigned long long>(summary.count), summary.mean, summary.p50, summary.p99, summary.p999,
+                  summary.max);
+    std::cout << line << std::endl;
+}
+
+void usage() {
+    std::cerr << "usage: rank_loadgen [--host 127.0.0.1] [--port 7070] [--unix path] [--connections 4] [--pipeline 32]"
+                 " [--seconds 10] [--players 1000000] [--writes 10] [--fill 1] [--replica 0]" << std::endl;
+}
+
+}  // namespace
+
+// ./rank_loadgen --connections 4 --pipeline 32 --seconds 10 --players 1000000 --writes 10
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--host") {
+            options.host = value;
+        } else if (arg == "--port") {
+            options.port = std::atoi(value);
+        } else if (arg == "--unix") {
+            options.unixPath = value;
+        } else if (arg == "--connections") {
+            options.connections = std::max(1, std::atoi(value));
+        } else if (arg == "--pipeline") {
+            options.pipeline = std::max(1, std::atoi(value));
+        } else if (arg == "--seconds") {
+            options.seconds = std::max(1, std::atoi(value));
+        } else if (arg == "--players") {
+            options.players = std::max(1, std::atoi(value));
+        } else if (arg == "--writes") {
+            options.writePercent = std::min(100, std::max(0, std::atoi(value)));
+        } else if (arg == "--fill") {
+            options.fill = std::atoi(value) != 0;
+        } else if (arg == "--replica") {
+            options.replica = std::atoi(value) != 0;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    std::cout << "rank_loadgen: " << options.connections << " connections x pipeline " << options.pipeline << ", "
+              << options.seconds << " s, " << options.players << " players, " << options.writePercent << "% updates"
+              << std::endl;
+    if (options.fill) {
+        auto begin = std::chrono::steady_clock::now();
+        if (!fillPlayers(options)) {
+            std::cerr << "fill failed: cannot talk to rank_server" << std::endl;
+            return 1;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << "fill " << options.players << " players: " << static_cast<int>(ms) << " ms, "
+                  << options.players / ms << " k/s (until visible in snapshot)" << std::endl;
+    }
+
+    std::atomic<bool> loadDone{false};
+    ReplicaResult replicaResult;
+    std::thread replicaThread;
+    if (options.replica) {
+        replicaThread = std::thread(runReplica, std::cref(options), std::cref(loadDone), std::ref(replicaResult));
+    }
+    std::vector<std::unique_ptr<WorkerResult>> results;
+    std::vector<std::thread> threads;
+    uint64_t begin = nowNs();
+    uint64_t deadline = begin + static_cast<uint64_t>(options.seconds) * 1000000000ULL;
+    for (int i = 0; i < options.connections; i++) {
+        results.push_back(std::make_unique<WorkerResult>());
+        threads.emplace_back(runWorker, std::cref(options), i, deadline, std::ref(*results.back()));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = double(nowNs() - begin) / 1e9;
+    loadDone.store(true, std::memory_order_release);
+
+    StatsHistogram total[OP_KINDS];
+    StatsHistogram all;
+    uint64_t errors = 0;
+    bool failed = false;
+    for (const std::unique_ptr<WorkerResult>& result : results) {
+        for (int op = 1; op < OP_KINDS; op++) {
+            total[op].merge(result->latency[op]);
+            all.merge(result->latency[op]);
+        }
+        errors += result->errors;
+        failed = failed || result->failed;
+    }
+    HistogramSummary overall = all.summary(1e-3);
+    std::cout << "requests " << overall.count << " in " << seconds << " s: " << overall.count / seconds / 1000
+              << " k/s, errors " << errors << (failed ? ", some connections failed" : "") << std::endl;
+    std::cout << "op            count   mean us    p50 us    p99 us  p99.9 us    max us" << std::endl;
+    for (int op = 1; op < OP_KINDS; op++) {
+        printRow(OP_NAMES[op], total[op].summary(1e-3));
+    }
+    printRow("all", overall);
+    if (options.replica) {
+        replicaThread.join();
+        std::cout << "replica: " << replicaResult.players << " players after " << replicaResult.pulls << " pulls ("
+                  << replicaResult.compactedPulls << " compacted), caught up " << replicaResult.catchUpMs
+                  << " ms after load; ranking matches server: " << (replicaResult.matched ? "yes" : "NO")
+                  << (replicaResult.failed ? " (replica connection failed)" : "") << std::endl;
+        failed = failed || replicaResult.failed || !replicaResult.matched;
+    }
+    return failed || errors > 0 ? 1 : 0;
+}
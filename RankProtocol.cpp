@@ -0,0 +1,278 @@
+#include "RankProtocol.h"
+
+namespace {
+
+void putUint(std::string& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<char>(v >> (8 * i)));
+    }
+}
+
+uint64_t getUint(const char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) {
+        v |= uint64_t(static_cast<uint8_t>(p[i])) << (8 * i);
+    }
+    return v;
+}
+
+// 回复里id长度只有uint16，更长的id写进榜里以后每一帧都会解错
+bool validPlayerId(std::string_view playerId) {
+    return !playerId.empty() && playerId.size() <= RANK_MAX_PLAYER_ID;
+}
+
+// 追加帧头，长度先占位，返回帧的起始位置
+size_t beginFrame(std::string& out, RankOp op, uint32_t id) {
+    size_t frame = out.size();
+    putUint(out, 0, 4);
+    out.push_back(static_cast<char>(op));
+    putUint(out, id, 4);
+    return frame;
+}
+
+void endFrame(std::string& out, size_t frame) {
+    uint32_t length = static_cast<uint32_t>(out.size() - frame - 4);
+    for (int i = 0; i < 4; i++) {
+        out[frame + i] = static_cast<char>(length >> (8 * i));
+    }
+}
+
+}  // namespace
+
+void encodeUpdate(std::string& out, uint32_t id, std::string_view playerId, int64_t score, int64_t timestamp) {
+    size_t frame = beginFrame(out, RankOp::Update, id);
+    putUint(out, static_cast<uint64_t>(score), 8);
+    putUint(out, static_cast<uint64_t>(timestamp), 8);
+    out.append(playerId);
+    endFrame(out, frame);
+}
+
+void encodeGetRank(std::string& out, uint32_t id, std::string_view playerId) {
+    size_t frame = beginFrame(out, RankOp::GetRank, id);
+    out.append(playerId);
+    endFrame(out, frame);
+}
+
+void encodeTopN(std::string& out, uint32_t id, int32_t n) {
+    size_t frame = beginFrame(out, RankOp::TopN, id);
+    putUint(out, static_cast<uint32_t>(n), 4);
+    endFrame(out, frame);
+}
+
+void encodeNearby(std::string& out, uint32_t id, std::string_view playerId, int32_t n) {
+    size_t frame = beginFrame(out, RankOp::Nearby, id);
+    putUint(out, static_cast<uint32_t>(n), 4);
+    out.append(playerId);
+    endFrame(out, frame);
+}
+
+void encodeRange(std::string& out, uint32_t id, int32_t startRank, int32_t count) {
+    size_t frame = beginFrame(out, RankOp::Range, id);
+    putUint(out, static_cast<uint32_t>(startRank), 4);
+    putUint(out, static_cast<uint32_t>(count), 4);
+    endFrame(out, frame);
+}
+
+void encodeDeltas(std::string& out, uint32_t id, uint64_t after, int32_t maxRecords) {
+    size_t frame = beginFrame(out, RankOp::Deltas, id);
+    putUint(out, after, 8);
+    putUint(out, static_cast<uint32_t>(maxRecords), 4);
+    endFrame(out, frame);
+}
+
+long decodeRequest(const char* data, size_t size, size_t maxFrame, RankRequest& request) {
+    if (size < 4) {
+        return 0;
+    }
+    size_t length = getUint(data, 4);
+    if (length + 4 > maxFrame) {
+        return -1;
+    }
+    if (size < length + 4) {
+        return 0;
+    }
+    // 先清空，帧头不完整时op、id也有确定的值，回复BadRequest时原样带回
+    request = RankRequest();
+    if (length < RANK_FRAME_HEADER - 4) {
+        return static_cast<long>(length + 4);
+    }
+    request.op = static_cast<RankOp>(data[4]);
+    request.id = static_cast<uint32_t>(getUint(data + 5, 4));
+    const char* p = data + RANK_FRAME_HEADER;
+    size_t payload = length + 4 - RANK_FRAME_HEADER;
+    switch (request.op) {
+    case RankOp::Update:
+        if (payload >= 16) {
+            request.score = static_cast<int64_t>(getUint(p, 8));
+            request.timestamp = static_cast<int64_t>(getUint(p + 8, 8));
+            request.playerId = std::string_view(p + 16, payload - 16);
+            request.valid = validPlayerId(request.playerId);
+        }
+        break;
+    case RankOp::GetRank:
+        request.playerId = std::string_view(p, payload);
+        request.valid = validPlayerId(request.playerId);
+        break;
+    case RankOp::TopN:
+        if (payload == 4) {
+            request.n = static_cast<int32_t>(getUint(p, 4));
+            request.valid = true;
+        }
+        break;
+    case RankOp::Nearby:
+        if (payload >= 4) {
+            request.n = static_cast<int32_t>(getUint(p, 4));
+            request.playerId = std::string_view(p + 4, payload - 4);
+            request.valid = validPlayerId(request.playerId);
+        }
+        break;
+    case RankOp::Range:
+        if (payload == 8) {
+            request.start = static_cast<int32_t>(getUint(p, 4));
+            request.n = static_cast<int32_t>(getUint(p + 4, 4));
+            request.valid = true;
+        }
+        break;
+    case RankOp::Deltas:
+        if (payload == 12) {
+            request.after = getUint(p, 8);
+            request.n = static_cast<int32_t>(getUint(p + 8, 4));
+            request.valid = true;
+        }
+        break;
+    }
+    return static_cast<long>(length + 4);
+}
+
+size_t beginResponse(std::string& out, RankOp op, uint32_t id, RankStatus status) {
+    size_t frame = beginFrame(out, op, id);
+    out.push_back(static_cast<char>(status));
+    return frame;
+}
+
+void endResponse(std::string& out, size_t frame) {
+    endFrame(out, frame);
+}
+
+void putRankInt32(std::string& out, int32_t v) {
+    putUint(out, static_cast<uint32_t>(v), 4);
+}
+
+void putRankRow(std::string& out, int64_t score, int64_t timestamp, std::string_view playerId) {
+    putUint(out, static_cast<uint64_t>(score), 8);
+    putUint(out, static_cast<uint64_t>(timestamp), 8);
+    putUint(out, playerId.size(), 2);
+    out.append(playerId);
+}
+
+void putRankDeltas(std::string& out, uint64_t through, bool compacted, const std::vector<RankDelta>& deltas) {
+    putUint(out, through, 8);
+    out.push_back(compacted ? 1 : 0);
+    putUint(out, deltas.size(), 4);
+    for (const RankDelta& delta : deltas) {
+        putUint(out, delta.sequence, 8);
+        out.push_back(static_cast<char>(delta.kind));
+        putUint(out, static_cast<uint64_t>(delta.oldScore), 8);
+        putUint(out, static_cast<uint64_t>(delta.newScore), 8);
+        putUint(out, static_cast<uint64_t>(delta.timestamp), 8);
+        putUint(out, delta.playerId.size(), 2);
+        out.append(delta.playerId);
+    }
+}
+
+long decodeResponse(const char* data, size_t size, RankResponse& response) {
+    if (size < 4) {
+        return 0;
+    }
+    size_t length = getUint(data, 4);
+    if (length + 4 < RANK_RESPONSE_HEADER) {
+        return -1;
+    }
+    if (size < length + 4) {
+        return 0;
+    }
+    response.op = static_cast<RankOp>(data[4]);
+    response.id = static_cast<uint32_t>(getUint(data + 5, 4));
+    response.status = static_cast<RankStatus>(data[9]);
+    response.rank = 0;
+    response.rowCount = 0;
+    response.rows = std::string_view();
+    response.through = 0;
+    response.compacted = false;
+    const char* p = data + RANK_RESPONSE_HEADER;
+    size_t payload = length + 4 - RANK_RESPONSE_HEADER;
+    if (response.status != RankStatus::Ok || response.op == RankOp::Update) {
+        return static_cast<long>(length + 4);
+    }
+    if (response.op == RankOp::GetRank) {
+        if (payload != 4) {
+            return -1;
+        }
+        response.rank = static_cast<int32_t>(getUint(p, 4));
+        return static_cast<long>(length + 4);
+    }
+    if (response.op == RankOp::Deltas) {
+        if (payload < 13) {
+            return -1;
+        }
+        response.through = getUint(p, 8);
+        response.compacted = p[8] != 0;
+        response.rowCount = static_cast<uint32_t>(getUint(p + 9, 4));
+        response.rows = std::string_view(p + 13, payload - 13);
+        return static_cast<long>(length + 4);
+    }
+    if (payload < 8) {
+        return -1;
+    }
+    response.rank = static_cast<int32_t>(getUint(p, 4));
+    response.rowCount = static_cast<uint32_t>(getUint(p + 4, 4));
+    response.rows = std::string_view(p + 8, payload - 8);
+    return static_cast<long>(length + 4);
+}
+
+bool decodeRows(const RankResponse& response, std::vector<RankInfo>& rows) {
+    rows.clear();
+    const char* p = response.rows.data();
+    const char* end = p + response.rows.size();
+    for (uint32_t i = 0; i < response.rowCount; i++) {
+        if (end - p < 18) {
+            return false;
+        }
+        RankInfo& info = rows.emplace_back();
+        info.score = static_cast<int64_t>(getUint(p, 8));
+        info.timestamp = static_cast<time_t>(getUint(p + 8, 8));
+        size_t idLength = getUint(p + 16, 2);
+        p += 18;
+        if (static_cast<size_t>(end - p) < idLength) {
+            return false;
+        }
+        info.playerId.assign(p, idLength);
+        p += idLength;
+    }
+    return p == end;
+}
+
+bool decodeDeltas(const RankResponse& response, std::vector<RankDelta>& deltas) {
+    deltas.clear();
+    const char* p = response.rows.data();
+    const char* end = p + response.rows.size();
+    for (uint32_t i = 0; i < response.rowCount; i++) {
+        if (end - p < 35) {
+            return false;
+        }
+        RankDelta& delta = deltas.emplace_back();
+        delta.sequence = getUint(p, 8);
+        delta.kind = static_cast<DeltaKind>(p[8]);
+        delta.oldScore = static_cast<int64_t>(getUint(p + 9, 8));
+        delta.newScore = static_cast<int64_t>(getUint(p + 17, 8));
+        delta.timestamp = static_cast<time_t>(getUint(p + 25, 8));
+        size_t idLength = getUint(p + 33, 2);
+        p += 35;
+        if (static_cast<size_t>(end - p) < idLength) {
+            return false;
+        }
+        delta.playerId.assign(p, idLength);
+        p += idLength;
+    }
+    return p == end;
+}
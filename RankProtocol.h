@@ -0,0 +1,100 @@
+/*
+    rank_server的二进制协议，请求和回复都是带长度的帧，整数一律小端定长。
+    请求：uint32 长度(不含这4个字节) | uint8 操作 | uint32 请求号 | 参数
+        Update   int64 分数 | int64 时间戳 | playerId
+        GetRank  playerId
+        TopN     int32 n
+        Nearby   int32 n | playerId
+        Range    int32 起始排名(从1开始) | int32 个数
+        Deltas   uint64 副本已经应用到的序号 | int32 落后多少条以内原样返回(见RankDeltaFeed::read)
+        playerId总是放在最后，长度由帧长度算出来，不单独编码；回复里id长度是uint16，超过RANK_MAX_PLAYER_ID的请求按参数错误处理。
+    回复：uint32 长度 | uint8 操作 | uint32 请求号 | uint8 状态 | 内容
+        Update   空，更新已经写进排行榜(还不一定在快照里)
+        GetRank  int32 排名，不在快照里为0
+        Deltas   uint64 读到的序号 | uint8 是否压缩过 | uint32 条数 |
+                 每条 uint64 序号 | uint8 类型 | int64 老分数 | int64 新分数 | int64 时间戳 | uint16 id长度 | playerId
+        其余     int32 第一行的排名 | uint32 行数 | 每行 int64 分数 | int64 时间戳 | uint16 id长度 | playerId
+    一个连接上可以连续发很多个请求不等回复(流水线)，回复用请求号对应：
+    读请求在收到时就回复，更新要等这一轮的批量写入之后，所以回复的顺序和请求的顺序不一定相同。
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "RankBoard.h"
+#include "RankDeltaFeed.h"
+
+enum class RankOp : uint8_t {
+    Update = 1,
+    GetRank = 2,
+    TopN = 3,
+    Nearby = 4,
+    Range = 5,
+    Deltas = 6,
+};
+
+enum class RankStatus : uint8_t {
+    Ok = 0,
+    BadRequest = 1,  // 未知操作或者参数不完整，或者服务端没有开增量流
+    Resync = 2,      // 增量流已经截断到请求的序号之后，副本要重新加载基础快照
+};
+
+const size_t RANK_FRAME_HEADER = 4 + 1 + 4;      // 长度、操作、请求号
+const size_t RANK_RESPONSE_HEADER = RANK_FRAME_HEADER + 1;
+const size_t RANK_MAX_PLAYER_ID = 0xFFFF;        // playerId最长字节数，和maxFrameBytes无关
+
+// 解出的请求，playerId指向输入缓冲区，处理完这一帧之前有效
+struct RankRequest {
+    RankOp op;
+    uint32_t id;
+    bool valid;              // 操作和参数是否完整
+    std::string_view playerId;
+    int64_t score;
+    int64_t timestamp;
+    int32_t n;               // TopN、Nearby的人数，Range的个数
+    int32_t start;           // Range的起始排名
+    uint64_t after;          // Deltas的起始序号
+};
+
+// 解出的回复头，rows指向输入缓冲区，用decodeRows展开
+struct RankResponse {
+    RankOp op;
+    uint32_t id;
+    RankStatus status;
+    int32_t rank;            // GetRank的排名，列表回复的第一行排名
+    uint32_t rowCount;
+    std::string_view rows;
+    uint64_t through;        // Deltas读到的序号
+    bool compacted;          // Deltas是否压缩过
+};
+
+// 客户端：在out后面追加一个请求
+void encodeUpdate(std::string& out, uint32_t id, std::string_view playerId, int64_t score, int64_t timestamp);
+void encodeGetRank(std::string& out, uint32_t id, std::string_view playerId);
+void encodeTopN(std::string& out, uint32_t id, int32_t n);
+void encodeNearby(std::string& out, uint32_t id, std::string_view playerId, int32_t n);
+void encodeRange(std::string& out, uint32_t id, int32_t startRank, int32_t count);
+void encodeDeltas(std::string& out, uint32_t id, uint64_t after, int32_t maxRecords);
+
+// 服务端：从data解出一个请求，返回这一帧的字节数；数据还不够一帧返回0，帧长超过maxFrame返回-1
+long decodeRequest(const char* data, size_t size, size_t maxFrame, RankRequest& request);
+
+// 服务端：回复先beginResponse，再追加内容，最后endResponse补上帧长度
+size_t beginResponse(std::string& out, RankOp op, uint32_t id, RankStatus status);
+void endResponse(std::string& out, size_t frame);
+void putRankInt32(std::string& out, int32_t v);
+// 列表回复的一行
+void putRankRow(std::string& out, int64_t score, int64_t timestamp, std::string_view playerId);
+// Deltas回复的内容
+void putRankDeltas(std::string& out, uint64_t through, bool compacted, const std::vector<RankDelta>& deltas);
+
+// 客户端：从data解出一个回复，规则同decodeRequest；内容不完整返回-1
+long decodeResponse(const char* data, size_t size, RankResponse& response);
+// 展开列表回复的各行，内容不完整返回false
+bool decodeRows(const RankResponse& response, std::vector<RankInfo>& rows);
+// 展开Deltas回复的各条增量，内容不完整返回false
+bool decodeDeltas(const RankResponse& response, std::vector<RankDelta>& deltas);
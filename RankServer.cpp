@@ -0,0 +1,470 @@
+#include "RankServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t READ_CHUNK = 64 * 1024;
+const int MAX_EVENTS = 256;
+
+uint64_t nowMs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+bool fail(std::string* error, const std::string& what) {
+    if (error) {
+        *error = what + ": " + std::strerror(errno);
+    }
+    return false;
+}
+
+}  // namespace
+
+RankServer::RankServer(const RankServerOptions& serverOptions, uint64_t seed)
+    : options(serverOptions), rankBoard(seed) {
+    if (options.deltaFeed) {
+        feed = std::make_unique<RankDeltaFeed>();
+        rankBoard.setDeltaFeed(feed.get());
+    }
+}
+
+RankServer::~RankServer() {
+    for (std::unique_ptr<Connection>& connection : connections) {
+        if (connection) {
+            ::close(connection->fd);
+        }
+    }
+    for (int fd : {tcpFd, unixFd, wakeFd, epollFd}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    if (unixFd >= 0) {
+        ::unlink(options.unixPath.c_str());
+    }
+}
+
+bool RankServer::listen(std::string* error) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        return fail(error, "epoll_create1");
+    }
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        return fail(error, "eventfd");
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+    if (options.port < 0 && options.unixPath.empty()) {
+        if (error) {
+            *error = "no tcp port or unix socket to listen on";
+        }
+        return false;
+    }
+    if (options.port >= 0 && !listenTcp(error)) {
+        return false;
+    }
+    return options.unixPath.empty() || listenUnix(error);
+}
+
+bool RankServer::listenTcp(std::string* error) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options.port));
+    if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1) {
+        if (error) {
+            *error = "bad ipv4 address: " + options.host;
+        }
+        return false;
+    }
+    tcpFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (tcpFd < 0) {
+        return fail(error, "socket");
+    }
+    int on = 1;
+    setsockopt(tcpFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (bind(tcpFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        return fail(error, "bind " + options.host + ":" + std::to_string(options.port));
+    }
+    if (::listen(tcpFd, SOMAXCONN) < 0) {
+        return fail(error, "listen");
+    }
+    socklen_t length = sizeof(address);
+    getsockname(tcpFd, reinterpret_cast<sockaddr*>(&address), &length);
+    tcpPort = ntohs(address.sin_port);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = tcpFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, tcpFd, &event);
+    return true;
+}
+
+bool RankServer::listenUnix(std::string* error) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (options.unixPath.size() >= sizeof(address.sun_path)) {
+        if (error) {
+            *error = "unix socket path too long: " + options.unixPath;
+        }
+        return false;
+    }
+    std::memcpy(address.sun_path, options.unixPath.c_str(), options.unixPath.size() + 1);
+    // 上次没有正常退出留下的socket文件
+    ::unlink(options.unixPath.c_str());
+    unixFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (unixFd < 0) {
+        return fail(error, "socket");
+    }
+    if (bind(unixFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        return fail(error, "bind " + options.unixPath);
+    }
+    if (::listen(unixFd, SOMAXCONN) < 0) {
+        return fail(error, "listen");
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = unixFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, unixFd, &event);
+    return true;
+}
+
+void RankServer::stop() {
+    if (wakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = ::write(wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+void RankServer::run() {
+    publishIfDue(true);
+    running = true;
+    epoll_event events[MAX_EVENTS];
+    while (running) {
+        int n = epoll_wait(epollFd, events, MAX_EVENTS, publishTimeout());
+        if (n < 0 && errno != EINTR) {
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            uint32_t ready = events[i].events;
+            if (fd == wakeFd) {
+                uint64_t count;
+                ssize_t got = ::read(wakeFd, &count, sizeof(count));
+                (void)got;
+                running = false;
+                continue;
+            }
+            if (fd == tcpFd || fd == unixFd) {
+                accept(fd);
+                continue;
+            }
+            Connection* connection = connections[fd].get();
+            if (connection->closing) {
+                continue;
+            }
+            if ((ready & EPOLLERR) || ((ready & EPOLLHUP) && !(ready & EPOLLIN))) {
+                closeLater(connection);
+                continue;
+            }
+            if (ready & EPOLLIN) {
+                onReadable(connection);
+            }
+            if ((ready & EPOLLOUT) && !connection->closing) {
+                markDirty(connection);
+            }
+        }
+        applyBatch();
+        publishIfDue(false);
+        // 写出时可能恢复读，解析出的新回复追加到列表后面，同一轮里接着写
+        for (size_t i = 0; i < dirtyConnections.size(); i++) {
+            Connection* connection = dirtyConnections[i];
+            connection->dirty = false;
+            if (!connection->closing) {
+                flush(connection);
+            }
+        }
+        dirtyConnections.clear();
+        closeConnections();
+    }
+}
+
+int RankServer::publishTimeout() const {
+    // 暂停读的连接恢复时解析出的更新要在下一轮写进去，不能等
+    if (!batch.empty()) {
+        return 0;
+    }
+    if (!dirtyBoard) {
+        return -1;
+    }
+    uint64_t now = nowMs();
+    return nextPublishMs > now ? static_cast<int>(nextPublishMs - now) : 0;
+}
+
+void RankServer::accept(int listenFd) {
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // EAGAIN是接受完了；连接数超限等错误也先停下，下一轮再试
+            return;
+        }
+        if (listenFd == tcpFd) {
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        if (static_cast<size_t>(fd) >= connections.size()) {
+            connections.resize(fd + 1);
+        }
+        connections[fd] = std::make_unique<Connection>();
+        Connection* connection = connections[fd].get();
+        connection->fd = fd;
+        connection->events = EPOLLIN;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        counters.connections++;
+    }
+}
+
+void RankServer::onReadable(Connection* connection) {
+    while (!connection->closing && !paused(connection)) {
+        size_t used = connection->in.size();
+        connection->in.resize(used + READ_CHUNK);
+        ssize_t got = ::recv(connection->fd, &connection->in[used], READ_CHUNK, 0);
+        connection->in.resize(used + std::max<ssize_t>(got, 0));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            if (got == 0 || errno != EAGAIN) {
+                closeLater(connection);
+            }
+            break;
+        }
+        processInput(connection);
+        // 没读满说明已经读空了，还有数据的话水平触发会再通知
+        if (static_cast<size_t>(got) < READ_CHUNK) {
+            break;
+        }
+    }
+}
+
+void RankServer::processInput(Connection* connection) {
+    std::string& in = connection->in;
+    while (!connection->closing && !paused(connection)) {
+        RankRequest request;
+        long consumed = decodeRequest(in.data() + connection->inPos, in.size() - connection->inPos,
+                                      options.maxFrameBytes, request);
+        if (consumed == 0) {
+            break;
+        }
+        if (consumed < 0) {
+            closeLater(connection);
+            return;
+        }
+        connection->inPos += static_cast<size_t>(consumed);
+        handleRequest(connection, request);
+    }
+    // 解析完的前缀超过一半时才搬移，剩下的多半是半个帧
+    if (connection->inPos == in.size()) {
+        in.clear();
+        connection->inPos = 0;
+    } else if (connection->inPos > in.size() / 2) {
+        in.erase(0, connection->inPos);
+        connection->inPos = 0;
+    }
+    updateEvents(connection);
+}
+
+void RankServer::handleRequest(Connection* connection, const RankRequest& request) {
+    counters.requests++;
+    std::string& out = connection->out;
+    if (!request.valid || (request.op == RankOp::Deltas && !feed)) {
+        counters.badRequests++;
+        endResponse(out, beginResponse(out, request.op, request.id, RankStatus::BadRequest));
+        markDirty(connection);
+        return;
+    }
+    if (request.op == RankOp::Update) {
+        batch.push_back(ScoreUpdate{std::string(request.playerId), request.score, static_cast<time_t>(request.timestamp)});
+        acks.push_back(PendingAck{connection, request.id});
+        counters.updates++;
+        return;
+    }
+    if (request.op == RankOp::Deltas) {
+        uint64_t through = 0;
+        bool compacted = false;
+        bool ok = feed->read(request.after, static_cast<size_t>(std::max(0, request.n)), deltas, through, &compacted);
+        size_t frame = beginResponse(out, request.op, request.id, ok ? RankStatus::Ok : RankStatus::Resync);
+        if (ok) {
+            putRankDeltas(out, through, compacted, deltas);
+        }
+        endResponse(out, frame);
+        markDirty(connection);
+        return;
+    }
+    size_t frame = beginResponse(out, request.op, request.id, RankStatus::Ok);
+    int n = std::min(request.n, options.maxRows);
+    switch (request.op) {
+    case RankOp::GetRank:
+        putRankInt32(out, snapshot->getRank(request.playerId));
+        break;
+    case RankOp::TopN:
+        writeRows(out, 1, n);
+        break;
+    case RankOp::Nearby: {
+        // 规则同RankSnapshot::getNearbyPlayers
+        int rank = snapshot->getRank(request.playerId);
+        writeRows(out, rank > 0 ? std::max(1, rank - n / 2) : 1, rank > 0 ? n : 0);
+        break;
+    }
+    case RankOp::Range:
+        writeRows(out, std::max(1, request.start), n);
+        break;
+    default:
+        break;
+    }
+    endResponse(out, frame);
+    markDirty(connection);
+}
+
+void RankServer::writeRows(std::string& out, int first, int count) {
+    // 起始排名来自客户端，按64位算，不会溢出
+    int last = count > 0 ? static_cast<int>(std::min<int64_t>(snapshot->size(), int64_t(first) + count - 1)) : 0;
+    int rows = std::max(0, last - first + 1);
+    putRankInt32(out, first);
+    putRankInt32(out, rows);
+    for (int rank = first; rank <= last; rank++) {
+        const RankSnapshot::Entry& entry = snapshot->at(rank);
+        putRankRow(out, entry.score, entry.timestamp, snapshot->playerId(entry));
+    }
+}
+
+void RankServer::applyBatch() {
+    if (batch.empty()) {
+        return;
+    }
+    rankBoard.updateScores(batch);
+    counters.batches++;
+    counters.maxBatch = std::max<uint64_t>(counters.maxBatch, batch.size());
+    dirtyBoard = true;
+    for (const PendingAck& ack : acks) {
+        if (!ack.connection->closing) {
+            std::string& out = ack.connection->out;
+            endResponse(out, beginResponse(out, RankOp::Update, ack.id, RankStatus::Ok));
+            markDirty(ack.connection);
+        }
+    }
+    batch.clear();
+    acks.clear();
+}
+
+void RankServer::publishIfDue(bool force) {
+    uint64_t now = nowMs();
+    if (!force && (!dirtyBoard || now < nextPublishMs)) {
+        return;
+    }
+    auto begin = std::chrono::steady_clock::now();
+    snapshots.publish(rankBoard.snapshot());
+    snapshots.refresh(snapshot);
+    counters.lastSnapshotMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    counters.snapshots++;
+    dirtyBoard = false;
+    // 生成快照的时间不超过事件循环的十分之一，玩家很多时自动拉长间隔
+    uint64_t interval = std::max<uint64_t>(options.publishIntervalMs, static_cast<uint64_t>(counters.lastSnapshotMs * 9));
+    nextPublishMs = nowMs() + interval;
+}
+
+void RankServer::flush(Connection* connection) {
+    std::string& out = connection->out;
+    while (connection->outPos < out.size()) {
+        ssize_t sent = ::send(connection->fd, out.data() + connection->outPos, out.size() - connection->outPos, MSG_NOSIGNAL);
+        if (sent > 0) {
+            connection->outPos += static_cast<size_t>(sent);
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (errno != EAGAIN) {
+                closeLater(connection);
+                return;
+            }
+            break;
+        }
+    }
+    if (connection->outPos == out.size()) {
+        out.clear();
+        connection->outPos = 0;
+    } else if (connection->outPos > out.size() / 2) {
+        out.erase(0, connection->outPos);
+        connection->outPos = 0;
+    }
+    // 积压写出去之后接着解析暂停时留在缓冲区里的请求
+    if (!paused(connection) && connection->inPos < connection->in.size()) {
+        processInput(connection);
+    } else {
+        updateEvents(connection);
+    }
+}
+
+void RankServer::markDirty(Connection* connection) {
+    if (!connection->dirty) {
+        connection->dirty = true;
+        dirtyConnections.push_back(connection);
+    }
+}
+
+void RankServer::updateEvents(Connection* connection) {
+    uint32_t wanted = 0;
+    if (!paused(connection)) {
+        wanted |= EPOLLIN;
+    }
+    if (connection->outPos < connection->out.size()) {
+        wanted |= EPOLLOUT;
+    }
+    if (wanted != connection->events && !connection->closing) {
+        epoll_event event{};
+        event.events = wanted;
+        event.data.fd = connection->fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+        connection->events = wanted;
+    }
+}
+
+void RankServer::closeLater(Connection* connection) {
+    if (!connection->closing) {
+        connection->closing = true;
+        closingFds.push_back(connection->fd);
+    }
+}
+
+// 暂停读的连接在flush里恢复解析时，更新可能排进了下一轮的批量写入；更新照常写入，
+// 确认要在连接释放之前去掉，否则下一轮的applyBatch会拿着已经释放的指针
+void RankServer::closeConnections() {
+    if (closingFds.empty()) {
+        return;
+    }
+    acks.erase(std::remove_if(acks.begin(), acks.end(), [](const PendingAck& ack) { return ack.connection->closing; }),
+               acks.end());
+    for (int fd : closingFds) {
+        // close会把fd从epoll里去掉
+        ::close(fd);
+        connections[fd].reset();
+    }
+    closingFds.clear();
+}
@@ -0,0 +1,141 @@
+/*
+    rank_server：README里读写分离方案的单机实现，一个进程独占一个RankBoard，通过RankProtocol.h的二进制协议对外提供
+    updateScore、getRank、前N名、前后N名和按排名翻页，监听TCP端口和(或)Unix socket。
+    一个线程跑epoll事件循环，非阻塞socket，水平触发。每一轮：
+        把所有可读连接上的数据读完，逐帧解析，一个连接可以流水线地连续发请求；
+        读请求当场用最新发布的快照(RankSnapshot)回答，快照是连续数组，不碰跳表；
+        更新先攒起来，这一轮的事件处理完后用一次updateScores批量写进排行榜，再给这些更新回复确认；
+        距上次发布超过publishIntervalMs且有过更新时，生成新快照通过RankSnapshotPublisher发布；
+        最后把每个连接攒下的回复一次写出去，写不完的等EPOLLOUT。
+    生成快照是O(n)，期间事件循环停顿，百万玩家大约几十毫秒；两次发布的间隔至少是生成耗时的9倍，
+    停顿不超过事件循环时间的十分之一，代价是玩家多时读到的数据更旧。
+    刚确认的更新在下一个快照之前查不到。
+    某个连接的回复积压超过maxPendingBytes时暂停读它，写出去之后再继续，慢客户端不会让内存无限增长。
+    开了增量流(deltaFeed)时排行榜的每次更新都记进RankDeltaFeed，副本用Deltas请求拉取序号之后的增量，
+    从序号0开始拉就能得到整个排行榜(每个玩家压缩成一条)，不用传切片。
+    只支持Linux(epoll)。
+*/
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "RankBoard.h"
+#include "RankDeltaFeed.h"
+#include "RankProtocol.h"
+#include "RankSnapshot.h"
+
+struct RankServerOptions {
+    std::string host = "127.0.0.1";
+    int port = 7070;                 // 小于0为不监听TCP，0由系统分配
+    std::string unixPath;            // 非空时监听这个Unix socket
+    int publishIntervalMs = 50;      // 有更新时两次发布快照的最短间隔
+    int maxRows = 1000;              // 列表查询一次最多返回的行数
+    size_t maxFrameBytes = 1 << 16;  // 请求帧的最大长度，超过就断开连接；调大后playerId仍然最长RANK_MAX_PLAYER_ID字节
+    size_t maxPendingBytes = 4 << 20;
+    bool deltaFeed = true;           // 给副本记增量流
+};
+
+struct RankServerStats {
+    uint64_t connections;   // 累计接受的连接数
+    uint64_t requests;      // 累计处理的请求数
+    uint64_t badRequests;
+    uint64_t updates;       // 其中的更新
+    uint64_t batches;       // 批量写入的次数
+    uint64_t maxBatch;      // 最大的一批有多少条更新
+    uint64_t snapshots;     // 发布的快照数
+    double lastSnapshotMs;  // 最近一次生成快照的耗时
+};
+
+class RankServer {
+public:
+    explicit RankServer(const RankServerOptions& options, uint64_t seed = std::random_device{}());
+    ~RankServer();
+    RankServer(const RankServer&) = delete;
+    RankServer& operator=(const RankServer&) = delete;
+
+    // 创建监听socket，失败返回false并填写error
+    bool listen(std::string* error = nullptr);
+    // 运行事件循环，直到stop
+    void run();
+    // 让run返回，任何线程和信号处理函数里都可以调用
+    void stop();
+    // run之前可以直接操作排行榜，比如从转储文件加载
+    RankBoard& board() { return rankBoard; }
+    // 当前发布的快照，其他线程也可以读
+    const RankSnapshotPublisher& publisher() const { return snapshots; }
+    // 在run的线程里或者run返回之后读
+    RankServerStats stats() const { return counters; }
+    // TCP实际监听的端口
+    int boundPort() const { return tcpPort; }
+    // 没开增量流时为nullptr
+    const RankDeltaFeed* deltaFeed() const { return feed.get(); }
+
+private:
+    struct Connection {
+        int fd;
+        std::string in;          // 收到还没解析的数据从inPos开始
+        size_t inPos = 0;
+        std::string out;         // 待发送的回复从outPos开始
+        size_t outPos = 0;
+        uint32_t events = 0;     // 当前注册的epoll事件
+        bool closing = false;    // 已经在待关闭的列表里，这一轮结束时关闭
+        bool dirty = false;      // 已经在待写出的列表里
+    };
+    // 等这一轮批量写入后再确认的更新，连接关闭时由closeConnections去掉
+    struct PendingAck {
+        Connection* connection;
+        uint32_t id;
+    };
+
+    RankServerOptions options;
+    std::unique_ptr<RankDeltaFeed> feed;  // 先于rankBoard构造，后于它析构
+    RankBoard rankBoard;
+    RankSnapshotPublisher snapshots;
+    std::shared_ptr<const RankSnapshot> snapshot;  // 事件循环用的快照
+    int epollFd = -1;
+    int wakeFd = -1;                               // eventfd，stop用来唤醒epoll_wait
+    int tcpFd = -1;
+    int unixFd = -1;
+    int tcpPort = 0;
+    std::vector<std::unique_ptr<Connection>> connections;  // 按fd
+    std::vector<Connection*> dirtyConnections;
+    std::vector<int> closingFds;
+    bool running = false;
+    std::vector<ScoreUpdate> batch;
+    std::vector<PendingAck> acks;
+    std::vector<RankDelta> deltas;                 // Deltas请求的读取缓冲
+    bool dirtyBoard = false;                       // 上次发布之后有过更新
+    uint64_t nextPublishMs = 0;                    // 有更新时到这个时间发布
+    RankServerStats counters{};
+
+    bool listenTcp(std::string* error);
+    bool listenUnix(std::string* error);
+    void accept(int listenFd);
+    // 读完socket里的数据再解析
+    void onReadable(Connection* connection);
+    // 解析缓冲区里完整的帧
+    void processInput(Connection* connection);
+    void handleRequest(Connection* connection, const RankRequest& request);
+    // 快照里排名从first开始的count行
+    void writeRows(std::string& out, int first, int count);
+    // 这一轮的更新写进排行榜并回复确认
+    void applyBatch();
+    void publishIfDue(bool force);
+    void flush(Connection* connection);
+    void markDirty(Connection* connection);
+    // 按是否暂停读、是否有待写数据重新注册epoll事件
+    void updateEvents(Connection* connection);
+    // 标记关闭，这一轮结束时由closeConnections关闭，这之前指针仍然有效
+    void closeLater(Connection* connection);
+    void closeConnections();
+    // 回复积压太多，暂停读
+    bool paused(const Connection* connection) const {
+        return connection->out.size() - connection->outPos >= options.maxPendingBytes;
+    }
+    // 距下次发布快照还有多少毫秒，epoll_wait的超时
+    int publishTimeout() const;
+};
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "RankServer.h"
+
+namespace {
+
+RankServer* runningServer = nullptr;
+
+void onSignal(int) {
+    if (runningServer) {
+        runningServer->stop();
+    }
+}
+
+void usage() {
+    std::cerr << "usage: rank_server [--host 127.0.0.1] [--port 7070] [--unix path] [--publish-ms 50] [--max-rows 1000] [--load dump]"
+                 " [--delta-feed 1]"
+              << std::endl;
+}
+
+}  // namespace
+
+// ./rank_server --port 7070 --unix /tmp/rank.sock --load rank.dump
+int main(int argc, char* argv[]) {
+    RankServerOptions options;
+    std::string dumpPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--host") {
+            options.host = value;
+        } else if (arg == "--port") {
+            options.port = std::atoi(value);
+        } else if (arg == "--unix") {
+            options.unixPath = value;
+        } else if (arg == "--publish-ms") {
+            options.publishIntervalMs = std::max(1, std::atoi(value));
+        } else if (arg == "--max-rows") {
+            options.maxRows = std::max(1, std::atoi(value));
+        } else if (arg == "--delta-feed") {
+            options.deltaFeed = std::atoi(value) != 0;
+        } else if (arg == "--load") {
+            dumpPath = value;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    RankServer server(options);
+    std::string error;
+    if (!dumpPath.empty() && !server.board().load(dumpPath, nullptr, &error)) {
+        std::cerr << "load " << dumpPath << " failed: " << error << std::endl;
+        return 1;
+    }
+    if (!server.listen(&error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    runningServer = &server;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::cout << "rank_server " << server.board().memoryStats().players << " players";
+    if (options.port >= 0) {
+        std::cout << ", tcp " << options.host << ":" << server.boundPort();
+    }
+    if (!options.unixPath.empty()) {
+        std::cout << ", unix " << options.unixPath;
+    }
+    std::cout << std::endl;
+
+    server.run();
+
+    RankServerStats stats = server.stats();
+    std::cout << "connections " << stats.connections << ", requests " << stats.requests
+              << " (bad " << stats.badRequests << "), updates " << stats.updates
+              << " in " << stats.batches << " batches (max " << stats.maxBatch << "), snapshots " << stats.snapshots
+              << " (last " << stats.lastSnapshotMs << " ms)" << std::endl;
+    if (const RankDeltaFeed* feed = server.deltaFeed()) {
+        DeltaFeedStats feedStats = feed->stats();
+        std::cout << "delta feed: sequence " << feedStats.lastSequence << ", " << feedStats.records << " records ("
+                  << feedStats.bytes / (1 << 20) << " MB) after " << feedStats.compactions << " compactions, "
+                  << feedStats.compactedReads << " compacted reads" << std::endl;
+    }
+    runningServer = nullptr;
+    return 0;
+}
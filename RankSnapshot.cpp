@@ -0,0 +1,75 @@
+#include "RankSnapshot.h"
+
+RankSnapshot::RankSnapshot(std::shared_ptr<const PlayerTable> players, uint64_t sequence, size_t count)
+    : players(std::move(players)), seq(sequence) {
+    entries.reserve(count);
+    rankOf.assign(this->players->size(), 0);
+}
+
+void RankSnapshot::append(int64_t score, time_t timestamp, PlayerHandle player) {
+    entries.push_back(Entry{score, timestamp, player});
+    rankOf[player] = static_cast<int>(entries.size());
+}
+
+void RankSnapshot::fillRankInfo(RankInfo& info, const Entry& entry) const {
+    info.playerId = players->name(entry.player);
+    info.score = entry.score;
+    info.timestamp = entry.timestamp;
+}
+
+int RankSnapshot::getRank(std::string_view playerId) const {
+    PlayerHandle player = players->lookup(playerId);
+    // 快照生成之后才加入的玩家不在rankOf里
+    if (player == PlayerTable::INVALID || player >= rankOf.size()) {
+        return 0;
+    }
+    return rankOf[player];
+}
+
+std::vector<RankInfo> RankSnapshot::getTopNPlayers(int n) const {
+    std::vector<RankInfo> topNPlayers;
+    if (n < 1) {
+        return topNPlayers;
+    }
+    int count = std::min(n, size());
+    topNPlayers.resize(count);
+    for (int i = 0; i < count; i++) {
+        fillRankInfo(topNPlayers[i], entries[i]);
+    }
+    return topNPlayers;
+}
+
+std::vector<RankInfo> RankSnapshot::getNearbyPlayers(const std::string& playerId, int n) const {
+    std::vector<RankInfo> nearbyPlayers;
+    int rank = getRank(playerId);
+    if (n < 1 || rank == 0) {
+        return nearbyPlayers;
+    }
+    int start = std::max(0, rank - 1 - n / 2);
+    int end = std::min(size(), start + n);
+    nearbyPlayers.resize(end - start);
+    for (int i = start; i < end; i++) {
+        fillRankInfo(nearbyPlayers[i - start], entries[i]);
+    }
+    return nearbyPlayers;
+}
+
+size_t RankSnapshot::memoryBytes() const {
+    return entries.capacity() * sizeof(Entry) + rankOf.capacity() * sizeof(int);
+}
+
+void RankSnapshotPublisher::publish(std::shared_ptr<const RankSnapshot> snapshot) {
+    uint64_t next = snapshot ? snapshot->sequence() : 0;
+    std::atomic_store_explicit(&latest, std::move(snapshot), std::memory_order_release);
+    sequence.store(next, std::memory_order_release);
+}
+
+std::shared_ptr<const RankSnapshot> RankSnapshotPublisher::current() const {
+    return std::atomic_load_explicit(&latest, std::memory_order_acquire);
+}
+
+void RankSnapshotPublisher::refresh(std::shared_ptr<const RankSnapshot>& cached) const {
+    if (!cached || cached->sequence() != sequence.load(std::memory_order_acquire)) {
+        cached = current();
+    }
+}
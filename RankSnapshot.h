@@ -0,0 +1,69 @@
+/*
+    排行榜的只读快照，给README里说的rank_server用：写线程定时生成快照，所有读请求都由快照回答。
+    快照是按排名排好的连续数组，外加玩家句柄到排名的数组：
+    查排名是一次哈希查找加一次数组下标，前N名和前后N名是连续的数组读取，没有指针跳转。
+    快照生成后不再修改，任意多个线程可以同时读。playerid直接引用排行榜的PlayerTable，快照持有它的shared_ptr。
+    RankSnapshotPublisher用shared_ptr原子地发布新快照，读线程拿到的快照在用完之前不会被释放。
+*/
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "RankBoard.h"
+
+class RankSnapshot {
+public:
+    // 快照里的一行，按排名顺序存放
+    struct Entry {
+        int64_t score;
+        time_t timestamp;
+        PlayerHandle player;
+    };
+
+    // count为预计的行数
+    RankSnapshot(std::shared_ptr<const PlayerTable> players, uint64_t sequence, size_t count);
+    RankSnapshot(const RankSnapshot&) = delete;
+    RankSnapshot& operator=(const RankSnapshot&) = delete;
+
+    // 生成快照时按排名顺序追加，只在发布之前调用
+    void append(int64_t score, time_t timestamp, PlayerHandle player);
+
+    // 查询玩家排名，从1开始，不在快照里返回0
+    int getRank(std::string_view playerId) const;
+    // 获取前N名玩家的分数和名次
+    std::vector<RankInfo> getTopNPlayers(int n) const;
+    // 查询自己名次前后共N名玩家，规则同RankBoard::getNearbyPlayers
+    std::vector<RankInfo> getNearbyPlayers(const std::string& playerId, int n) const;
+    // 按排名取一行，从1开始
+    const Entry& at(int rank) const { return entries[rank - 1]; }
+    std::string_view playerId(const Entry& entry) const { return players->name(entry.player); }
+    int size() const { return static_cast<int>(entries.size()); }
+    // 排行榜上第几个快照，越新越大
+    uint64_t sequence() const { return seq; }
+    size_t memoryBytes() const;
+
+private:
+    std::shared_ptr<const PlayerTable> players;
+    uint64_t seq;
+    std::vector<Entry> entries;  // 按排名排好
+    std::vector<int> rankOf;     // 句柄 -> 排名，0为不在快照里
+
+    void fillRankInfo(RankInfo& info, const Entry& entry) const;
+};
+
+// 发布快照：写线程publish，读线程current拿到当前快照
+class RankSnapshotPublisher {
+public:
+    void publish(std::shared_ptr<const RankSnapshot> snapshot);
+    std::shared_ptr<const RankSnapshot> current() const;
+    // 读线程缓存着一份快照，有更新时才重新加载，没有更新时只读一个原子变量
+    void refresh(std::shared_ptr<const RankSnapshot>& cached) const;
+
+private:
+    std::shared_ptr<const RankSnapshot> latest;  // 用std::atomic_load/atomic_store访问
+    std::atomic<uint64_t> sequence{0};           // latest的序号
+};
@@ -0,0 +1,82 @@
+/*
+    分段数组，按下标访问，只能增长。
+    第k段有 FIRST << k 个元素，段一旦分配地址就不再变化，扩容只追加新段，不搬移已有元素。
+    写线程扩容的同时，读线程可以按下标访问已经存在的元素（元素本身的并发访问由元素类型负责）。
+*/
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+template <class T>
+class SegmentedArray {
+public:
+    SegmentedArray() {
+        for (size_t k = 0; k < SEGMENTS; k++) {
+            segments[k].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+    ~SegmentedArray() { reset(); }
+    SegmentedArray(const SegmentedArray&) = delete;
+    SegmentedArray& operator=(const SegmentedArray&) = delete;
+
+    T& operator[](size_t i) const {
+        size_t j = i + FIRST;
+        size_t k = highestBit(j) - FIRST_BITS;
+        return segments[k].load(std::memory_order_acquire)[j - (FIRST << k)];
+    }
+    // 保证下标[0, n)可以访问，新元素值初始化，只能由写线程调用
+    void reserve(size_t n) {
+        size_t cap = elements.load(std::memory_order_relaxed);
+        for (size_t k = 0; cap < n && k < SEGMENTS; k++) {
+            if (segments[k].load(std::memory_order_relaxed)) {
+                continue;
+            }
+            segments[k].store(new T[FIRST << k](), std::memory_order_release);
+            cap += FIRST << k;
+        }
+        elements.store(cap, std::memory_order_release);
+    }
+    // 可以访问的元素个数
+    size_t capacity() const { return elements.load(std::memory_order_acquire); }
+    size_t memoryBytes() const { return elements.load(std::memory_order_relaxed) * sizeof(T) + sizeof(segments); }
+    // 释放所有段，调用时不能有读线程
+    void reset() {
+        for (size_t k = 0; k < SEGMENTS; k++) {
+            delete[] segments[k].load(std::memory_order_relaxed);
+            segments[k].store(nullptr, std::memory_order_relaxed);
+        }
+        elements.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t FIRST_BITS = 10;
+    static constexpr size_t FIRST = size_t(1) << FIRST_BITS;
+    static constexpr size_t SEGMENTS = 24;  // 可容纳约 2^34 个元素，覆盖32位句柄
+
+    // 按64位算，32位的size_t也一样；32位MSVC没有_BitScanReverse64，分高低两半找
+    static size_t highestBit(uint64_t v) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        unsigned long index;
+        _BitScanReverse64(&index, v);
+        return index;
+#elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanReverse(&index, static_cast<unsigned long>(v >> 32))) {
+            return index + 32;
+        }
+        _BitScanReverse(&index, static_cast<unsigned long>(v));
+        return index;
+#else
+        return 63 - __builtin_clzll(v);
+#endif
+    }
+
+    std::atomic<T*> segments[SEGMENTS];
+    std::atomic<size_t> elements{0};
+};
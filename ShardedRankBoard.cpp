@@ -0,0 +1,137 @@
+#include "ShardedRankBoard.h"
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string_view>
+
+namespace {
+
+// 和RankBoard相同的排序规则
+bool rankInfoBefore(const RankInfo& a, const RankInfo& b) {
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    if (a.timestamp != b.timestamp) {
+        return a.timestamp < b.timestamp;
+    }
+    return a.playerId < b.playerId;
+}
+
+// 堆做k路归并，每个列表都已排好序，最多取limit个
+std::vector<RankInfo> mergeSorted(std::vector<std::vector<RankInfo>>& lists, size_t limit) {
+    struct Cursor {
+        size_t list;
+        size_t pos;
+    };
+    auto after = [&lists](const Cursor& a, const Cursor& b) {
+        return rankInfoBefore(lists[b.list][b.pos], lists[a.list][a.pos]);
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(after)> heap(after);
+    for (size_t i = 0; i < lists.size(); i++) {
+        if (!lists[i].empty()) {
+            heap.push(Cursor{i, 0});
+        }
+    }
+    std::vector<RankInfo> merged;
+    while (!heap.empty() && merged.size() < limit) {
+        Cursor c = heap.top();
+        heap.pop();
+        merged.push_back(std::move(lists[c.list][c.pos]));
+        if (c.pos + 1 < lists[c.list].size()) {
+            heap.push(Cursor{c.list, c.pos + 1});
+        }
+    }
+    return merged;
+}
+
+}  // namespace
+
+ShardedRankBoard::ShardedRankBoard(int shardCount, uint64_t seed) {
+    for (int i = 0; i < std::max(1, shardCount); i++) {
+        shards.emplace_back(new Shard(seed + i * 0x9E3779B97F4A7C15ULL));
+    }
+}
+
+// 分片内的PlayerTable用哈希值的低位找槽，这里再混合一次，避免同一分片的玩家挤在一起
+int ShardedRankBoard::shardOf(const std::string& playerId) const {
+    uint64_t h = std::hash<std::string_view>()(playerId);
+    h = (h ^ (h >> 33)) * 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return static_cast<int>(h % shards.size());
+}
+
+void ShardedRankBoard::updateScore(const std::string& playerId, int64_t newScore, time_t timestamp) {
+    Shard& shard = *shards[shardOf(playerId)];
+    std::lock_guard<std::mutex> guard(shard.writeLock);
+    shard.board.updateScore(playerId, newScore, timestamp);
+}
+
+void ShardedRankBoard::updateScores(const std::vector<ScoreUpdate>& updates) {
+    std::vector<std::vector<ScoreUpdate>> groups(shards.size());
+    for (const ScoreUpdate& u : updates) {
+        groups[shardOf(u.playerId)].push_back(u);
+    }
+    for (size_t i = 0; i < shards.size(); i++) {
+        if (groups[i].empty()) {
+            continue;
+        }
+        std::lock_guard<std::mutex> guard(shards[i]->writeLock);
+        shards[i]->board.updateScores(groups[i]);
+    }
+}
+
+int ShardedRankBoard::getRank(const std::string& playerId) {
+    RankInfo info;
+    if (!shards[shardOf(playerId)]->board.getPlayer(playerId, info)) {
+        return 0;
+    }
+    int ahead = 0;
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        ahead += shard->board.countAhead(info.score, info.timestamp, playerId);
+    }
+    return ahead + 1;
+}
+
+std::vector<RankInfo> ShardedRankBoard::getTopNPlayers(int n) {
+    if (n < 1) {
+        return std::vector<RankInfo>();
+    }
+    std::vector<std::vector<RankInfo>> lists;
+    lists.reserve(shards.size());
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        lists.push_back(shard->board.getTopNPlayers(n));
+    }
+    return mergeSorted(lists, n);
+}
+
+// 全局排在自己前面的n/2名一定在各分片自己前面的n/2名里，后面的同理，归并后再定位自己
+std::vector<RankInfo> ShardedRankBoard::getNearbyPlayers(const std::string& playerId, int n) {
+    std::vector<RankInfo> nearbyPlayers;
+    RankInfo info;
+    if (n < 1 || !shards[shardOf(playerId)]->board.getPlayer(playerId, info)) {
+        return nearbyPlayers;
+    }
+    std::vector<std::vector<RankInfo>> lists;
+    lists.reserve(shards.size());
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        lists.push_back(shard->board.getPlayersAround(info.score, info.timestamp, playerId, n / 2, n));
+    }
+    std::vector<RankInfo> merged = mergeSorted(lists, SIZE_MAX);
+    size_t pos = 0;
+    while (pos < merged.size() && rankInfoBefore(merged[pos], info)) {
+        pos++;
+    }
+    size_t start = pos > size_t(n / 2) ? pos - n / 2 : 0;
+    for (size_t i = start; i < merged.size() && nearbyPlayers.size() < size_t(n); i++) {
+        nearbyPlayers.push_back(std::move(merged[i]));
+    }
+    return nearbyPlayers;
+}
+
+void ShardedRankBoard::clear() {
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->writeLock);
+        shard->board.clear();
+    }
+}
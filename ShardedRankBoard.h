@@ -0,0 +1,48 @@
+/*
+    分片排行榜：按playerId的哈希把玩家分到S个独立的RankBoard上，写入分散到多个分片，可以多个线程同时写不同的分片。
+    每个分片一把锁，只用来串行化同一分片的写线程；分片开启了并发读，查询不加锁。
+    前N名：每个分片取自己的前N名，用堆做k路归并。
+    排名：用玩家的 (score, timestamp, playerId) 去每个分片数排在前面的玩家数(O(logn))，加起来再加1。
+    前后N名：每个分片取这个键前面n/2个、后面n个玩家，归并后在结果里定位自己再截取。
+    排序规则和单个RankBoard完全一致：分数高的在前，同分时间戳小的在前，再按playerId。
+    分片之间不是同一时刻的快照，有并发写入时跨分片的结果可能只是近似值，停写后是精确的。
+*/
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "RankBoard.h"
+
+class ShardedRankBoard {
+public:
+    explicit ShardedRankBoard(int shardCount, uint64_t seed = std::random_device{}());
+    ShardedRankBoard(const ShardedRankBoard&) = delete;
+    ShardedRankBoard& operator=(const ShardedRankBoard&) = delete;
+
+    // 更新玩家积分，可以多个线程同时调用
+    void updateScore(const std::string& playerId, int64_t newScore, time_t timestamp);
+    // 批量更新，按分片分组后每个分片调用一次updateScores
+    void updateScores(const std::vector<ScoreUpdate>& updates);
+    // 查询玩家当前排名，从1开始，不存在返回0
+    int getRank(const std::string& playerId);
+    // 获取前N名玩家
+    std::vector<RankInfo> getTopNPlayers(int n);
+    // 查询自己名次前后共N名玩家，规则同RankBoard::getNearbyPlayers
+    std::vector<RankInfo> getNearbyPlayers(const std::string& playerId, int n);
+    // 清空所有分片
+    void clear();
+    // 玩家所在的分片
+    int shardOf(const std::string& playerId) const;
+    int shardCount() const { return static_cast<int>(shards.size()); }
+
+private:
+    struct Shard {
+        std::mutex writeLock;  // 同一分片的写线程互斥，读不加锁
+        RankBoard board;
+        explicit Shard(uint64_t seed) : board(seed, true) {}
+    };
+    std::vector<std::unique_ptr<Shard>> shards;
+};
@@ -0,0 +1,71 @@
+#include "SlabAllocator.h"
+
+#include <algorithm>
+#include <new>
+
+SlabAllocator::SlabAllocator(size_t slabBytes) : slabBytes(slabBytes) {
+    for (size_t i = 0; i <= MAX_SMALL / ALIGN; i++) {
+        freeLists[i] = nullptr;
+    }
+}
+
+SlabAllocator::~SlabAllocator() {
+    release();
+}
+
+void* SlabAllocator::allocate(size_t size) {
+    size = (size + ALIGN - 1) & ~(ALIGN - 1);
+    if (size > MAX_SMALL) {
+        largeBytes += size;
+        inUseBytes += size;
+        return ::operator new(size);
+    }
+    inUseBytes += size;
+    // 先复用同一级的空闲块
+    FreeBlock*& freeList = freeLists[size / ALIGN];
+    if (freeList) {
+        FreeBlock* block = freeList;
+        freeList = block->next;
+        return block;
+    }
+    // 当前slab不够了就申请新的，剩下的尾巴直接丢弃
+    if (cursor == nullptr || static_cast<size_t>(limit - cursor) < size) {
+        size_t bytes = nextSlab;
+        nextSlab = std::min(nextSlab * 2, std::max(slabBytes, size_t(MAX_SMALL)));
+        cursor = static_cast<char*>(::operator new(bytes));
+        limit = cursor + bytes;
+        slabTotal += bytes;
+        slabs.push_back(cursor);
+    }
+    void* p = cursor;
+    cursor += size;
+    return p;
+}
+
+void SlabAllocator::deallocate(void* p, size_t size) {
+    size = (size + ALIGN - 1) & ~(ALIGN - 1);
+    inUseBytes -= size;
+    if (size > MAX_SMALL) {
+        largeBytes -= size;
+        ::operator delete(p);
+        return;
+    }
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    block->next = freeLists[size / ALIGN];
+    freeLists[size / ALIGN] = block;
+}
+
+void SlabAllocator::release() {
+    for (char* slab : slabs) {
+        ::operator delete(slab);
+    }
+    slabs.clear();
+    for (size_t i = 0; i <= MAX_SMALL / ALIGN; i++) {
+        freeLists[i] = nullptr;
+    }
+    cursor = nullptr;
+    limit = nullptr;
+    nextSlab = MAX_SMALL;
+    slabTotal = 0;
+    inUseBytes = largeBytes;
+}
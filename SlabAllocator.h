@@ -0,0 +1,69 @@
+/*
+    按大小分级的slab分配器，每个排行榜独占一个，不加锁。
+    小块内存按8字节对齐分级，每级一个空闲链表，释放的块挂回空闲链表复用；
+    空闲链表为空时从当前slab顺序切一块，slab用完再向系统申请新的slab。
+    slab从MAX_SMALL大小开始每次翻倍，直到slabBytes，只有几十个节点的小排行榜不会先占掉一整个大slab。
+    超过MAX_SMALL的大块直接走operator new。
+    release()把所有slab一次性还给系统，销毁或清空排行榜时不需要逐个释放节点。
+*/
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class SlabAllocator {
+public:
+    explicit SlabAllocator(size_t slabBytes = 64 * 1024);
+    ~SlabAllocator();
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    void* allocate(size_t size);
+    // size必须和allocate时一致
+    void deallocate(void* p, size_t size);
+    // 释放全部slab，之前分配出去的小块全部失效；大块仍需调用方自己deallocate
+    void release();
+
+    // 向系统申请的内存，包括slab和大块
+    size_t bytesReserved() const { return slabTotal + largeBytes; }
+    // 分配出去还没有释放的内存
+    size_t bytesInUse() const { return inUseBytes; }
+
+private:
+    static const size_t ALIGN = 8;
+    static const size_t MAX_SMALL = 1024;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    FreeBlock* freeLists[MAX_SMALL / ALIGN + 1];
+    std::vector<char*> slabs;
+    char* cursor = nullptr;  // 当前slab中下一个可切分的位置
+    char* limit = nullptr;   // 当前slab的末尾
+    size_t slabBytes;
+    size_t nextSlab = MAX_SMALL;  // 下一个slab的大小
+    size_t slabTotal = 0;         // 所有slab的大小之和
+    size_t largeBytes = 0;
+    size_t inUseBytes = 0;
+};
+
+// 给std容器用的适配器，内存从指定的SlabAllocator分配
+template <class T>
+struct SlabStlAllocator {
+    using value_type = T;
+
+    SlabAllocator* slab;
+
+    explicit SlabStlAllocator(SlabAllocator* s) : slab(s) {}
+    template <class U>
+    SlabStlAllocator(const SlabStlAllocator<U>& other) : slab(other.slab) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(slab->allocate(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) { slab->deallocate(p, n * sizeof(T)); }
+
+    template <class U>
+    bool operator==(const SlabStlAllocator<U>& other) const { return slab == other.slab; }
+    template <class U>
+    bool operator!=(const SlabStlAllocator<U>& other) const { return slab != other.slab; }
+};
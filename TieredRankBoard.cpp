@@ -0,0 +1,288 @@
+#include "TieredRankBoard.h"
+
+#include <algorithm>
+
+TieredRankBoard::TieredRankBoard(const TieredOptions& tieredOptions, uint64_t seed)
+    : options(tieredOptions), players(std::make_shared<PlayerTable>()), head(players.get(), seed, false, true) {
+    options.headSize = std::max(1, options.headSize);
+    options.buckets = std::max(1, options.buckets);
+    options.maxScore = std::max(options.maxScore, options.minScore);
+    // 无符号运算，分数范围覆盖整个int64时也不溢出
+    uint64_t range = static_cast<uint64_t>(options.maxScore) - static_cast<uint64_t>(options.minScore);
+    bucketWidth = range / static_cast<uint64_t>(options.buckets) + 1;
+    fenwick.assign(options.buckets + 1, 0);
+}
+
+// 超出范围的分数算进两端的桶，桶的下界仍然不高于桶里所有玩家的分数
+int TieredRankBoard::bucketOf(int64_t score) const {
+    if (score <= options.minScore) {
+        return 0;
+    }
+    score = std::min(score, options.maxScore);
+    return static_cast<int>((static_cast<uint64_t>(score) - static_cast<uint64_t>(options.minScore)) / bucketWidth);
+}
+
+int64_t TieredRankBoard::bucketLow(int bucket) const {
+    return static_cast<int64_t>(static_cast<uint64_t>(options.minScore) + bucket * bucketWidth);
+}
+
+void TieredRankBoard::addToBucket(int bucket, int delta) {
+    for (int i = bucket + 1; i <= options.buckets; i += i & -i) {
+        fenwick[i] += delta;
+    }
+}
+
+int TieredRankBoard::countUpTo(int bucket) const {
+    int sum = 0;
+    for (int i = bucket + 1; i > 0; i -= i & -i) {
+        sum += fenwick[i];
+    }
+    return sum;
+}
+
+// 从最高位往下试，跳过总数还不到target的前缀
+int TieredRankBoard::lowerBound(int target) const {
+    if (target <= 0) {
+        return 0;
+    }
+    int pos = 0;
+    int step = 1;
+    while (step * 2 <= options.buckets) {
+        step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+        if (pos + step <= options.buckets && fenwick[pos + step] < target) {
+            pos += step;
+            target -= fenwick[pos];
+        }
+    }
+    return pos;
+}
+
+void TieredRankBoard::addTail(PlayerHandle player, int64_t score, time_t timestamp) {
+    if (player >= tail.size()) {
+        // 玩家id表里已有的句柄一次扩到位
+        size_t size = std::max<size_t>(player + 1, players->size());
+        tail.resize(size);
+        inTail.resize(size, false);
+    }
+    tail[player] = TailSlot{score, timestamp};
+    inTail[player] = true;
+    addToBucket(bucketOf(score), 1);
+    tailCount++;
+}
+
+void TieredRankBoard::removeTail(PlayerHandle player) {
+    addToBucket(bucketOf(tail[player].score), -1);
+    inTail[player] = false;
+    tailCount--;
+}
+
+void TieredRankBoard::updateScore(const std::string& playerId, int64_t newScore, time_t timestamp) {
+    updateScore(players->intern(playerId), newScore, timestamp);
+}
+
+void TieredRankBoard::updateScore(PlayerHandle player, int64_t newScore, time_t timestamp) {
+    updates++;
+    bool wasTail = player < inTail.size() && inTail[player];
+    if (wasTail) {
+        removeTail(player);
+        if (newScore >= cutoff) {
+            promoted++;
+        }
+    } else if (head.find(player)) {
+        head.remove(player);
+        if (newScore < cutoff) {
+            demoted++;
+        }
+    }
+    if (newScore >= cutoff) {
+        head.insert(newScore, player, timestamp);
+        trimHead();
+    } else {
+        addTail(player, newScore, timestamp);
+        refillHead();
+    }
+}
+
+void TieredRankBoard::trimHead() {
+    while (head.size() > options.headSize) {
+        int64_t lowest = head.getNodeByRank(head.size())->score;
+        if (lowest == INT64_MAX) {
+            // 门槛没法再升，头部只能超员
+            return;
+        }
+        SkipListNode* node;
+        while (head.size() > 0 && (node = head.getNodeByRank(head.size()))->score == lowest) {
+            PlayerHandle player = node->player;
+            time_t timestamp = node->timestamp;
+            head.remove(player);
+            addTail(player, lowest, timestamp);
+            demoted++;
+        }
+        cutoff = lowest + 1;
+    }
+}
+
+void TieredRankBoard::refillHead() {
+    if (head.size() >= options.headSize / 2 || tailCount == 0 || updates < nextRefill) {
+        return;
+    }
+    // 要扫一遍尾部，两次之间至少隔headSize/2次更新，头部升不上来(比如最高的同分组就放不下)时不会每次都扫
+    nextRefill = updates + options.headSize / 2;
+    // 从最高的桶往下数到放不下的那个桶，它上面的桶整桶升级，它自己按分数取放得下的几个同分组
+    int room = options.headSize - head.size();
+    int boundary = -1;
+    int64_t boundaryLow = INT64_MIN;
+    if (static_cast<int>(tailCount) > room) {
+        boundary = lowerBound(static_cast<int>(tailCount) - room);
+        boundaryLow = boundary == 0 ? INT64_MIN : bucketLow(boundary);
+        room -= static_cast<int>(tailCount) - countUpTo(boundary);
+    }
+    std::vector<std::pair<int64_t, PlayerHandle>> partial;
+    for (PlayerHandle player = 0; player < inTail.size(); player++) {
+        if (!inTail[player] || tail[player].score < boundaryLow) {
+            continue;
+        }
+        if (boundary >= 0 && bucketOf(tail[player].score) == boundary) {
+            partial.emplace_back(tail[player].score, player);
+            continue;
+        }
+        removeTail(player);
+        head.insert(tail[player].score, player, tail[player].timestamp);
+        promoted++;
+    }
+    std::sort(partial.begin(), partial.end(), std::greater<std::pair<int64_t, PlayerHandle>>());
+    size_t taken = 0;
+    while (taken < partial.size()) {
+        size_t group = taken;
+        while (group < partial.size() && partial[group].first == partial[taken].first) {
+            group++;
+        }
+        if (static_cast<int>(group) > room) {
+            break;
+        }
+        for (; taken < group; taken++) {
+            PlayerHandle player = partial[taken].second;
+            removeTail(player);
+            head.insert(tail[player].score, player, tail[player].timestamp);
+            promoted++;
+        }
+    }
+    // 留在尾部的最高分加1，超出分数范围的玩家也在边界桶里，不能直接用桶的上界
+    cutoff = taken < partial.size() ? partial[taken].first + 1 : INT64_MIN;
+}
+
+int TieredRankBoard::getRank(const std::string& playerId) {
+    PlayerHandle player = players->lookup(playerId);
+    if (player == PlayerTable::INVALID) {
+        return 0;
+    }
+    return getRank(player);
+}
+
+// 尾部：排在前面的桶的人数，再按分数在桶里的位置线性插值
+int TieredRankBoard::getRank(PlayerHandle player) {
+    if (head.find(player)) {
+        return head.getRank(player) + 1;
+    }
+    if (player >= inTail.size() || !inTail[player]) {
+        return 0;
+    }
+    int64_t score = tail[player].score;
+    int bucket = bucketOf(score);
+    int upTo = countUpTo(bucket);
+    int best = head.size() + static_cast<int>(tailCount) - upTo + 1;
+    int same = upTo - (bucket > 0 ? countUpTo(bucket - 1) : 0);
+    double above = 0;
+    if (score >= options.minScore && score <= options.maxScore) {
+        uint64_t offset = static_cast<uint64_t>(score) - static_cast<uint64_t>(bucketLow(bucket));
+        above = 1.0 - (static_cast<double>(offset) + 1) / static_cast<double>(bucketWidth);
+    }
+    return best + static_cast<int>(above * (same - 1) + 0.5);
+}
+
+bool TieredRankBoard::getRankBounds(const std::string& playerId, int& best, int& worst) {
+    PlayerHandle player = players->lookup(playerId);
+    if (player == PlayerTable::INVALID) {
+        return false;
+    }
+    if (head.find(player)) {
+        best = worst = head.getRank(player) + 1;
+        return true;
+    }
+    if (player >= inTail.size() || !inTail[player]) {
+        return false;
+    }
+    int bucket = bucketOf(tail[player].score);
+    int upTo = countUpTo(bucket);
+    best = head.size() + static_cast<int>(tailCount) - upTo + 1;
+    worst = head.size() + static_cast<int>(tailCount) - (bucket > 0 ? countUpTo(bucket - 1) : 0);
+    return true;
+}
+
+bool TieredRankBoard::isExact(const std::string& playerId) {
+    PlayerHandle player = players->lookup(playerId);
+    return player != PlayerTable::INVALID && head.find(player);
+}
+
+void TieredRankBoard::fillRankInfo(RankInfo& info, const SkipListNode* node) const {
+    info.playerId = players->name(node->player);
+    info.score = node->score;
+    info.timestamp = node->timestamp;
+}
+
+std::vector<RankInfo> TieredRankBoard::getTopNPlayers(int n) {
+    std::vector<RankInfo> topNPlayers;
+    n = std::min(n, head.size());
+    if (n < 1) {
+        return topNPlayers;
+    }
+    topNPlayers.reserve(n);
+    for (SkipListNode* node = head.getHeadNode()->level[0].forward; node && n > 0; node = node->level[0].forward, n--) {
+        fillRankInfo(topNPlayers.emplace_back(), node);
+    }
+    return topNPlayers;
+}
+
+std::vector<RankInfo> TieredRankBoard::getNearbyPlayers(const std::string& playerId, int n) {
+    std::vector<RankInfo> nearbyPlayers;
+    if (n < 1) {
+        return nearbyPlayers;
+    }
+    PlayerHandle player = players->lookup(playerId);
+    int rank = player == PlayerTable::INVALID ? -1 : head.getRank(player);
+    if (rank < 0) {
+        return nearbyPlayers;
+    }
+    nearbyPlayers.reserve(n);
+    for (SkipListNode* node = head.getNodeByRank(std::max(0, rank - n/2) + 1); node && n > 0;
+         node = node->level[0].forward, n--) {
+        fillRankInfo(nearbyPlayers.emplace_back(), node);
+    }
+    return nearbyPlayers;
+}
+
+void TieredRankBoard::clear() {
+    head.clear();
+    cutoff = INT64_MIN;
+    std::fill(fenwick.begin(), fenwick.end(), 0);
+    std::vector<TailSlot>().swap(tail);
+    std::vector<bool>().swap(inTail);
+    tailCount = 0;
+    nextRefill = 0;
+}
+
+TierStats TieredRankBoard::tierStats() const {
+    MemoryStats memory = head.memoryStats();
+    TierStats stats;
+    stats.headPlayers = head.size();
+    stats.tailPlayers = tailCount;
+    stats.cutoff = cutoff;
+    stats.headBytes = memory.reservedBytes + memory.indexBytes;
+    stats.tailBytes = tail.capacity() * sizeof(TailSlot) + inTail.capacity() / 8 + fenwick.capacity() * sizeof(int);
+    stats.playerTableBytes = players->memoryBytes();
+    stats.promoted = promoted;
+    stats.demoted = demoted;
+    return stats;
+}
@@ -0,0 +1,107 @@
+/*
+    分层排行榜：玩家很多、只有前面一小部分需要精确名次时用。
+    头部：分数不低于门槛cutoff的玩家放在跳表里，排序和RankBoard完全一致，前N名、前后N名和排名都是精确的，最多headSize个。
+    尾部：其余玩家只按句柄记分数和时间戳，另外用树状数组(Fenwick)按分数分桶计数。
+    尾部玩家的排名 = 头部人数 + 分数所在桶之上的尾部人数 + 桶内按分数线性插值，O(logB)；
+    误差不超过同一个桶里的人数，桶越细误差越小，getRankBounds给出精确的上下界。
+    头部超过headSize时把最低的整个同分组降到尾部，门槛升到它们的分数加1；
+    头部因为有人掉分降到一半以下时，按桶计数找出能整桶放进头部的最高几个桶，扫一遍尾部把这些玩家升上来，
+    放不下的那个桶按分数取放得下的同分组，门槛降到留在尾部的最高分加1。
+    门槛以上的都在头部、以下的都在尾部，头部的排名不受尾部影响。
+    尾部玩家每人16字节，跳表节点、索引和内存池开销只有头部的玩家才有。
+    不支持并发读。
+*/
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PlayerTable.h"
+#include "RankBoard.h"
+
+struct TieredOptions {
+    int headSize = 100000;        // 头部最多精确排序多少人
+    int64_t minScore = 0;         // 尾部分桶覆盖的分数范围，超出的算进两端的桶
+    int64_t maxScore = 100000000;
+    int buckets = 1 << 16;        // 桶数，尾部排名的误差不超过一个桶里的人数
+};
+
+struct TierStats {
+    size_t headPlayers;
+    size_t tailPlayers;
+    int64_t cutoff;           // 头部玩家的最低分数
+    size_t headBytes;         // 跳表节点、内存池和索引
+    size_t tailBytes;         // 尾部的分数数组和桶计数
+    size_t playerTableBytes;
+    uint64_t promoted;        // 从尾部升到头部的累计人次
+    uint64_t demoted;         // 从头部降到尾部的累计人次
+};
+
+class TieredRankBoard {
+public:
+    explicit TieredRankBoard(const TieredOptions& options, uint64_t seed = std::random_device{}());
+    TieredRankBoard(const TieredRankBoard&) = delete;
+    TieredRankBoard& operator=(const TieredRankBoard&) = delete;
+
+    // 更新玩家积分，如果不存在则添加新玩家
+    void updateScore(const std::string& playerId, int64_t newScore, time_t timestamp);
+    void updateScore(PlayerHandle player, int64_t newScore, time_t timestamp);
+    // 查询玩家当前排名，从1开始，不存在返回0；头部玩家是精确的，尾部玩家是估计值
+    int getRank(const std::string& playerId);
+    int getRank(PlayerHandle player);
+    // 排名的上下界，头部玩家两者相等；不存在返回false
+    bool getRankBounds(const std::string& playerId, int& best, int& worst);
+    // 玩家是否在头部(排名精确)
+    bool isExact(const std::string& playerId);
+    // 获取前N名玩家，只从头部取，最多头部人数个
+    std::vector<RankInfo> getTopNPlayers(int n);
+    // 查询自己名次前后共N名玩家，规则同RankBoard::getNearbyPlayers，只对头部玩家有结果，只取头部里的玩家
+    std::vector<RankInfo> getNearbyPlayers(const std::string& playerId, int n);
+    // 玩家id对应的句柄，不存在则分配一个
+    PlayerHandle getHandle(const std::string& playerId) { return players->intern(playerId); }
+    const PlayerTable& playerTable() const { return *players; }
+    // 玩家总数
+    int getPlayerCount() const { return head.size() + static_cast<int>(tailCount); }
+    // 清空排行榜
+    void clear();
+    TierStats tierStats() const;
+
+private:
+    // 尾部玩家的排序键
+    struct TailSlot {
+        int64_t score;
+        time_t timestamp;
+    };
+
+    TieredOptions options;
+    std::shared_ptr<PlayerTable> players;  // 先于head构造
+    SkipList head;
+    int64_t cutoff = INT64_MIN;            // 头部玩家的分数都不低于它，尾部玩家都低于它
+    uint64_t bucketWidth;
+    std::vector<int> fenwick;              // 1开始，第i项管(i - lowbit(i), i]这些桶
+    std::vector<TailSlot> tail;            // 按句柄
+    std::vector<bool> inTail;
+    size_t tailCount = 0;
+    uint64_t promoted = 0;
+    uint64_t demoted = 0;
+    uint64_t updates = 0;
+    uint64_t nextRefill = 0;  // 更新次数到这里才再尝试升级
+
+    int bucketOf(int64_t score) const;
+    int64_t bucketLow(int bucket) const;
+    // 树状数组：桶bucket的计数加delta；桶0到bucket的总人数
+    void addToBucket(int bucket, int delta);
+    int countUpTo(int bucket) const;
+    // 第一个使countUpTo(bucket) >= target的桶，没有返回桶数
+    int lowerBound(int target) const;
+    void addTail(PlayerHandle player, int64_t score, time_t timestamp);
+    void removeTail(PlayerHandle player);
+    // 头部超过headSize时降级最低的同分组
+    void trimHead();
+    // 头部不到一半时从尾部升级
+    void refillHead();
+    void fillRankInfo(RankInfo& info, const SkipListNode* node) const;
+};
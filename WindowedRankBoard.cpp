@@ -0,0 +1,178 @@
+#include "WindowedRankBoard.h"
+
+#include <chrono>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+WindowedRankBoard::WindowedRankBoard(const std::vector<Window>& windows, time_t start, uint64_t seed)
+    : players(std::make_shared<PlayerTable>()), seed(seed) {
+    for (const Window& window : windows) {
+        auto slot = std::make_unique<Slot>();
+        slot->config = window;
+        slot->board = newBoard();
+        slot->start = start;
+        slots.push_back(std::move(slot));
+    }
+    worker = std::thread(&WindowedRankBoard::run, this);
+}
+
+WindowedRankBoard::~WindowedRankBoard() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wakeWorker.notify_one();
+    worker.join();
+}
+
+std::shared_ptr<RankBoard> WindowedRankBoard::newBoard() {
+    return std::make_shared<RankBoard>(players, seed + boards.fetch_add(1, std::memory_order_relaxed), true);
+}
+
+void WindowedRankBoard::updateScore(const std::string& playerId, int64_t newScore, time_t timestamp) {
+    advance(timestamp);
+    PlayerHandle player = players->intern(playerId);
+    for (const std::unique_ptr<Slot>& slot : slots) {
+        // 只有写线程会替换board，这里不需要原子读
+        slot->board->updateScore(player, newScore, timestamp);
+    }
+}
+
+void WindowedRankBoard::advance(time_t now) {
+    for (size_t i = 0; i < slots.size(); i++) {
+        Slot& slot = *slots[i];
+        time_t start = slot.start.load(std::memory_order_relaxed);
+        int64_t length = slot.config.length;
+        if (length > 0 && now >= start + length) {
+            // 中间可能跳过了几个没有更新的窗口，新窗口从now所在的那个开始
+            rotate(static_cast<int>(i), start + (now - start) / length * length);
+        }
+    }
+}
+
+void WindowedRankBoard::rotate(int window, time_t start) {
+    Slot& slot = *slots[window];
+    std::shared_ptr<RankBoard> fresh;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        fresh = std::move(slot.spare);
+    }
+    // 后台线程正在给spare分配索引时只能现建一个
+    if (!fresh) {
+        fresh = newBoard();
+    }
+    // 先换上新的排行榜，读线程马上就能看到；老的连同结束时间交给后台线程
+    std::shared_ptr<RankBoard> old = slot.board;
+    std::atomic_store_explicit(&slot.board, std::move(fresh), std::memory_order_release);
+    time_t oldStart = slot.start.exchange(start, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        jobs.push_back(Job{window, oldStart, start, std::move(old)});
+    }
+    wakeWorker.notify_one();
+}
+
+std::shared_ptr<RankBoard> WindowedRankBoard::current(int window) const {
+    return std::atomic_load_explicit(&slots[window]->board, std::memory_order_acquire);
+}
+
+time_t WindowedRankBoard::currentStart(int window) const {
+    return slots[window]->start.load(std::memory_order_acquire);
+}
+
+bool WindowedRankBoard::finished(int window, int age, FinishedWindow& out) const {
+    std::lock_guard<std::mutex> guard(lock);
+    const std::deque<FinishedWindow>& list = slots[window]->finished;
+    if (age < 0 || age >= static_cast<int>(list.size())) {
+        return false;
+    }
+    out = list[age];
+    return true;
+}
+
+void WindowedRankBoard::waitIdle() {
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [this] { return jobs.empty() && !busy; });
+}
+
+int WindowedRankBoard::findWindow(const std::string& name) const {
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (slots[i]->config.name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void WindowedRankBoard::run() {
+#ifdef __linux__
+    // 冻结和释放都不着急，降低优先级，CPU不够时不和写线程抢
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        if (jobs.empty()) {
+            if (stopping) {
+                return;
+            }
+            // 玩家数一直在涨，定时检查spare的索引够不够
+            prepareSpares(guard);
+            wakeWorker.wait_for(guard, std::chrono::milliseconds(100), [this] { return stopping || !jobs.empty(); });
+            continue;
+        }
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        busy = true;
+        int keep = slots[job.window]->config.keepFinished;
+        guard.unlock();
+        // 写线程已经不再碰这个排行榜，后台线程是它唯一的写者，可以生成快照
+        FinishedWindow done{job.start, job.end, nullptr};
+        if (keep > 0) {
+            done.snapshot = job.board->snapshot();
+        }
+        // 没有读线程还拿着的话在这里整体释放，否则由最后一个读线程释放
+        job.board.reset();
+        std::vector<FinishedWindow> expired;
+        guard.lock();
+        std::deque<FinishedWindow>& list = slots[job.window]->finished;
+        if (keep > 0) {
+            list.push_front(std::move(done));
+        }
+        while (static_cast<int>(list.size()) > keep) {
+            expired.push_back(std::move(list.back()));
+            list.pop_back();
+        }
+        // 过期的快照在锁外释放
+        guard.unlock();
+        expired.clear();
+        guard.lock();
+        busy = false;
+        if (jobs.empty()) {
+            idle.notify_all();
+        }
+    }
+}
+
+void WindowedRankBoard::prepareSpares(std::unique_lock<std::mutex>& guard) {
+    for (const std::unique_ptr<Slot>& slot : slots) {
+        size_t count = players->size();
+        if (slot->spare && slot->spareCapacity >= count) {
+            continue;
+        }
+        // 拿出来分配，这期间写线程轮换的话会自己新建一个
+        std::shared_ptr<RankBoard> spare = std::move(slot->spare);
+        guard.unlock();
+        if (!spare) {
+            spare = newBoard();
+        }
+        size_t capacity = count + count / 2 + 1024;
+        spare->reserve(capacity);
+        guard.lock();
+        slot->spare = std::move(spare);
+        slot->spareCapacity = capacity;
+    }
+}
@@ -0,0 +1,101 @@
+/*
+    时间窗口排行榜：日榜、周榜、赛季榜这类并行的榜放在一起，一次updateScore写进所有窗口。
+    所有窗口共用一个PlayerTable，playerId只驻留一次，写各个窗口时直接用句柄。
+    每个窗口有自己的起始时间和长度，更新的时间戳越过窗口边界时先轮换：换上一个空的RankBoard，O(1)，写线程不会停顿。
+    句柄是所有窗口共用的，新排行榜第一次插入时要把索引扩到全部玩家数，几百万玩家时是一次十几MB的分配；
+    所以由后台线程提前建好下一个排行榜并按玩家数分配好索引，轮换时直接换上。
+    结束的窗口交给后台线程生成只读快照(RankSnapshot)，保留最近keepFinished个，更早的也在后台线程释放。
+    跳表节点都在排行榜自己的内存池里，释放一个结束的窗口只是归还内存池的slab，不用逐个删除节点。
+    只有一个写线程调用updateScore/advance/rotate；读线程用current拿到正在进行的窗口(开启了并发读)，用finished拿到结束的窗口。
+    时间戳早于当前窗口起始时间的更新(迟到的)算进当前窗口，结束的窗口不再修改。
+*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RankBoard.h"
+#include "RankSnapshot.h"
+
+class WindowedRankBoard {
+public:
+    struct Window {
+        std::string name;
+        int64_t length;    // 窗口长度(秒)，0为不自动轮换，比如赛季由rotate手动结束
+        int keepFinished;  // 保留最近几个结束的窗口
+    };
+    // 一个结束的窗口
+    struct FinishedWindow {
+        time_t start;
+        time_t end;
+        std::shared_ptr<const RankSnapshot> snapshot;
+    };
+
+    // 所有窗口都从start开始
+    WindowedRankBoard(const std::vector<Window>& windows, time_t start, uint64_t seed = std::random_device{}());
+    // 等后台线程处理完已经结束的窗口
+    ~WindowedRankBoard();
+    WindowedRankBoard(const WindowedRankBoard&) = delete;
+    WindowedRankBoard& operator=(const WindowedRankBoard&) = delete;
+
+    // 写进所有窗口；timestamp越过某个窗口的边界时先轮换这个窗口
+    void updateScore(const std::string& playerId, int64_t newScore, time_t timestamp);
+    // 没有更新时也按当前时间轮换到期的窗口，定时调用
+    void advance(time_t now);
+    // 手动结束一个窗口，新窗口从start开始
+    void rotate(int window, time_t start);
+    // 正在进行的窗口，读线程可以不加锁地查询；拿着它期间窗口轮换了也可以继续读
+    std::shared_ptr<RankBoard> current(int window) const;
+    // 正在进行的窗口的起始时间
+    time_t currentStart(int window) const;
+    // 结束的第age个窗口，0为最近结束的；不存在或者后台还没冻结完返回false
+    bool finished(int window, int age, FinishedWindow& out) const;
+    // 等后台线程把已经结束的窗口都冻结、释放完
+    void waitIdle();
+    int windowCount() const { return static_cast<int>(slots.size()); }
+    // 按名字找窗口，不存在返回-1
+    int findWindow(const std::string& name) const;
+    // 所有窗口共用的玩家id表
+    const PlayerTable& playerTable() const { return *players; }
+
+private:
+    struct Slot {
+        Window config;
+        std::shared_ptr<RankBoard> board;     // 用std::atomic_load/atomic_store访问
+        std::atomic<time_t> start;
+        std::deque<FinishedWindow> finished;  // 最近结束的在前面，受lock保护
+        std::shared_ptr<RankBoard> spare;     // 后台线程备好的下一个排行榜，受lock保护
+        size_t spareCapacity = 0;             // spare的索引能容纳的玩家数
+    };
+    // 交给后台线程的结束窗口
+    struct Job {
+        int window;
+        time_t start;
+        time_t end;
+        std::shared_ptr<RankBoard> board;
+    };
+
+    std::shared_ptr<PlayerTable> players;
+    std::vector<std::unique_ptr<Slot>> slots;
+    uint64_t seed;
+    std::atomic<uint64_t> boards{0};    // 已创建的排行榜个数，和seed一起决定新排行榜的种子
+    mutable std::mutex lock;            // 保护finished、spare、jobs和busy
+    std::condition_variable wakeWorker; // 有新的结束窗口
+    std::condition_variable idle;       // 后台线程空闲
+    std::deque<Job> jobs;
+    bool busy = false;
+    bool stopping = false;
+    std::thread worker;
+
+    std::shared_ptr<RankBoard> newBoard();
+    // 后台线程：生成快照，去掉超出保留个数的老窗口；空闲时给每个窗口备好下一个排行榜
+    void run();
+    // 玩家数超过spare的索引容量时重新分配，调用时持有lock，分配期间放开
+    void prepareSpares(std::unique_lock<std::mutex>& guard);
+};